@@ -15,13 +15,116 @@
 #include <memory>
 #include <mutex>
 #include <set>
+#include <map>
+#include <list>
+#include <atomic>
+#include <condition_variable>
 
-#include "Tree.hpp"
-#include "List.hpp"
+#include "ProcessThread.hpp"
 
+// ComputeKernel.cpp
+bool IsAVX2Available();
+void SplitUVLine8_AVX2(uint8_t* dstU, uint8_t* dstV, const uint8_t* src, int w);
+void SplitUVLine16_AVX2(uint16_t* dstU, uint16_t* dstV, const uint16_t* src, int w);
 
 namespace av {
 
+// tB[h
+// CtopACbottomisb`͗vfPʁj
+// top,bottomt[̏ꍇ̓v[Ŝ܂Ƃ߂ăRs[
+template <typename T>
+void MergeFieldPlane(T* dst, const T* top, const T* bottom, int w, int h, int dpitch, int tpitch, int bpitch)
+{
+	if (top == bottom && tpitch == bpitch) {
+		if (dpitch == tpitch) {
+			memcpy(dst, top, sizeof(T) * ((size_t)dpitch * (h - 1) + w));
+		}
+		else {
+			for (int y = 0; y < h; ++y) {
+				memcpy(dst + dpitch * y, top + tpitch * y, sizeof(T) * w);
+			}
+		}
+		return;
+	}
+	for (int y = 0; y < h; ++y) {
+		const T* src = (y & 1) ? (bottom + bpitch * y) : (top + tpitch * y);
+		memcpy(dst + dpitch * y, src, sizeof(T) * w);
+	}
+}
+
+template <typename T>
+void SplitUVLine_C(T* dstU, T* dstV, const T* src, int w)
+{
+	for (int x = 0; x < w; ++x) {
+		dstU[x] = src[x * 2 + 0];
+		dstV[x] = src[x * 2 + 1];
+	}
+}
+
+static void SplitUVLine_AVX2(uint8_t* dstU, uint8_t* dstV, const uint8_t* src, int w) {
+	SplitUVLine8_AVX2(dstU, dstV, src, w);
+}
+
+static void SplitUVLine_AVX2(uint16_t* dstU, uint16_t* dstV, const uint16_t* src, int w) {
+	SplitUVLine16_AVX2(dstU, dstV, src, w);
+}
+
+// NV12UVv[𕪗ȂtB[h
+template <typename T>
+void SplitUVPlane(T* dstU, T* dstV, const T* top, const T* bottom,
+	int w, int h, int dpitch, int tpitch, int bpitch, bool avx2)
+{
+	void(*splitLine)(T*, T*, const T*, int) = SplitUVLine_C<T>;
+	if (avx2) {
+		splitLine = SplitUVLine_AVX2;
+	}
+	for (int y = 0; y < h; ++y) {
+		const T* src = (y & 1) ? (bottom + bpitch * y) : (top + tpitch * y);
+		splitLine(dstU + dpitch * y, dstV + dpitch * y, src, w);
+	}
+}
+
+// o̓t[̃v[
+// AviSynthŎQƂȂȂiv[Ăjt[ėp
+class AMTFramePool : NonCopyable
+{
+	std::vector<PVideoFrame> frames;
+	size_t maxFrames;
+	size_t next;
+public:
+	AMTFramePool() : maxFrames(0), next(0) { }
+
+	void setMaxFrames(size_t n) {
+		maxFrames = n;
+		if (frames.size() > maxFrames) {
+			frames.resize(maxFrames);
+			next = 0;
+		}
+	}
+
+	PVideoFrame get(const VideoInfo& vi, IScriptEnvironment* env) {
+		for (size_t i = 0; i < frames.size(); ++i) {
+			size_t idx = (next + i) % frames.size();
+			PVideoFrame& frame = frames[idx];
+			if (frame->IsWritable()) {
+				next = idx + 1;
+				// ÕvpeBĂ
+				frame->DeleteProperty("QP_Table");
+				frame->DeleteProperty("QP_Table_Non_B");
+				frame->DeleteProperty("QP_Stride");
+				frame->DeleteProperty("QP_ScaleType");
+				frame->DeleteProperty("DC_Table");
+				return frame;
+			}
+		}
+		PVideoFrame frame = env->NewVideoFrame(vi);
+		if (frames.size() < maxFrames) {
+			frames.push_back(frame);
+		}
+		return frame;
+	}
+};
+
 struct FakeAudioSample {
 
 	enum {
@@ -39,6 +142,285 @@ struct AMTSourceData {
 	std::vector<FilterAudioFrame> audioFrames;
 };
 
+// V[NCfbNXiGOPPʁj
+// .amtst@CƈꏏɕۑĂă_ANZX1̃V[Nōςނ悤ɂ
+struct AMTSeekIndexEntry {
+	int64_t fileOffset; // V[NoCgʒui188oCgEj
+	int keyFrame;       // V[NŏɃfR[hłt[iGOP擪j
+	int numFrames;      // GOP̃t[
+	int seekGop;        // GOP̃t[𓾂邽߂ɃV[NGOPiʏ͎gj
+	int readyDistance;  // seekGop̐擪炱GOP̍Ō܂ł̃t[
+};
+
+struct AMTSeekIndexHeader {
+	enum {
+		MAGIC = 0x58444B53, // "SKDX"
+		VERSION = 1
+	};
+	int32_t magic;
+	int32_t version;
+	int32_t numFrames;
+};
+
+static tstring GetAMTSeekIndexPath(const tstring& amtsPath) {
+	return amtsPath + _T(".idx");
+}
+
+static std::vector<AMTSeekIndexEntry> BuildAMTSeekIndex(const std::vector<FilterSourceFrame>& frames)
+{
+	std::vector<AMTSeekIndexEntry> index;
+	for (int i = 0; i < (int)frames.size(); ++i) {
+		if (index.size() == 0 || index.back().keyFrame != frames[i].keyFrame) {
+			int keyFrame = frames[i].keyFrame;
+			AMTSeekIndexEntry entry = {
+				frames[keyFrame].fileOffset / 188 * 188, keyFrame, 0, (int)index.size(), 0
+			};
+			index.push_back(entry);
+		}
+		// GOP擪̃t[
+		index.back().numFrames++;
+		index.back().readyDistance = index.back().numFrames;
+	}
+	return index;
+}
+
+// ǂݍݒ̑̃CX^X⑼vZX̃t@Cǂ܂Ȃ悤
+// ꎞt@CɏĂu
+static void SaveAMTSeekIndex(const tstring& path, int numFrames, const std::vector<AMTSeekIndexEntry>& index)
+{
+	AMTSeekIndexHeader header = { AMTSeekIndexHeader::MAGIC, AMTSeekIndexHeader::VERSION, numFrames };
+	tstring tmppath = StringFormat(_T("%s.%u-%u.tmp"), path,
+		(unsigned)GetCurrentProcessId(), (unsigned)GetCurrentThreadId());
+	try {
+		File file(tmppath, _T("wb"));
+		file.writeValue(header);
+		file.writeArray(index);
+	}
+	catch (const IOException&) {
+		DeleteFileW(tmppath.c_str());
+		throw;
+	}
+	if (MoveFileExW(tmppath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) == FALSE) {
+		DeleteFileW(tmppath.c_str());
+		THROWF(IOException, "V[NCfbNXۑł܂: %s", path);
+	}
+}
+
+// .idxgCX^XƂiZOgGR[hȂǁj
+// sɊwKe߂͍̂ŏ̃CX^Xɂ
+// ̃CX^XɂƂăCfbNX͓ǂݎp
+// L̓fXgN^Ŏ̂ŁAL҂̃RXgN^rŎsĂcȂ
+class AMTSeekIndexOwner : NonCopyable
+{
+public:
+	AMTSeekIndexOwner(const tstring& path)
+		: path(path)
+		, owner(false)
+	{
+		if (path.size() > 0) {
+			std::lock_guard<std::mutex> guard(mutex());
+			owner = paths().insert(path).second;
+		}
+	}
+	~AMTSeekIndexOwner() {
+		release();
+	}
+	bool isOwner() const {
+		return owner;
+	}
+	void release() {
+		if (owner) {
+			std::lock_guard<std::mutex> guard(mutex());
+			paths().erase(path);
+			owner = false;
+		}
+	}
+private:
+	tstring path;
+	bool owner;
+
+
+	static std::mutex& mutex() {
+		static std::mutex m;
+		return m;
+	}
+	static std::set<tstring>& paths() {
+		static std::set<tstring> s;
+		return s;
+	}
+};
+
+// ǂ߂Ȃ܂͍Ȃꍇ͋Ԃ
+static std::vector<AMTSeekIndexEntry> LoadAMTSeekIndex(const tstring& path, int numFrames)
+{
+	if (File::exists(path) == false) {
+		return std::vector<AMTSeekIndexEntry>();
+	}
+	try {
+		File file(path, _T("rb"));
+		auto header = file.readValue<AMTSeekIndexHeader>();
+		if (header.magic != AMTSeekIndexHeader::MAGIC ||
+			header.version != AMTSeekIndexHeader::VERSION ||
+			header.numFrames != numFrames)
+		{
+			return std::vector<AMTSeekIndexEntry>();
+		}
+		auto index = file.readArray<AMTSeekIndexEntry>();
+		// g`FbNāAΎgȂ
+		int totalFrames = 0;
+		for (int i = 0; i < (int)index.size(); ++i) {
+			const auto& e = index[i];
+			if (e.keyFrame < 0 || e.keyFrame >= numFrames ||
+				(i > 0 && e.keyFrame <= index[i - 1].keyFrame) ||
+				e.numFrames <= 0 || e.seekGop < 0 || e.seekGop > i ||
+				e.readyDistance < e.numFrames || e.fileOffset < 0)
+			{
+				return std::vector<AMTSeekIndexEntry>();
+			}
+			totalFrames += e.numFrames;
+		}
+		if (totalFrames != numFrames) {
+			return std::vector<AMTSeekIndexEntry>();
+		}
+		return index;
+	}
+	catch (const IOException&) {
+		return std::vector<AMTSeekIndexEntry>();
+	}
+}
+
+// AMTSourcẽt[LbV
+// t[ԍŃV[hɕāAbN̓V[hƂɎ
+// qbg̓fR[_̃bNȂ̂ŁAfR[hł
+// ̃XbhɃLbVς݂̃t[ԂƂł
+class AMTFrameCache : NonCopyable
+{
+public:
+	enum { NUM_SHARDS = 8 };
+
+	AMTFrameCache()
+		: frameBytes(1)
+		, shardCapacity(1)
+	{ }
+
+	// 1t[̃oCg
+	void setFrameBytes(size_t bytes) {
+		frameBytes = std::max<size_t>(1, bytes);
+	}
+
+	// LbVŜ̗eʁioCgj
+	// eV[h͍Œł1t[͕ێ
+	void setCapacity(size_t bytes) {
+		size_t numFrames = bytes / frameBytes;
+		shardCapacity = std::max<int>(1, (int)((numFrames + NUM_SHARDS - 1) / NUM_SHARDS));
+	}
+
+	size_t getCapacity() const {
+		return (size_t)shardCapacity * NUM_SHARDS * frameBytes;
+	}
+
+	// frameɓtrueԂiANZXXVj
+	bool get(int n, PVideoFrame& frame) {
+		Shard& shard = getShard(n);
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		auto it = shard.frames.find(n);
+		if (it == shard.frames.end()) {
+			return false;
+		}
+		shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+		frame = it->second.data;
+		return true;
+	}
+
+	// ΃ANZXXVtrueԂ
+	bool touch(int n) {
+		Shard& shard = getShard(n);
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		auto it = shard.frames.find(n);
+		if (it == shard.frames.end()) {
+			return false;
+		}
+		shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+		return true;
+	}
+
+	bool contains(int n) {
+		Shard& shard = getShard(n);
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		return shard.frames.find(n) != shard.frames.end();
+	}
+
+	void put(int n, const PVideoFrame& frame) {
+		Shard& shard = getShard(n);
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		auto it = shard.frames.find(n);
+		if (it != shard.frames.end()) {
+			it->second.data = frame;
+			shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+			return;
+		}
+		shard.lru.push_front(n);
+		Entry& entry = shard.frames[n];
+		entry.data = frame;
+		entry.lru = shard.lru.begin();
+		while ((int)shard.frames.size() > shardCapacity) {
+			// LbVꂽÂ̂폜
+			shard.frames.erase(shard.lru.back());
+			shard.lru.pop_back();
+		}
+	}
+
+	// nOōł߂t[iȂnōł߂t[jԂ
+	bool getNearest(int n, PVideoFrame& frame) {
+		int found = -1;
+		for (int i = 0; i < NUM_SHARDS; ++i) {
+			Shard& shard = shards[i];
+			std::lock_guard<std::mutex> guard(shard.mutex);
+			if (shard.frames.size() == 0) continue;
+			auto it = shard.frames.upper_bound(n);
+			int cand = (it != shard.frames.begin()) ? std::prev(it)->first : it->first;
+			if (found == -1 || betterThan(cand, found, n)) {
+				found = cand;
+				frame = (it != shard.frames.begin()) ? std::prev(it)->second.data : it->second.data;
+			}
+		}
+		return found != -1;
+	}
+
+	void clear() {
+		for (int i = 0; i < NUM_SHARDS; ++i) {
+			std::lock_guard<std::mutex> guard(shards[i].mutex);
+			shards[i].frames.clear();
+			shards[i].lru.clear();
+		}
+	}
+
+private:
+	struct Entry {
+		PVideoFrame data;
+		std::list<int>::iterator lru;
+	};
+	struct Shard {
+		std::mutex mutex;
+		std::map<int, Entry> frames;
+		std::list<int> lru; // 擪ŋ߃ANZXꂽ
+	};
+
+	Shard shards[NUM_SHARDS];
+	size_t frameBytes;
+	std::atomic<int> shardCapacity; // V[h̍őt[
+
+	Shard& getShard(int n) {
+		return shards[(unsigned int)n % NUM_SHARDS];
+	}
+
+	static bool betterThan(int a, int b, int n) {
+		// nȉDA̒ł͑傫AnȉȂΏ
+		if ((a <= n) != (b <= n)) return a <= n;
+		return (a <= n) ? (a > b) : (a < b);
+	}
+};
+
 class AMTSource : public IClip, AMTObject
 {
 	const std::vector<FilterSourceFrame>& frames;
@@ -63,26 +445,38 @@ class AMTSource : public IClip, AMTObject
 
 	std::unique_ptr<AMTSourceData> storage;
 
-	struct CacheFrame {
-		PVideoFrame data;
-		TreeNode<int, CacheFrame*> treeNode;
-		ListNode<CacheFrame*> listNode;
-	};
-
-	Tree<int, CacheFrame*> frameCache;
-	List<CacheFrame*> recentAccessed;
+	AMTFrameCache frameCache;
+	AMTFramePool framePool;
+	// w肳ꂽLbVeʁioCgj
+	size_t cacheBytes;
+	// AVX2g邩
+	bool avx2;
+	// ptH[}XviAMT_PERF_SOURCE_*j̏Wv
+	// G[vctxɓit[xfR[ĥŖ{̂ɂ͓Ȃj
+	AMTContext& perfCtx;
 
 	// fR[hłȂt[̒u惊Xg
 	std::map<int, int> failedMap;
 
 	VideoInfo vi;
 
+	// fR[_pbN
 	std::mutex mutex;
+	// pbN
+	std::mutex audioMutex;
 
 	File waveFile;
 
 	int seekDistance;
 
+	// V[NCfbNXiȂꍇ͋j
+	std::vector<AMTSeekIndexEntry> seekIndex;
+	tstring seekIndexPath;
+	// sseekGopXV
+	bool seekIndexUpdated;
+	// XV߂CX^X
+	AMTSeekIndexOwner seekIndexOwner;
+
 	// OnFrameDecodedŒOɃfR[hꂽt[
 	// ܂fR[hĂȂꍇ-1
 	int lastDecodeFrame;
@@ -94,6 +488,43 @@ class AMTSource : public IClip, AMTObject
 	// Onon B QPe[u
 	PVideoFrame nonBQPTable;
 
+	// ǂ݃fR[h
+	// AANZXoAʃXbhreadAheadFrames܂ŃfR[hĂ
+	// AviSynth+IScriptEnvironment̓XbhƂȂ̂Őǂ݃XbhłenvgȂ
+	// fR[hʂAVFramê܂aheadFramesɒuĂAGetFrameĂ񂾃XbhenvPVideoFrameɂ
+	class ReadAheadThread : public ThreadBase
+	{
+		AMTSource* pThis;
+	public:
+		ReadAheadThread(AMTSource* pThis) : pThis(pThis) { }
+	protected:
+		virtual void run() { pThis->ReadAheadLoop(); }
+	};
+
+	enum {
+		// PrefetchőOシ̂ŁAO̗v炱͈̔͂ȂAANZXƂ݂Ȃ
+		SEQUENTIAL_RANGE = 8,
+		// ̉񐔘AANZXǂ݂Jn
+		SEQUENTIAL_THRESH = 8,
+	};
+
+	int readAheadFrames; // 0Ȃǂ݂Ȃ
+	struct AheadFrame {
+		Frame top;
+		Frame bottom;
+	};
+	// ǂ݂ŃfR[ht[imutexŕیj
+	std::map<int, std::unique_ptr<AheadFrame>> aheadFrames;
+	std::mutex aheadMutex;
+	std::condition_variable aheadCond;
+	int lastRequest;   // Oɗvꂽt[
+	int numSequential; // AANZX
+	int aheadTarget;   // ܂Őǂ݂i-1Ȃǂ݂Ȃj
+	int aheadDecoded;  // ǂݑ猩lastDecodeFrame
+	bool aheadStopped; // fR[_V[N܂Őǂ݂Ȃ
+	bool aheadFinished;
+	std::unique_ptr<ReadAheadThread> aheadThread;
+
 	AVCodec* getHWAccelCodec(AVCodecID vcodecId)
 	{
 		switch (vcodecId) {
@@ -288,38 +719,6 @@ class AMTSource : public IClip, AMTObject
 #endif
 	}
 
-	template <typename T>
-	void Copy1(T* dst, const T* top, const T* bottom, int w, int h, int dpitch, int tpitch, int bpitch)
-	{
-		for (int y = 0; y < h; y += 2) {
-			T* dst0 = dst + dpitch * (y + 0);
-			T* dst1 = dst + dpitch * (y + 1);
-			const T* src0 = top + tpitch * (y + 0);
-			const T* src1 = bottom + bpitch * (y + 1);
-			memcpy(dst0, src0, sizeof(T) * w);
-			memcpy(dst1, src1, sizeof(T) * w);
-		}
-	}
-
-	template <typename T>
-	void Copy2(T* dstU, T* dstV, const T* top, const T* bottom, int w, int h, int dpitch, int tpitch, int bpitch)
-	{
-		for (int y = 0; y < h; y += 2) {
-			T* dstU0 = dstU + dpitch * (y + 0);
-			T* dstU1 = dstU + dpitch * (y + 1);
-			T* dstV0 = dstV + dpitch * (y + 0);
-			T* dstV1 = dstV + dpitch * (y + 1);
-			const T* src0 = top + tpitch * (y + 0);
-			const T* src1 = bottom + bpitch * (y + 1);
-			for (int x = 0; x < w; ++x) {
-				dstU0[x] = src0[x * 2 + 0];
-				dstV0[x] = src0[x * 2 + 1];
-				dstU1[x] = src1[x * 2 + 0];
-				dstV1[x] = src1[x * 2 + 1];
-			}
-		}
-	}
-
 	template <typename T>
 	void MergeField(PVideoFrame& dst, AVFrame* top, AVFrame* bottom) {
 		const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)(top->format));
@@ -334,28 +733,29 @@ class AMTSource : public IClip, AMTObject
 		T* dstU = (T*)dst->GetWritePtr(PLANAR_U);
 		T* dstV = (T*)dst->GetWritePtr(PLANAR_V);
 
-		int srctPitchY = top->linesize[0];
-		int srctPitchUV = top->linesize[1];
-		int srcbPitchY = bottom->linesize[0];
-		int srcbPitchUV = bottom->linesize[1];
-		int dstPitchY = dst->GetPitch(PLANAR_Y);
-		int dstPitchUV = dst->GetPitch(PLANAR_U);
+		// sb`̓oCgPʂȂ̂ŗvfPʂɂ
+		int srctPitchY = top->linesize[0] / sizeof(T);
+		int srctPitchUV = top->linesize[1] / sizeof(T);
+		int srcbPitchY = bottom->linesize[0] / sizeof(T);
+		int srcbPitchUV = bottom->linesize[1] / sizeof(T);
+		int dstPitchY = dst->GetPitch(PLANAR_Y) / sizeof(T);
+		int dstPitchUV = dst->GetPitch(PLANAR_U) / sizeof(T);
 
-		Copy1<T>(dstY, srctY, srcbY, vi.width, vi.height, dstPitchY, srctPitchY, srcbPitchY);
+		MergeFieldPlane<T>(dstY, srctY, srcbY, vi.width, vi.height, dstPitchY, srctPitchY, srcbPitchY);
 
 		int widthUV = vi.width >> desc->log2_chroma_w;
 		int heightUV = vi.height >> desc->log2_chroma_h;
 		if (top->format != AV_PIX_FMT_NV12) {
-			Copy1<T>(dstU, srctU, srcbU, widthUV, heightUV, dstPitchUV, srctPitchUV, srcbPitchUV);
-			Copy1<T>(dstV, srctV, srcbV, widthUV, heightUV, dstPitchUV, srctPitchUV, srcbPitchUV);
+			MergeFieldPlane<T>(dstU, srctU, srcbU, widthUV, heightUV, dstPitchUV, srctPitchUV, srcbPitchUV);
+			MergeFieldPlane<T>(dstV, srctV, srcbV, widthUV, heightUV, dstPitchUV, srctPitchUV, srcbPitchUV);
 		}
 		else {
-			Copy2<T>(dstU, dstV, srctU, srcbU, widthUV, heightUV, dstPitchUV, srctPitchUV, srcbPitchUV);
+			SplitUVPlane<T>(dstU, dstV, srctU, srcbU, widthUV, heightUV, dstPitchUV, srctPitchUV, srcbPitchUV, avx2);
 		}
 	}
 
 	PVideoFrame MakeFrame(AVFrame* top, AVFrame* bottom, IScriptEnvironment* env) {
-		PVideoFrame ret = env->NewVideoFrame(vi);
+		PVideoFrame ret = framePool.get(vi, env);
 		const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)(top->format));
 
 		if (desc->comp[0].depth > 8) {
@@ -408,23 +808,248 @@ class AMTSource : public IClip, AMTObject
 	}
 
 	void PutFrame(int n, const PVideoFrame& frame) {
-		CacheFrame* pcache = new CacheFrame();
-		pcache->data = frame;
-		pcache->treeNode.key = n;
-		pcache->treeNode.value = pcache;
-		pcache->listNode.value = pcache;
-		frameCache.insert(&pcache->treeNode);
-		recentAccessed.push_front(&pcache->listNode);
+		frameCache.put(n, frame);
+	}
+
+	bool HasFrame(int n) {
+		return frameCache.touch(n) || aheadFrames.find(n) != aheadFrames.end();
+	}
+
+	// envnullptrȂǂ݃XbhȂ̂AVFramê܂ܒuĂ
+	void OutputFrame(int n, Frame& top, Frame& bottom, IScriptEnvironment* env) {
+		if (env == nullptr) {
+			aheadFrames[n] = std::unique_ptr<AheadFrame>(new AheadFrame{ top, bottom });
+		}
+		else {
+			PutFrame(n, MakeFrame(top(), bottom(), env));
+		}
+	}
+
+	// ǂ݂t[ĂяoenvPVideoFrameɂăLbVɓimutexԂŌĂԂƁj
+	bool TakeAheadFrame(int n, PVideoFrame& frame, IScriptEnvironment* env) {
+		// vʒu\Ɏcꂽ͎̂̂Ă
+		while (aheadFrames.size() > 0 && aheadFrames.begin()->first < n - SEQUENTIAL_RANGE) {
+			aheadFrames.erase(aheadFrames.begin());
+		}
+		auto it = aheadFrames.find(n);
+		if (it == aheadFrames.end()) {
+			return false;
+		}
+		frame = MakeFrame(it->second->top(), it->second->bottom(), env);
+		PutFrame(n, frame);
+		aheadFrames.erase(it);
+		return true;
+	}
+
+	void UpdateCacheCapacity() {
+		// V[NăfR[ht[Ȃ悤ŒłseekDistance1.5{͕ێ
+		// ǂ݂Ăꍇ͐ǂݕǉ
+		size_t frameBytes = (size_t)vi.width * vi.height * vi.BitsPerPixel() / 8;
+		frameCache.setFrameBytes(frameBytes);
+		frameCache.setCapacity(std::max(cacheBytes, frameBytes * (seekDistance * 3 / 2 + readAheadFrames)));
+		// LbVɓĂt[͍ėpłȂ̂ŁA̕܂߂Ă
+		framePool.setMaxFrames(frameCache.getCapacity() / frameBytes + 8);
+	}
+
+	void StartReadAhead() {
+		if (outputQP) {
+			// Bt[QPe[u̓fR[hɈˑ̂Őǂ݂Ńt[̐ςƍ
+			readAheadFrames = 0;
+		}
+		size_t frameBytes = (size_t)vi.width * vi.height * vi.BitsPerPixel() / 8;
+		if (cacheBytes > 0) {
+			// LbVeʂw肳Ăꍇ͂̔܂łɗ}
+			readAheadFrames = std::min(readAheadFrames, (int)(cacheBytes / frameBytes / 2));
+		}
+		if (readAheadFrames <= 0) {
+			readAheadFrames = 0;
+			return;
+		}
+		aheadThread = std::unique_ptr<ReadAheadThread>(new ReadAheadThread(this));
+		aheadThread->start();
+	}
+
+	void StopReadAhead() {
+		if (aheadThread) {
+			{
+				std::lock_guard<std::mutex> lock(aheadMutex);
+				aheadFinished = true;
+				aheadCond.notify_all();
+			}
+			aheadThread->join();
+			aheadThread = nullptr;
+		}
+	}
+
+	// GetFrame̗vĘAANZXȂǂݔ͈͂L΂
+	void NotifyRequest(int n) {
+		if (readAheadFrames <= 0) return;
+		std::lock_guard<std::mutex> lock(aheadMutex);
+		if (n > lastRequest - SEQUENTIAL_RANGE && n <= lastRequest + SEQUENTIAL_RANGE) {
+			++numSequential;
+		}
+		else {
+			// _ANZXȂ̂Őǂ݂͂߂
+			numSequential = 0;
+			aheadTarget = -1;
+		}
+		lastRequest = n;
+		if (numSequential >= SEQUENTIAL_THRESH) {
+			int target = std::min(n + readAheadFrames, vi.num_frames - 1);
+			if (target > aheadTarget) {
+				aheadTarget = target;
+				aheadCond.notify_all();
+			}
+		}
+	}
+
+	// fR[_̈ʒuςǂݑɒm点imutexԂŌĂԂƁj
+	void UpdateReadAheadPosition() {
+		if (readAheadFrames <= 0) return;
+		std::lock_guard<std::mutex> lock(aheadMutex);
+		aheadDecoded = lastDecodeFrame;
+		aheadStopped = false;
+		aheadCond.notify_all();
+	}
 
-		if ((int)recentAccessed.size() > seekDistance * 3 / 2) {
-			// LbVꂽ폜
-			CacheFrame* pdel = recentAccessed.back().value;
-			frameCache.erase(frameCache.it(&pdel->treeNode));
-			recentAccessed.erase(recentAccessed.it(&pdel->listNode));
-			delete pdel;
+	void ReadAheadLoop() {
+		while (true) {
+			int target;
+			{
+				std::unique_lock<std::mutex> lock(aheadMutex);
+				while (!aheadFinished && (aheadStopped || aheadTarget <= aheadDecoded)) {
+					aheadCond.wait(lock);
+				}
+				if (aheadFinished) {
+					break;
+				}
+				target = aheadTarget;
+			}
+			int decoded = -1;
+			bool progress = false;
+			try {
+				// 1t[fR[hGetFramefR[_g悤ɂ
+				std::lock_guard<std::mutex> guard(mutex);
+				int prev = lastDecodeFrame;
+				if (prev != -1 && prev < target) {
+					DecodeLoop(prev + 1, nullptr);
+					if (lastDecodeFrame > prev) {
+						perfCtx.addPerfCounter(AMT_PERF_SOURCE_READ_AHEAD, lastDecodeFrame - prev);
+						progress = true;
+					}
+				}
+				decoded = lastDecodeFrame;
+			}
+			catch (const AvisynthError& e) {
+				// G[GetFrame̕ŏ
+				ctx.warnF("ǂ݃fR[hŃG[: %s", e.msg);
+			}
+			catch (const Exception& e) {
+				ctx.warnF("ǂ݃fR[hŃG[: %s", e.message());
+			}
+			{
+				std::lock_guard<std::mutex> lock(aheadMutex);
+				aheadDecoded = decoded;
+				if (!progress && decoded < target) {
+					// ȏi߂ȂiV[NI[AG[j
+					aheadStopped = true;
+				}
+			}
 		}
 	}
 
+	PVideoFrame DecodeFrame(int n, IScriptEnvironment* env)
+	{
+		PVideoFrame frame;
+
+		std::lock_guard<std::mutex> guard(mutex);
+
+		// bN҂̊Ԃɑ̃XbhfR[hȂ̂łx
+		if (frameCache.get(n, frame) || TakeAheadFrame(n, frame, env)) {
+			perfCtx.addPerfCounter(AMT_PERF_SOURCE_CACHE_HIT);
+			return frame;
+		}
+		perfCtx.addPerfCounter(AMT_PERF_SOURCE_CACHE_MISS);
+
+		// fR[hłȂt[͒ut[ɒu
+		if (failedMap.find(n) != failedMap.end()) {
+			n = failedMap[n];
+			if (frameCache.get(n, frame) || TakeAheadFrame(n, frame, env)) {
+				return frame;
+			}
+		}
+
+		// LbVɂȂ̂ŃfR[h
+		if (lastDecodeFrame != -1 && n > lastDecodeFrame && n < lastDecodeFrame + seekDistance) {
+			// Oɂ߂
+			DecodeLoop(n, env);
+		}
+		else {
+			// V[NăfR[h
+			// ǂ݂t[͂gȂ̂Ŏ̂Ă
+			aheadFrames.clear();
+			int keyNum = frames[n].keyFrame;
+			int gop = -1;
+			if (seekIndex.size() > 0) {
+				// OȑÕV[NŕĂGOPɃV[N
+				gop = GetGopIndex(n);
+				keyNum = seekIndex[seekIndex[gop].seekGop].keyFrame;
+			}
+			for (int i = 0; ; ++i) {
+				// ŏ̓CfbNXɂGOP擪̈ʒuA߂Ă蒼Ƃ̓t[̈ʒuɃV[N
+				int64_t fileOffset = (gop != -1 && i == 0)
+					? seekIndex[seekIndex[gop].seekGop].fileOffset
+					: frames[keyNum].fileOffset / 188 * 188;
+				perfCtx.addPerfCounter(AMT_PERF_SOURCE_SEEK);
+				if (av_seek_frame(inputCtx(), -1, fileOffset, AVSEEK_FLAG_BYTE) < 0) {
+					THROW(FormatException, "av_seek_frame failed");
+				}
+				ResetDecoder(env);
+				DecodeLoop(n, env);
+				if (frameCache.contains(n)) {
+					// fR[h
+					if (n - keyNum > seekDistance) {
+						seekDistance = n - keyNum;
+						UpdateCacheCapacity();
+					}
+					if (gop != -1) {
+						int seekGop = GetGopIndex(keyNum);
+						auto& entry = seekIndex[gop];
+						if (seekGop < entry.seekGop) {
+							// OGOPłȂƃfR[hłȂ̂ŊoĂ
+							entry.seekGop = seekGop;
+							entry.readyDistance = entry.keyFrame + entry.numFrames - seekIndex[seekGop].keyFrame;
+							seekIndexUpdated = true;
+						}
+					}
+					break;
+				}
+				if (keyNum <= 0) {
+					// ȏ߂Ȃ
+					// nlastDecodeFrame܂łfR[hsƂ
+					registerFailedFrames(n, lastDecodeFrame, lastDecodeFrame, env);
+					break;
+				}
+				if (lastDecodeFrame >= 0 && lastDecodeFrame < n) {
+					// f[^ȂăS[ɓBłȂ
+					// ̃t[͑SăfR[hsƂ
+					registerFailedFrames(lastDecodeFrame + 1, (int)frames.size(), lastDecodeFrame, env);
+					break;
+				}
+				if (i == 2) {
+					// fR[hs
+					// nlastDecodeFrame܂łfR[hsƂ
+					registerFailedFrames(n, lastDecodeFrame, lastDecodeFrame, env);
+					break;
+				}
+				keyNum -= std::max(5, keyNum - frames[keyNum - 1].keyFrame);
+			}
+		}
+		UpdateReadAheadPosition();
+
+		return ForceGetFrame(n, env);
+	}
+
 	int toAVSFormat(AVPixelFormat format, IScriptEnvironment* env)
 	{
 		// rbg[x擾
@@ -442,11 +1067,20 @@ class AMTSource : public IClip, AMTObject
 	}
 
 #if ENABLE_FFMPEG_FILTER
+	// ǂ݃Xbhienv==nullptrjĂ΂ӏ̃G[
+	void ThrowDecodeError(IScriptEnvironment* env, const char* message)
+	{
+		if (env == nullptr) {
+			THROWF(FormatException, "%s", message);
+		}
+		env->ThrowError(message);
+	}
+
 	void InputFrameFilter(Frame* frame, bool enableOut, IScriptEnvironment* env)
 	{
 		/* push the decoded frame into the filtergraph */
 		if (av_buffersrc_add_frame_flags(bufferSrcCtx, frame ? (*frame)() : nullptr, 0) < 0) {
-			env->ThrowError("av_buffersrc_add_frame_flags failed (Error while feeding the filtergraph)");
+			ThrowDecodeError(env, "av_buffersrc_add_frame_flags failed (Error while feeding the filtergraph)");
 		}
 
 		/* pull filtered frames from the filtergraph */
@@ -458,7 +1092,7 @@ class AMTSource : public IClip, AMTObject
 				break;
 			}
 			if (ret < 0) {
-				env->ThrowError("av_buffersink_get_frame failed");
+				ThrowDecodeError(env, "av_buffersink_get_frame failed");
 			}
 			if (enableOut) {
 				OnFrameOutput(filtered, env);
@@ -519,17 +1153,15 @@ class AMTSource : public IClip, AMTObject
 		}
 
 		int frameIndex = int(it - frames.begin());
-		auto cacheit = frameCache.find(frameIndex);
 
 		if (it->halfDelay) {
 			// fBCKp
-			if (cacheit != frameCache.end()) {
+			if (HasFrame(frameIndex)) {
 				// łɃLbVɂ
-				UpdateAccessed(cacheit->value);
 				lastDecodeFrame = frameIndex;
 			}
 			else if (prevFrame != nullptr) {
-				PutFrame(frameIndex, MakeFrame((*prevFrame)(), frame(), env));
+				OutputFrame(frameIndex, *prevFrame, frame, env);
 				lastDecodeFrame = frameIndex;
 			}
 			else {
@@ -539,25 +1171,22 @@ class AMTSource : public IClip, AMTObject
 			// ̃t[t[QƂĂ炻o
 			auto next = it + 1;
 			if (next != frames.end() && next->framePTS == it->framePTS) {
-				auto cachenext = frameCache.find(frameIndex + 1);
-				if (cachenext != frameCache.end()) {
+				if (HasFrame(frameIndex + 1)) {
 					// łɃLbVɂ
-					UpdateAccessed(cachenext->value);
 				}
 				else {
-					PutFrame(frameIndex + 1, MakeFrame(frame(), frame(), env));
+					OutputFrame(frameIndex + 1, frame, frame, env);
 				}
 				lastDecodeFrame = frameIndex + 1;
 			}
 		}
 		else {
 			// ̂܂
-			if (cacheit != frameCache.end()) {
+			if (HasFrame(frameIndex)) {
 				// łɃLbVɂ
-				UpdateAccessed(cacheit->value);
 			}
 			else {
-				PutFrame(frameIndex, MakeFrame(frame(), frame(), env));
+				OutputFrame(frameIndex, frame, frame, env);
 			}
 			lastDecodeFrame = frameIndex;
 		}
@@ -565,21 +1194,12 @@ class AMTSource : public IClip, AMTObject
 		prevFrame = std::unique_ptr<Frame>(new Frame(frame));
 	}
 
-	void UpdateAccessed(CacheFrame* frame) {
-		recentAccessed.erase(recentAccessed.it(&frame->listNode));
-		recentAccessed.push_front(&frame->listNode);
-	}
-
 	PVideoFrame ForceGetFrame(int n, IScriptEnvironment* env) {
-		if (frameCache.size() == 0) {
-			return env->NewVideoFrame(vi);
-		}
-		auto lb = frameCache.lower_bound(n);
-		if (lb->key != n && lb != frameCache.begin()) {
-			--lb;
+		PVideoFrame frame;
+		if (frameCache.get(n, frame) || frameCache.getNearest(n, frame)) {
+			return frame;
 		}
-		UpdateAccessed(lb->value);
-		return lb->value->data;
+		return env->NewVideoFrame(vi);
 	}
 
 	void DecodeLoop(int goal, IScriptEnvironment* env) {
@@ -645,6 +1265,37 @@ class AMTSource : public IClip, AMTObject
 #endif
 	}
 
+	// t[nGOP
+	int GetGopIndex(int n) const {
+		auto it = std::upper_bound(seekIndex.begin(), seekIndex.end(), n,
+			[](int n, const AMTSeekIndexEntry& e) { return n < e.keyFrame; });
+		return std::max(0, (int)(it - seekIndex.begin()) - 1);
+	}
+
+	void InitSeekIndex() {
+		if (seekIndex.size() == 0) return;
+		// CfbNX΃V[N͍ŏ番Ă
+		// ꂽXg[ő傫Ȃ肷Ȃ悤Ă
+		int maxDistance = 0;
+		for (const auto& entry : seekIndex) {
+			maxDistance = std::max(maxDistance, entry.readyDistance);
+		}
+		seekDistance = std::max(seekDistance, std::min(maxDistance, 300));
+	}
+
+	void SaveSeekIndex() {
+		if (!seekIndexOwner.isOwner()) return;
+		if (seekIndexUpdated) {
+			try {
+				SaveAMTSeekIndex(seekIndexPath, (int)frames.size(), seekIndex);
+			}
+			catch (const IOException&) {
+				// ۑłȂĂwKȂ̂Ŗ
+			}
+		}
+		seekIndexOwner.release();
+	}
+
 	void registerFailedFrames(int begin, int end, int replace, IScriptEnvironment* env)
 	{
 		for (int f = begin; f < end; ++f) {
@@ -659,6 +1310,7 @@ class AMTSource : public IClip, AMTObject
 
 public:
 	AMTSource(AMTContext& ctx,
+		AMTContext& perfCtx,
 		const tstring& srcpath,
 		const tstring& audiopath,
 		const VideoFormat& vfmt, const AudioFormat& afmt,
@@ -667,6 +1319,10 @@ public:
 		const DecoderSetting& decoderSetting,
 		const char* filterdesc,
 		bool outputQP,
+		size_t cacheBytes,
+		int readAheadFrames,
+		std::vector<AMTSeekIndexEntry>&& seekIndex,
+		const tstring& seekIndexPath,
 		IScriptEnvironment* env)
 		: AMTObject(ctx)
 		, frames(frames)
@@ -674,6 +1330,9 @@ public:
 		, audioFrames(audioFrames)
 		, filterdesc(filterdesc)
 		, outputQP(outputQP)
+		, cacheBytes(cacheBytes)
+		, avx2(IsAVX2Available())
+		, perfCtx(perfCtx)
 		, inputCtx(srcpath)
 		, vi()
 		, waveFile(audiopath, _T("rb"))
@@ -682,7 +1341,18 @@ public:
 		, bufferSinkCtx()
 #endif
 		, seekDistance(10)
+		, seekIndex(std::move(seekIndex))
+		, seekIndexPath(seekIndexPath)
+		, seekIndexUpdated(false)
+		, seekIndexOwner(seekIndexPath)
 		, lastDecodeFrame(-1)
+		, readAheadFrames(std::max(0, readAheadFrames))
+		, lastRequest(-SEQUENTIAL_RANGE * 2)
+		, numSequential(0)
+		, aheadTarget(-1)
+		, aheadDecoded(-1)
+		, aheadStopped(false)
+		, aheadFinished(false)
 	{
 #if !ENABLE_FFMPEG_FILTER
 		if (this->filterdesc.size()) {
@@ -702,16 +1372,14 @@ public:
 		// 
 		ResetDecoder(env);
 		UpdateVideoInfo(env);
+		InitSeekIndex();
+		StartReadAhead();
+		UpdateCacheCapacity();
 	}
 
 	~AMTSource() {
-		// LbV폜
-		while (recentAccessed.size() > 0) {
-			CacheFrame* pdel = recentAccessed.back().value;
-			frameCache.erase(frameCache.it(&pdel->treeNode));
-			recentAccessed.erase(recentAccessed.it(&pdel->listNode));
-			delete pdel;
-		}
+		StopReadAhead();
+		SaveSeekIndex();
 	}
 
 	void TransferStreamInfo(std::unique_ptr<AMTSourceData>&& streamInfo) {
@@ -720,68 +1388,26 @@ public:
 
 	PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env)
 	{
-		std::lock_guard<std::mutex> guard(mutex);
+		NotifyRequest(n);
 
-		// LbVɂΕԂ
-		auto it = frameCache.find(n);
-		if (it != frameCache.end()) {
-			UpdateAccessed(it->value);
-			return it->value->data;
+		// LbVɂΕԂifR[_̃bN͎Ȃj
+		PVideoFrame frame;
+		if (frameCache.get(n, frame)) {
+			perfCtx.addPerfCounter(AMT_PERF_SOURCE_CACHE_HIT);
+			return frame;
 		}
 
-		// fR[hłȂt[͒ut[ɒu
-		if (failedMap.find(n) != failedMap.end()) {
-			n = failedMap[n];
-		}
-
-		// LbVɂȂ̂ŃfR[h
-		if (lastDecodeFrame != -1 && n > lastDecodeFrame && n < lastDecodeFrame + seekDistance) {
-			// Oɂ߂
-			DecodeLoop(n, env);
-		}
-		else {
-			// V[NăfR[h
-			int keyNum = frames[n].keyFrame;
-			for (int i = 0; ; ++i) {
-				int64_t fileOffset = frames[keyNum].fileOffset / 188 * 188;
-				if (av_seek_frame(inputCtx(), -1, fileOffset, AVSEEK_FLAG_BYTE) < 0) {
-					THROW(FormatException, "av_seek_frame failed");
-				}
-				ResetDecoder(env);
-				DecodeLoop(n, env);
-				if (frameCache.find(n) != frameCache.end()) {
-					// fR[h
-					seekDistance = std::max(seekDistance, n - keyNum);
-					break;
-				}
-				if (keyNum <= 0) {
-					// ȏ߂Ȃ
-					// nlastDecodeFrame܂łfR[hsƂ
-					registerFailedFrames(n, lastDecodeFrame, lastDecodeFrame, env);
-					break;
-				}
-				if (lastDecodeFrame >= 0 && lastDecodeFrame < n) {
-					// f[^ȂăS[ɓBłȂ
-					// ̃t[͑SăfR[hsƂ
-					registerFailedFrames(lastDecodeFrame + 1, (int)frames.size(), lastDecodeFrame, env);
-					break;
-				}
-				if (i == 2) {
-					// fR[hs
-					// nlastDecodeFrame܂łfR[hsƂ
-					registerFailedFrames(n, lastDecodeFrame, lastDecodeFrame, env);
-					break;
-				}
-				keyNum -= std::max(5, keyNum - frames[keyNum - 1].keyFrame);
-			}
-		}
-
-		return ForceGetFrame(n, env);
+		// fR[h҂ԂL^
+		Stopwatch sw;
+		sw.start();
+		frame = DecodeFrame(n, env);
+		perfCtx.addPerfCounter(AMT_PERF_SOURCE_DECODE_STALL, (int64_t)(sw.current() * 1000000));
+		return frame;
 	}
 
 	void __stdcall GetAudio(void* buf, __int64 start, __int64 count, IScriptEnvironment* env)
 	{
-		std::lock_guard<std::mutex> guard(mutex);
+		std::lock_guard<std::mutex> guard(audioMutex);
 
 		if (audioFrames.size() == 0) return;
 
@@ -831,8 +1457,11 @@ public:
 };
 
 AMTContext* g_ctx_for_plugin_filter = nullptr;
+// AMTSourcẽptH[}Xv̏WvinullptrȂg_ctx_for_plugin_filterj
+AMTContext* g_ctx_for_perf_counter = nullptr;
 
 void SaveAMTSource(
+	AMTContext& ctx,
 	const tstring& savepath,
 	const tstring& srcpath,
 	const tstring& audiopath,
@@ -849,9 +1478,19 @@ void SaveAMTSource(
 	file.writeArray(frames);
 	file.writeArray(audioFrames);
 	file.writeValue(decoderSetting);
+
+	// V[NCfbNXꏏɕۑ
+	// CfbNXȂĂt[񂩂V[Nł̂ŁAۑłȂĂ
+	try {
+		SaveAMTSeekIndex(GetAMTSeekIndexPath(savepath), (int)frames.size(), BuildAMTSeekIndex(frames));
+	}
+	catch (const IOException& e) {
+		ctx.warnF("V[NCfbNXۑł܂ł: %s", e.message());
+	}
 }
 
-PClip LoadAMTSource(const tstring& loadpath, const char* filterdesc, bool outputQP, IScriptEnvironment* env)
+PClip LoadAMTSource(const tstring& loadpath, const char* filterdesc, bool outputQP,
+	size_t cacheBytes, int readAheadFrames, IScriptEnvironment* env)
 {
 	File file(loadpath, _T("rb"));
 	auto& srcpathv = file.readArray<tchar>();
@@ -864,8 +1503,12 @@ PClip LoadAMTSource(const tstring& loadpath, const char* filterdesc, bool output
 	data->frames = file.readArray<FilterSourceFrame>();
 	data->audioFrames = file.readArray<FilterAudioFrame>();
 	DecoderSetting decoderSetting = file.readValue<DecoderSetting>();
-	AMTSource* src = new AMTSource(*g_ctx_for_plugin_filter,
-		srcpath, audiopath, vfmt, afmt, data->frames, data->audioFrames, decoderSetting, filterdesc, outputQP, env);
+	tstring seekIndexPath = GetAMTSeekIndexPath(loadpath);
+	auto seekIndex = LoadAMTSeekIndex(seekIndexPath, (int)data->frames.size());
+	AMTContext* perfCtx = (g_ctx_for_perf_counter != nullptr) ? g_ctx_for_perf_counter : g_ctx_for_plugin_filter;
+	AMTSource* src = new AMTSource(*g_ctx_for_plugin_filter, *perfCtx,
+		srcpath, audiopath, vfmt, afmt, data->frames, data->audioFrames, decoderSetting, filterdesc, outputQP,
+		cacheBytes, readAheadFrames, std::move(seekIndex), seekIndexPath, env);
 	src->TransferStreamInfo(std::move(data));
 	return src;
 }
@@ -878,7 +1521,11 @@ AVSValue CreateAMTSource(AVSValue args, void* user_data, IScriptEnvironment* env
 	tstring filename = to_tstring(args[0].AsString());
 	const char* filterdesc = args[1].AsString("");
 	bool outputQP = args[2].AsBool(true);
-	return LoadAMTSource(filename, filterdesc, outputQP, env);
+	// LbVe(MB) 0ȂV[N玩
+	size_t cacheBytes = (size_t)std::max(0, args[3].AsInt(0)) * 1024 * 1024;
+	// ǂ݃t[ 0Ȃǂ݂Ȃ
+	int readAheadFrames = args[4].AsInt(0);
+	return LoadAMTSource(filename, filterdesc, outputQP, cacheBytes, readAheadFrames, env);
 }
 
 class AVSLosslessSource : public IClip
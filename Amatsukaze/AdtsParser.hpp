@@ -428,9 +428,12 @@ private:
 class DualMonoSplitter : AMTObject
 {
 public:
-	DualMonoSplitter(AMTContext& ctx)
+	// parseOnly: fR[hɃrbgXg[̍\͂ŃGgʒu𓾂
+	//   falseɂƏ]ʂtfR[hireXgpj
+	DualMonoSplitter(AMTContext& ctx, bool parseOnly = true)
 		: AMTObject(ctx)
 		, hAacDec(NULL)
+		, parseOnly(parseOnly)
 	{ }
 
 	~DualMonoSplitter() {
@@ -443,16 +446,17 @@ public:
 		if (!header.parse(frame.data, (int)frame.length)) {
 			THROW(FormatException, "[DualMonoSplitter] wb_parsełȂ");
 		}
-		// Xg[͖͂̂ʓ|Ȃ̂ŃfR[hႤ
+		// Gg̈ʒufaad̍\͊ŋ߂
+		// parseOnlyȂtʎqtB^oN̓XLbv
 		if (hAacDec == NULL) {
 			resetDecoder(MemoryChunk(frame.data, frame.length));
 		}
 		NeAACDecFrameInfo frameInfo;
-		void* samples = NeAACDecDecode(hAacDec, &frameInfo, frame.data, (int)frame.length);
+		parseFrame(&frameInfo, frame);
 		if (frameInfo.error != 0) {
 			// ł͑vƂ͎vǈꉞG[΍͂Ă
 			resetDecoder(MemoryChunk(frame.data, frame.length));
-			samples = NeAACDecDecode(hAacDec, &frameInfo, frame.data, (int)frame.length);
+			parseFrame(&frameInfo, frame);
 		}
 		if (frameInfo.error == 0) {
 			if (frameInfo.fr_ch_ele != 2) {
@@ -512,8 +516,18 @@ public:
 
 private:
 	NeAACDecHandle hAacDec;
+	bool parseOnly;
 	AutoBuffer buf;
 
+	void parseFrame(NeAACDecFrameInfo* frameInfo, MemoryChunk frame) {
+		if (parseOnly) {
+			NeAACDecParseElements(hAacDec, frameInfo, frame.data, (unsigned long)frame.length);
+		}
+		else {
+			NeAACDecDecode(hAacDec, frameInfo, frame.data, (unsigned long)frame.length);
+		}
+	}
+
 	void closeDecoder() {
 		if (hAacDec != NULL) {
 			NeAACDecClose(hAacDec);
@@ -52,7 +52,7 @@ extern "C" __declspec(dllexport) const char* __stdcall AvisynthPluginInit3(IScri
 		g_av_initialized = true;
 	}
 
-	env->AddFunction("AMTSource", "s[filter]s[outqp]b", av::CreateAMTSource, 0);
+	env->AddFunction("AMTSource", "s[filter]s[outqp]b[cachesize]i[readahead]i", av::CreateAMTSource, 0);
 
 	env->AddFunction("AMTAnalyzeLogo", "cs[maskratio]i", logo::AMTAnalyzeLogo::Create, 0);
 	env->AddFunction("AMTEraseLogo", "ccs[logof]s[mode]i[maxfade]i", logo::AMTEraseLogo::Create, 0);
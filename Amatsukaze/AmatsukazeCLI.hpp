@@ -42,12 +42,17 @@ static void printHelp(const tchar* bin) {
 		"                      w肪Ȃꍇ̓rbg[gIvVǉȂ\n"
 		"  -bcm|--bitrate-cm <float>   CM肳ꂽƂ̃rbg[g{\n"
 		"  --2pass             2passGR[h\n"
+		"  --2pass-frame-cache <MB> 2passGR[h1pXڂ̃tB^o͂𒆊ԃt@C\n"
+		"                      ۑ2pXڂŎgBweʂ𒴂LbVȂ[0]\n"
 		"  --splitsub          CȊÕtH[}bg͌Ȃ\n"
 		"  -aet|--audio-encoder-type <^Cv> GR[_[]"
 		"                      ΉGR[_: neroAac, qaac, fdkaac\n"
 		"                      w肵ȂΉ̓GR[hȂ\n"
 		"  -ae|--audio-encoder <pX> GR[_[]"
 		"  -aeo|--audio-encoder-option <IvV> GR[_֓nIvV[]\n"
+		"  --parallel-audio-encode GR[hfGR[hƕɍs\n"
+		"  --encode-segments <l> fw萔̋Ԃɕĕ̃GR[_ŕ\n"
+		"                      GR[hix264/x2651pX̂݁j[1]\n"
 		"  -fmt|--format <tH[}bg> o̓tH[}bg[mp4]\n"
 		"                      ΉtH[}bg: mp4,mkv,m2ts,ts\n"
 		"  -m|--muxer  <pX>  L-SMASHmuxer܂mkvmerge܂tsMuxeRւ̃pX[muxer.exe]\n"
@@ -59,6 +64,15 @@ static void printHelp(const tchar* bin) {
 		"                      gp\fR[_: default,QSV,CUVID\n"
 		"  --h264decoder <fR[_>  H264pfR[_[default]\n"
 		"                      gp\fR[_: default,QSV,CUVID\n"
+		"  --mmap-input        TS͂œ̓t@C}bvēǂݍ\n"
+		"  --pipelined-split   TS͂ǂݍ݁EU蕪Ef/́Eo͂ɕ\n"
+		"                      ɏi--mmap-inputDj\n"
+		"                      ̉Xg[̕fR[h̃[hł̂ݍs\n"
+		"  --unbuffered-split-output TS͂̒ԃt@COS̃LbVʂɏ\n"
+		"  --source-cache-size <l> AMTSourcẽt[LbVe(MB)[0]\n"
+		"                      0̏ꍇ̓V[N玩Ō߂\n"
+		"  --source-read-ahead <l> AMTSourceŘAANZXɕʃXbhŐǂ݂\n"
+		"                      t[[0]i0Őǂ݂Ȃj\n"
 		"  --chapter           `v^[ECM͂s\n"
 		"  --subtitles         \n"
 		"  --nicojk            jRjRRgǉ\n"
@@ -72,6 +86,8 @@ static void printHelp(const tchar* bin) {
 		"  --loose-logo-detection So肵lႭ܂\n"
 		"  --max-fade-length <l> S̍őtF[ht[[16]\n"
 		"  --chapter-exe <pX> chapter_exe.exeւ̃pX\n"
+		"  --internal-chapter-exe EV[`FW͂chapter_exe.exeg킸\n"
+		"                      S͂ƓfR[hʂōs\n"
 		"  --jls <pX>         join_logo_scp.exeւ̃pX\n"
 		"  --jls-cmd <pX>    join_logo_scp̃R}ht@Cւ̃pX\n"
 		"  --jls-option <IvV>    join_logo_scp̃R}ht@Cւ̃pX\n"
@@ -248,6 +264,12 @@ static std::unique_ptr<ConfigWrapper> parseArgs(AMTContext& ctx, int argc, const
 		else if (key == _T("-ab") || key == _T("--audio-bitrate")) {
 			conf.audioBitrateInKbps = std::stoi(getParam(argc, argv, i++));
 		}
+		else if (key == _T("--parallel-audio-encode")) {
+			conf.parallelAudioEncode = true;
+		}
+		else if (key == _T("--encode-segments")) {
+			conf.numEncodeSegments = std::stoi(getParam(argc, argv, i++));
+		}
 		else if (key == _T("-b") || key == _T("--bitrate")) {
 			const auto arg = getParam(argc, argv, i++);
 			int ret = sscanfT(arg.c_str(), _T("%lf:%lf:%lf:%lf"),
@@ -270,6 +292,9 @@ static std::unique_ptr<ConfigWrapper> parseArgs(AMTContext& ctx, int argc, const
 		else if (key == _T("--2pass")) {
 			conf.twoPass = true;
 		}
+		else if (key == _T("--2pass-frame-cache")) {
+			conf.twoPassFrameCacheSize = std::stoi(getParam(argc, argv, i++));
+		}
 		else if (key == _T("--splitsub")) {
 			conf.splitSub = true;
 		}
@@ -343,6 +368,21 @@ static std::unique_ptr<ConfigWrapper> parseArgs(AMTContext& ctx, int argc, const
 				PRINTF("--h264decoder̎w肪ԈĂ܂: %" PRITSTR "\n", arg.c_str());
 			}
 		}
+		else if (key == _T("--mmap-input")) {
+			conf.mmapInput = true;
+		}
+		else if (key == _T("--pipelined-split")) {
+			conf.pipelinedSplit = true;
+		}
+		else if (key == _T("--unbuffered-split-output")) {
+			conf.unbufferedSplitOutput = true;
+		}
+		else if (key == _T("--source-cache-size")) {
+			conf.sourceCacheSize = std::stoi(getParam(argc, argv, i++));
+		}
+		else if (key == _T("--source-read-ahead")) {
+			conf.sourceReadAhead = std::stoi(getParam(argc, argv, i++));
+		}
 		else if (key == _T("-eb") || key == _T("--encode-buffer")) {
 			conf.numEncodeBufferFrames = std::stoi(getParam(argc, argv, i++));
 		}
@@ -388,6 +428,9 @@ static std::unique_ptr<ConfigWrapper> parseArgs(AMTContext& ctx, int argc, const
 		else if (key == _T("--chapter-exe")) {
 			conf.chapterExePath = pathNormalize(getParam(argc, argv, i++));
 		}
+		else if (key == _T("--internal-chapter-exe")) {
+			conf.internalChapterExe = true;
+		}
 		else if (key == _T("--chapter-exe-options")) {
 			conf.chapterExeOptions = getParam(argc, argv, i++);
 		}
@@ -621,6 +664,8 @@ static int amatsukazeTranscodeMain(AMTContext& ctx, const ConfigWrapper& setting
 			test::PrintCRCTable(ctx, setting);
 		else if (mode == _T("test_crc"))
 			test::CheckCRC(ctx, setting);
+		else if (mode == _T("test_crc_perf"))
+			test::CRC32Performance(ctx, setting);
 		else if (mode == _T("test_read_bits"))
 			test::ReadBits(ctx, setting);
 		else if (mode == _T("test_auto_buffer"))
@@ -643,8 +688,38 @@ static int amatsukazeTranscodeMain(AMTContext& ctx, const ConfigWrapper& setting
 			test::LosslessFileTest(ctx, setting);
 		else if (mode == _T("test_logoframe"))
 			test::LogoFrameTest(ctx, setting);
+		else if (mode == _T("test_logo_eval"))
+			test::LogoEvaluatePerformance(ctx, setting);
+		else if (mode == _T("test_sliding_window"))
+			test::SlidingWindowFilter(ctx, setting);
+		else if (mode == _T("test_mergefield_perf"))
+			test::MergeFieldPerformance(ctx, setting);
+		else if (mode == _T("test_h264_nal"))
+			test::H264NalScanner(ctx, setting);
+		else if (mode == _T("test_startcode_perf"))
+			test::StartCodeSearchPerformance(ctx, setting);
+		else if (mode == _T("test_bitreader_perf"))
+			test::BitReaderPerformance(ctx, setting);
+		else if (mode == _T("test_segmented_encode"))
+			test::SegmentedEncode(ctx, setting);
+		else if (mode == _T("test_frame_cache"))
+			test::FrameCache(ctx, setting);
+		else if (mode == _T("test_pump_perf"))
+			test::DataPumpPerformance(ctx, setting);
+		else if (mode == _T("test_chapter_exe"))
+			test::ChapterExeInternal(ctx, setting);
+		else if (mode == _T("test_filecutter"))
+			test::FileCutterTs(ctx, setting);
+		else if (mode == _T("test_async_writer"))
+			test::AsyncFileWriterTest(ctx, setting);
+		else if (mode == _T("test_ts_direct"))
+			test::TsPacketDirect(ctx, setting);
+		else if (mode == _T("test_pipelined_split"))
+			test::PipelinedSplit(ctx, setting);
 		else if (mode == _T("test_dualmono"))
 			test::SplitDualMonoAAC(ctx, setting);
+		else if (mode == _T("test_dualmono_parse"))
+			test::SplitDualMonoParseOnly(ctx, setting);
 		else if (mode == _T("test_aacdecode"))
 			test::AACDecodeTest(ctx, setting);
 		else if (mode == _T("test_ass"))
@@ -710,6 +785,13 @@ __declspec(dllexport) int AmatsukazeCLI(int argc, const wchar_t* argv[]) {
 		// LvVDLL
 		InitializeCPW();
 
+		// AMTSourcẽptH[}XṽReLXgɏWv
+		// iG[v̓vOC̃ReLXĝ܂܁j
+		// OŔĂjꂽctxw܂܂ɂȂȂ悤fXgN^Ŗ߂
+		struct PerfContextScope {
+			PerfContextScope(AMTContext* ctx) { av::g_ctx_for_perf_counter = ctx; }
+			~PerfContextScope() { av::g_ctx_for_perf_counter = nullptr; }
+		} perfContextScope(&ctx);
 		return amatsukazeTranscodeMain(ctx, *setting);
 	}
 	catch (const Exception&) {
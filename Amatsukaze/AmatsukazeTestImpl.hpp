@@ -9,6 +9,7 @@
 
 #include "TranscodeManager.hpp"
 #include "LogoScan.hpp"
+#include "../FileCutter/FileCutter.hpp"
 
 namespace test {
 
@@ -51,6 +52,50 @@ static int CheckCRC(AMTContext& ctx, const ConfigWrapper& setting)
 	return 0;
 }
 
+// slicing-by-8/PCLMULQDQł1oCg̃e[ułƈv邩{x
+static int CRC32Performance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	CRC32 crc;
+
+	const int bufSize = 16 * 1024 * 1024;
+	std::vector<uint8_t> buf(bufSize + 64);
+	srand(0);
+	for (auto& b : buf) b = uint8_t(rand());
+
+	// AACgAl낢ςĔr
+	for (int i = 0; i < 100000; ++i) {
+		int offset = rand() % 64;
+		int length = (i < 1000) ? rand() % bufSize : rand() % 4096;
+		uint32_t init = (uint32_t(rand()) << 16) ^ uint32_t(rand());
+		uint32_t ref = crc.calcBytewise(buf.data() + offset, length, init);
+		if (crc.calcSlicing8(buf.data() + offset, length, init) != ref ||
+			crc.calc(buf.data() + offset, length, init) != ref)
+		{
+			THROWF(TestException, "CRC mismatch (offset=%d,length=%d)", offset, length);
+		}
+	}
+
+	const double MB = bufSize / (1024.0 * 1024.0);
+	const int numLoops = 10;
+	Stopwatch sw;
+	double times[3] = { 0 };
+	for (int i = 0; i < numLoops; ++i) {
+		sw.start();
+		crc.calcBytewise(buf.data(), bufSize, 0xFFFFFFFFUL);
+		times[0] += sw.getAndReset();
+		crc.calcSlicing8(buf.data(), bufSize, 0xFFFFFFFFUL);
+		times[1] += sw.getAndReset();
+		crc.calc(buf.data(), bufSize, 0xFFFFFFFFUL);
+		times[2] += sw.getAndReset();
+	}
+	const char* names[] = { "Byte", "Slicing8", IsPCLMULQDQAvailable() ? "PCLMULQDQ" : "Slicing8(calc)" };
+	for (int i = 0; i < 3; ++i) {
+		printf("%s: %f MB/s\n", names[i], MB * numLoops / times[i]);
+	}
+
+	return 0;
+}
+
 static int ReadBits(AMTContext& ctx, const ConfigWrapper& setting)
 {
 	uint8_t data[16];
@@ -68,6 +113,238 @@ static int ReadBits(AMTContext& ctx, const ConfigWrapper& setting)
 	return 0;
 }
 
+// rp: 1oCgfillȑOBitReader
+class BytewiseBitReader {
+public:
+	BytewiseBitReader(MemoryChunk data)
+		: data(data)
+		, offset(0)
+		, filled(0)
+	{
+		fill();
+	}
+
+	template <int bits>
+	uint32_t read() {
+		return readn(bits);
+	}
+
+	uint32_t readn(int bits) {
+		if (bits > filled) {
+			fill();
+			if (bits > filled) {
+				throw EOFException("BytewiseBitReader.readŃI[o[");
+			}
+		}
+		int shift = filled - bits;
+		filled -= bits;
+		return (uint32_t)bsm(current, shift, bits);
+	}
+
+	uint32_t readExpGolom() {
+		// ̎filled==64̂Ƃ}XN0ɂȂăI[o[ɂȂĂ̂ŏC
+		uint64_t masked = (filled < 64) ? bsm(current, 0, filled) : current;
+		if (masked == 0) {
+			fill();
+			masked = (filled < 64) ? bsm(current, 0, filled) : current;
+			if (masked == 0) {
+				throw EOFException("BytewiseBitReader.readExpGolomŃI[o[");
+			}
+		}
+		int bodyLen = filled - __builtin_clzl(masked);
+		filled -= bodyLen - 1;
+		if (bodyLen > filled) {
+			fill();
+			if (bodyLen > filled) {
+				throw EOFException("BytewiseBitReader.readExpGolomŃI[o[");
+			}
+		}
+		int shift = filled - bodyLen;
+		filled -= bodyLen;
+		return (uint32_t)bsm(current, shift, bodyLen) - 1;
+	}
+
+private:
+	MemoryChunk data;
+	int offset;
+	uint64_t current;
+	int filled;
+
+	void fill() {
+		while (filled + 8 <= 64 && offset < (int)data.length) {
+			current = (current << 8) | data.data[offset++];
+			filled += 8;
+		}
+	}
+};
+
+struct SliceHeaderData {
+	std::vector<uint8_t> data;
+	bool idr;
+};
+
+// XCXwb_̐擪ǂ
+template <typename Reader>
+static uint32_t ParseSliceHeader(const SliceHeaderData& slice, int log2MaxFrameNum, bool frameMbsOnly)
+{
+	Reader reader(MemoryChunk((uint8_t*)slice.data.data(), slice.data.size()));
+	uint32_t sum = reader.readExpGolom(); // first_mb_in_slice
+	sum += reader.readExpGolom(); // slice_type
+	sum += reader.readExpGolom(); // pic_parameter_set_id
+	sum += reader.readn(log2MaxFrameNum); // frame_num
+	if (!frameMbsOnly) {
+		if (reader.template read<1>()) { // field_pic_flag
+			sum += reader.template read<1>(); // bottom_field_flag
+		}
+	}
+	if (slice.idr) {
+		sum += reader.readExpGolom(); // idr_pic_id
+	}
+	return sum;
+}
+
+// BitReader̃[hPfillƎwS̊mF{H.264XCXwb_ł̑x
+static int BitReaderPerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	// _ȑňȑO̎Ɣr
+	srand(0);
+	std::vector<uint8_t> buf(256);
+	for (int i = 0; i < 20000; ++i) {
+		int length = rand() % (int)buf.size();
+		for (int c = 0; c < length; ++c) {
+			// 0𑽂߂ɂĒwSo悤ɂ
+			buf[c] = (rand() % 4) ? 0 : uint8_t(rand());
+		}
+		MemoryChunk mc(buf.data(), length);
+		BitReader reader(mc);
+		BytewiseBitReader ref(mc);
+		bool eof = false, refeof = false;
+		while (!eof && !refeof) {
+			uint32_t v = 0, refv = 0;
+			int bits = rand() % 32 + 1;
+			bool golomb = (rand() % 2) != 0;
+			try { v = golomb ? reader.readExpGolom() : reader.readn(bits); }
+			catch (const EOFException&) { eof = true; }
+			// 32bit𒴂镄͈ȑO̎ł͕slɂȂ̂ŔrȂ
+			catch (const FormatException&) { break; }
+			try { refv = golomb ? ref.readExpGolom() : ref.readn(bits); }
+			catch (const EOFException&) { refeof = true; }
+			if (eof != refeof || v != refv) {
+				THROWF(TestException, "BitReader mismatch (length=%d)", length);
+			}
+		}
+	}
+
+	std::vector<SliceHeaderData> slices;
+	int log2MaxFrameNum = 4;
+	bool frameMbsOnly = false;
+
+	tstring srcpath = setting.getSrcFilePath();
+	if (srcpath.size() > 0) {
+		// ۂTSXCXwb_o
+		using namespace av;
+		InputContext inputCtx(srcpath);
+		if (avformat_find_stream_info(inputCtx(), NULL) < 0) {
+			THROW(FormatException, "avformat_find_stream_info failed");
+		}
+		AVStream *videoStream = av::GetVideoStream(inputCtx());
+		if (videoStream == NULL || videoStream->codecpar->codec_id != AV_CODEC_ID_H264) {
+			THROW(FormatException, "Could not find H.264 stream ...");
+		}
+		AVPacket packet = AVPacket();
+		while (slices.size() < 100000 && av_read_frame(inputCtx(), &packet) == 0) {
+			if (packet.stream_index == videoStream->index) {
+				const uint8_t* data = packet.data;
+				int length = packet.size;
+				for (int i = 0; i + 4 < length; ++i) {
+					if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) continue;
+					int nalType = data[i + 3] & 0x1F;
+					int end = std::min(length, i + 4 + 64);
+					// G~[Vh~oCg菜
+					std::vector<uint8_t> rbsp;
+					for (int k = i + 4; k < end; ++k) {
+						if (k >= i + 6 && data[k] == 3 && data[k - 1] == 0 && data[k - 2] == 0) continue;
+						rbsp.push_back(data[k]);
+					}
+					if (nalType == 7) {
+						H264SequenceParameterSet sps;
+						if (sps.parse(rbsp.data(), (int)rbsp.size())) {
+							log2MaxFrameNum = sps.log2_max_frame_num_minus4 + 4;
+							frameMbsOnly = (sps.frame_mbs_only_flag != 0);
+						}
+					}
+					else if (nalType == 1 || nalType == 5) {
+						slices.push_back(SliceHeaderData{ rbsp, nalType == 5 });
+					}
+				}
+			}
+			av_packet_unref(&packet);
+		}
+	}
+	else {
+		// 1080i1t[8XCXۂXCXwb_
+		auto writeExpGolom = [](BitWriter& writer, uint32_t v) {
+			uint64_t code = uint64_t(v) + 1;
+			int len = __builtin_clzl(code) + 1; // ŏʃrbg̈ʒu+1
+			if (len > 1) {
+				writer.writen(0, len - 1);
+			}
+			writer.writen((uint32_t)code, len);
+		};
+		for (int i = 0; i < 100000; ++i) {
+			AutoBuffer ab;
+			BitWriter writer(ab);
+			bool idr = (i % 240) < 8;
+			writeExpGolom(writer, (i % 8) * 510); // first_mb_in_slice
+			writeExpGolom(writer, idr ? 7 : (rand() % 3 == 0) ? 5 : 6); // slice_type
+			writeExpGolom(writer, 0); // pic_parameter_set_id
+			writer.writen(i / 8, log2MaxFrameNum); // frame_num
+			writer.writen(1, 1); // field_pic_flag
+			writer.writen(i & 1, 1); // bottom_field_flag
+			if (idr) {
+				writeExpGolom(writer, i / 240); // idr_pic_id
+			}
+			// ȍ~̃XCXf[^
+			for (int k = 0; k < 8; ++k) {
+				writer.writen(rand(), 32);
+			}
+			writer.byteAlign<1>();
+			writer.flush();
+			slices.push_back(SliceHeaderData{ std::vector<uint8_t>(ab.ptr(), ab.ptr() + ab.size()), idr });
+		}
+	}
+
+	if (slices.size() == 0) {
+		THROW(FormatException, "No slice ...");
+	}
+
+	const int numLoops = 20;
+	Stopwatch sw;
+	uint32_t sums[2] = { 0 };
+	double times[2] = { 0 };
+	for (int i = 0; i < numLoops; ++i) {
+		sw.start();
+		for (const auto& slice : slices) {
+			sums[0] += ParseSliceHeader<BytewiseBitReader>(slice, log2MaxFrameNum, frameMbsOnly);
+		}
+		times[0] += sw.getAndReset();
+		for (const auto& slice : slices) {
+			sums[1] += ParseSliceHeader<BitReader>(slice, log2MaxFrameNum, frameMbsOnly);
+		}
+		times[1] += sw.getAndReset();
+	}
+	printf("%d slice headers\n", (int)slices.size());
+	const char* names[] = { "Bytewise", "Word" };
+	for (int i = 0; i < 2; ++i) {
+		printf("%s: %.2f M headers/s\n", names[i], slices.size() * numLoops / times[i] / 1000000.0);
+	}
+	if (sums[0] != sums[1]) {
+		THROW(TestException, "slice header mismatch");
+	}
+
+	return 0;
+}
+
 static int CheckAutoBuffer(AMTContext& ctx, const ConfigWrapper& setting)
 {
 	srand(0);
@@ -442,7 +719,300 @@ static int LogoFrameTest(AMTContext& ctx, const ConfigWrapper& setting)
 		ctx.infoF("BestLogo: %s\n", setting.getLogoPath()[logof.getBestLogo()].c_str());
 		ctx.infoF("LogoRatio: %f\n", logof.getLogoRatio());
 	}
+	{
+		// XĽʂVAƈv邩mF
+		auto env = make_unique_ptr(CreateScriptEnvironment2());
+		PClip clip = env->Invoke("Import", to_string(setting.getFilterScriptPath()).c_str()).AsClip();
+
+		logo::LogoFrame serial(ctx, setting.getLogoPath(), 0.1f);
+		logo::LogoFrame parallel(ctx, setting.getLogoPath(), 0.1f);
+		Stopwatch sw;
+		sw.start();
+		serial.scanFrames(clip, env.get(), 1);
+		double serialTime = sw.getAndReset();
+		parallel.scanFrames(clip, env.get(), std::max(2, GetProcessorCount()));
+		double parallelTime = sw.getAndReset();
+		ctx.infoF("Serial: %f sec, Parallel: %f sec", serialTime, parallelTime);
+
+		auto readText = [](const tstring& path) {
+			File file(path, _T("rb"));
+			std::vector<uint8_t> buf((size_t)file.size());
+			file.read(MemoryChunk(buf.data(), buf.size()));
+			return buf;
+		};
+		for (int i = 0; i < (int)setting.getLogoPath().size(); ++i) {
+			tstring serialPath = setting.getTmpLogoFramePath(0, i);
+			tstring parallelPath = setting.getTmpLogoFramePath(1, i);
+			serial.writeResult(serialPath, i);
+			parallel.writeResult(parallelPath, i);
+			if (readText(serialPath) != readText(parallelPath)) {
+				THROW(TestException, "parallel logo scan result mismatch");
+			}
+		}
+		serial.selectLogo();
+		parallel.selectLogo();
+		if (serial.getBestLogo() != parallel.getBestLogo() ||
+			serial.getLogoRatio() != parallel.getLogoRatio())
+		{
+			THROW(TestException, "parallel logo scan best logo mismatch");
+		}
+	}
+
+	return 0;
+}
+
+// fadel̈ꊇ]Ə]fadelƂ̕]r
+static int LogoEvaluatePerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	LogoHeader header;
+	logo::LogoDataParam logo(LogoData::Load(setting.getLogoPath()[0], &header), &header);
+	logo.CreateLogoMask(0.1f);
+
+	const int numFrames = 200;
+	const int numFade = 20;
+	const float maxv = 255.0f;
+	int w = header.w;
+	int h = header.h;
+
+	// PFwi+mCYÃt[ɂ̓S悹
+	std::vector<std::vector<float>> frames(numFrames);
+	const float *logoAY = logo.GetA(PLANAR_Y);
+	const float *logoBY = logo.GetB(PLANAR_Y);
+	srand(0);
+	for (int i = 0; i < numFrames; ++i) {
+		auto& frame = frames[i];
+		frame.resize(w * h + 8);
+		float bg = (float)(16 + rand() % 220);
+		for (int p = 0; p < w * h; ++p) {
+			float v = bg + (rand() % 9) - 4;
+			if ((i % 2) && logoAY[p] > 0) {
+				v = (v - logoBY[p] * maxv) / logoAY[p];
+			}
+			frame[p] = std::max(0.0f, std::min(maxv, v));
+		}
+	}
+
+	float fades[numFade];
+	for (int fi = 0; fi < numFade; ++fi) {
+		fades[fi] = 0.1f * fi;
+	}
+	auto memWork = std::unique_ptr<float[]>(new float[w * h * 2 + 8]);
+	std::vector<float> resultSingle(numFrames * numFade);
+	std::vector<float> resultMulti(numFrames * numFade);
+
+	Stopwatch sw;
+	sw.start();
+	for (int i = 0; i < numFrames; ++i) {
+		for (int fi = 0; fi < numFade; ++fi) {
+			resultSingle[i * numFade + fi] = logo.EvaluateLogo(frames[i].data(), maxv, fades[fi], memWork.get());
+		}
+	}
+	double single = sw.getAndReset();
+	for (int i = 0; i < numFrames; ++i) {
+		logo.EvaluateLogoMulti(frames[i].data(), maxv, fades, numFade, &resultMulti[i * numFade], memWork.get());
+	}
+	double multi = sw.getAndReset();
+
+	float maxDiff = 0;
+	for (int i = 0; i < numFrames * numFade; ++i) {
+		maxDiff = std::max(maxDiff, std::abs(resultSingle[i] - resultMulti[i]));
+	}
+	printf("%dx%d %d frames x %d fades\n", w, h, numFrames, numFade);
+	printf("EvaluateLogo: %f sec, EvaluateLogoMulti: %f sec (x%.1f) max diff: %g\n",
+		single, multi, single / multi, maxDiff);
+
+	// vZقȂ̂ŊSɂ͈vȂ
+	if (maxDiff > 0.01f) {
+		THROW(TestException, "EvaluateLogoMulti result mismatch");
+	}
+
+	return 0;
+}
+
+// LogoFrame::writeResult̃tB^iXCfBOEBhEj]̑S͈͌vZƈv邩mF
+// ̃Sԏo͂ɒʂĔr
+static int SlidingWindowFilter(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	typedef logo::LogoFrame::FrameResult FrameResult;
+	const int numFrames = 100000;
+	const float THRESH = 0.2f;
+	const float threshL = 0.5f;
+
+	// S/Ȃ+mCYAlԋԂ
+	std::vector<float> raw(numFrames);
+	srand(0);
+	float level = 0;
+	for (int i = 0; i < numFrames; ++i) {
+		if ((rand() % 500) == 0) {
+			level = (level > 0) ? -0.8f : 0.8f;
+		}
+		raw[i] = ((rand() % 10) == 0) ? level : level + ((rand() % 2001) - 1000) / 1000.0f;
+	}
+
+	for (int fps = 24; fps <= 60; fps += 12) {
+		// ]writeResult̃tB^
+		int halfAvgFrames = int(fps * 1.0f / 2 + 0.5f);
+		int aveFrames = halfAvgFrames * 2 + 1;
+		int halfMedianFrames = int(fps * 0.5f / 2 + 0.5f);
+		int medianFrames = halfMedianFrames * 2 + 1;
+		int halfWinFrames = std::max(aveFrames, medianFrames) / 2;
+		std::vector<float> padded_(numFrames + halfWinFrames * 2 + 1);
+		auto rawScores = padded_.begin() + halfWinFrames;
+		std::copy(raw.begin(), raw.end(), rawScores);
+		std::fill(padded_.begin(), rawScores, raw.front());
+		std::fill(rawScores + numFrames, padded_.end(), raw.back());
+
+		std::vector<FrameResult> resultRef(numFrames);
+
+		Stopwatch sw;
+		sw.start();
+		std::vector<float> medianBuf(medianFrames);
+		for (int i = 0; i < numFrames; ++i) {
+			float beforeMax = *std::max_element(rawScores + i - halfAvgFrames, rawScores + i);
+			float afterMax = *std::max_element(rawScores + i + 1, rawScores + i + 1 + halfAvgFrames);
+			float minMax = std::min(beforeMax, afterMax);
+			int minMaxResult = (std::abs(minMax) < threshL) ? 1 : (minMax < 0.0f) ? 0 : 2;
+			float avg = std::accumulate(rawScores + i - halfAvgFrames,
+				rawScores + i + halfAvgFrames + 1, 0.0f) / aveFrames;
+			int avgResult = (std::abs(avg) < THRESH) ? 1 : (avg < 0.0f) ? 0 : 2;
+			resultRef[i].result = (minMaxResult != avgResult) ? 1 : minMaxResult;
+			std::copy(rawScores + i - halfMedianFrames,
+				rawScores + i + halfMedianFrames + 1, medianBuf.begin());
+			std::sort(medianBuf.begin(), medianBuf.end());
+			resultRef[i].score = medianBuf[halfMedianFrames];
+		}
+		double refTime = sw.getAndReset();
+
+		// writeResultg
+		std::vector<FrameResult> resultNew = logo::LogoFrame::FilterScores(raw, fps, THRESH);
+		double newTime = sw.getAndReset();
+
+		printf("fps=%d: Ref: %f sec, Sliding: %f sec\n", fps, refTime, newTime);
+
+		if (resultNew.size() != resultRef.size()) {
+			THROW(TestException, "sliding window result size mismatch");
+		}
+		for (int i = 0; i < numFrames; ++i) {
+			if (resultRef[i].result != resultNew[i].result) {
+				THROWF(TestException, "sliding window result mismatch at %d", i);
+			}
+			if (resultRef[i].score != resultNew[i].score) {
+				THROWF(TestException, "sliding window median mismatch at %d", i);
+			}
+		}
+
+		// SԂ̏o͂܂ňv邱
+		StringBuilder sbRef, sbNew;
+		logo::LogoFrame::WriteSections(resultRef, THRESH, sbRef);
+		logo::LogoFrame::WriteSections(resultNew, THRESH, sbNew);
+		if (sbRef.str() != sbNew.str()) {
+			THROW(TestException, "logo section output mismatch");
+		}
+		if (sbNew.str().size() == 0) {
+			THROW(TestException, "no logo section found");
+		}
+	}
+
+	return 0;
+}
+
+template <typename T>
+static void MergeFieldPerformanceT(int bitDepth)
+{
+	using namespace av;
+
+	const int width = 1920;
+	const int height = 1080;
+	const int widthUV = width / 2;
+	const int heightUV = height / 2;
+	const int pitch = 2048; // FFmpeglinesize
+	const int numLoops = 100;
+	const bool avx2 = IsAVX2Available();
+
+	// 1C̃Rs[
+	auto Copy1 = [](T* dst, const T* top, const T* bottom, int w, int h, int dpitch, int tpitch, int bpitch) {
+		for (int y = 0; y < h; y += 2) {
+			memcpy(dst + dpitch * (y + 0), top + tpitch * (y + 0), sizeof(T) * w);
+			memcpy(dst + dpitch * (y + 1), bottom + bpitch * (y + 1), sizeof(T) * w);
+		}
+	};
+	auto Copy2 = [](T* dstU, T* dstV, const T* top, const T* bottom, int w, int h, int dpitch, int tpitch, int bpitch) {
+		for (int y = 0; y < h; y += 2) {
+			T* dstU0 = dstU + dpitch * (y + 0);
+			T* dstU1 = dstU + dpitch * (y + 1);
+			T* dstV0 = dstV + dpitch * (y + 0);
+			T* dstV1 = dstV + dpitch * (y + 1);
+			const T* src0 = top + tpitch * (y + 0);
+			const T* src1 = bottom + bpitch * (y + 1);
+			for (int x = 0; x < w; ++x) {
+				dstU0[x] = src0[x * 2 + 0];
+				dstV0[x] = src0[x * 2 + 1];
+				dstU1[x] = src1[x * 2 + 0];
+				dstV1[x] = src1[x * 2 + 1];
+			}
+		}
+	};
+
+	srand(0);
+	const int mask = (1 << bitDepth) - 1;
+	std::vector<T> top(pitch * height), bottom(pitch * height);
+	std::vector<T> topUV(pitch * heightUV), bottomUV(pitch * heightUV);
+	for (auto& v : top) v = T(rand() & mask);
+	for (auto& v : bottom) v = T(rand() & mask);
+	for (auto& v : topUV) v = T(rand() & mask);
+	for (auto& v : bottomUV) v = T(rand() & mask);
+
+	std::vector<T> dstRef(pitch * height), dstNew(pitch * height);
+	std::vector<T> dstURef(pitch * heightUV), dstVRef(pitch * heightUV);
+	std::vector<T> dstUNew(pitch * heightUV), dstVNew(pitch * heightUV);
+
+	Stopwatch sw;
+	double times[4] = { 0 };
+	for (int i = 0; i < numLoops; ++i) {
+		// top == bottomivObVuA܂̓tB[hĂꍇj
+		sw.start();
+		Copy1(dstRef.data(), top.data(), top.data(), width, height, pitch, pitch, pitch);
+		times[0] += sw.getAndReset();
+		MergeFieldPlane<T>(dstNew.data(), top.data(), top.data(), width, height, pitch, pitch, pitch);
+		times[1] += sw.getAndReset();
+		// NV12 UVitop != bottomj
+		Copy2(dstURef.data(), dstVRef.data(), topUV.data(), bottomUV.data(), widthUV, heightUV, pitch, pitch, pitch);
+		times[2] += sw.getAndReset();
+		SplitUVPlane<T>(dstUNew.data(), dstVNew.data(), topUV.data(), bottomUV.data(), widthUV, heightUV, pitch, pitch, pitch, avx2);
+		times[3] += sw.getAndReset();
+	}
+	printf("%dbit MergeField(top==bottom): Line: %f ms, Bulk: %f ms\n",
+		bitDepth, times[0] * 1000 / numLoops, times[1] * 1000 / numLoops);
+	printf("%dbit NV12 SplitUV: C: %f ms, %s: %f ms\n",
+		bitDepth, times[2] * 1000 / numLoops, avx2 ? "AVX2" : "C", times[3] * 1000 / numLoops);
+
+	// ʔripfBO͏j
+	for (int y = 0; y < height; ++y) {
+		if (memcmp(&dstRef[pitch * y], &dstNew[pitch * y], sizeof(T) * width)) {
+			THROW(TestException, "MergeFieldPlane result mismatch");
+		}
+	}
+	for (int y = 0; y < heightUV; ++y) {
+		if (memcmp(&dstURef[pitch * y], &dstUNew[pitch * y], sizeof(T) * widthUV) ||
+			memcmp(&dstVRef[pitch * y], &dstVNew[pitch * y], sizeof(T) * widthUV)) {
+			THROW(TestException, "SplitUVPlane result mismatch");
+		}
+	}
+	// top != bottom̏ꍇmF
+	Copy1(dstRef.data(), top.data(), bottom.data(), width, height, pitch, pitch, pitch);
+	MergeFieldPlane<T>(dstNew.data(), top.data(), bottom.data(), width, height, pitch, pitch, pitch);
+	for (int y = 0; y < height; ++y) {
+		if (memcmp(&dstRef[pitch * y], &dstNew[pitch * y], sizeof(T) * width)) {
+			THROW(TestException, "MergeFieldPlane result mismatch");
+		}
+	}
+}
 
+static int MergeFieldPerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	// 1080i8bit/10bit
+	MergeFieldPerformanceT<uint8_t>(8);
+	MergeFieldPerformanceT<uint16_t>(10);
 	return 0;
 }
 
@@ -490,6 +1060,62 @@ static int SplitDualMonoAAC(AMTContext& ctx, const ConfigWrapper& setting)
 	return 0;
 }
 
+class MemorySplitDualMono : public DualMonoSplitter
+{
+public:
+	AutoBuffer out[2];
+
+	MemorySplitDualMono(AMTContext& ctx, bool parseOnly)
+		: DualMonoSplitter(ctx, parseOnly)
+	{ }
+
+	virtual void OnOutFrame(int index, MemoryChunk mc)
+	{
+		out[index].add(mc);
+	}
+};
+
+// \݂͂̂̕fR[hɂ镪Ɠo͂ɂȂ邩
+static int SplitDualMonoParseOnly(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	File src(setting.getSrcFilePath(), _T("rb"));
+	int sz = (int)src.size();
+	std::unique_ptr<uint8_t[]> buf = std::unique_ptr<uint8_t[]>(new uint8_t[sz]);
+	src.read(MemoryChunk(buf.get(), sz));
+
+	auto split = [&](MemorySplitDualMono& splitter) {
+		Stopwatch sw;
+		sw.start();
+		for (int offset = 0; offset + 7 <= sz; ) {
+			AdtsHeader header;
+			if (!header.parse(buf.get() + offset, 7)) {
+				THROW(FormatException, "Failed to parse AAC frame ...");
+			}
+			if (offset + header.frame_length > sz) {
+				THROW(FormatException, "frame_length too long ...");
+			}
+			splitter.inputPacket(MemoryChunk(buf.get() + offset, header.frame_length));
+			offset += header.frame_length;
+		}
+		return sw.getAndReset();
+	};
+
+	MemorySplitDualMono decoded(ctx, false);
+	MemorySplitDualMono parsed(ctx, true);
+	double decodeTime = split(decoded);
+	double parseTime = split(parsed);
+
+	for (int i = 0; i < 2; ++i) {
+		if (decoded.out[i].size() == 0 || decoded.out[i].get() != parsed.out[i].get()) {
+			THROWF(TestException, "`l%d̏o͂vȂ", i);
+		}
+	}
+
+	ctx.infoF("fR[h: %.3fb \͂̂: %.3fb", decodeTime, parseTime);
+
+	return 0;
+}
+
 static int AACDecodeTest(AMTContext& ctx, const ConfigWrapper& setting)
 {
 	File src(setting.getSrcFilePath(), _T("rb"));
@@ -530,74 +1156,453 @@ static int AACDecodeTest(AMTContext& ctx, const ConfigWrapper& setting)
 	return 0;
 }
 
-static int CaptionASS(AMTContext& ctx, const ConfigWrapper& setting)
+// 1oCgRs[ĂȑONALjbg؂o
+class H264VideoParserRef : public H264VideoParser
 {
-	try {
-		StreamReformInfo reformInfo = StreamReformInfo::deserialize(ctx, setting.getStreamInfoPath());
-
-		reformInfo.prepare(false, false);
-		auto audioDiffInfo = reformInfo.genAudio({ CMTYPE_BOTH });
-		audioDiffInfo.printAudioPtsDiff(ctx);
-
-		CaptionASSFormatter formatterASS(ctx);
-		CaptionSRTFormatter formatterSRT(ctx);
-		const auto& keys = reformInfo.getOutFileKeys();
-		for (int i = 0; i < (int)keys.size(); ++i) {
-			auto key = keys[i];
-			auto& capList = reformInfo.getEncodeFile(key).captionList;
-			for (int lang = 0; lang < capList.size(); ++lang) {
-				WriteUTF8File(
-					setting.getTmpASSFilePath(key, lang),
-					formatterASS.generate(capList[lang]));
-				WriteUTF8File(
-					setting.getTmpSRTFilePath(key, lang),
-					formatterSRT.generate(capList[lang]));
+public:
+	H264VideoParserRef(AMTContext& ctx) : H264VideoParser(ctx) { }
+
+protected:
+	virtual void storeBuffer(MemoryChunk frame) {
+		buffer.clear();
+		nalUnits.clear();
+		buffer.add(MemoryChunk(frame.data, 2));
+		int32_t n3bytes = (frame.data[0] << 8) | frame.data[1];
+		int unitStart = 0;
+		int lastNonZero = 0;
+		for (int i = 2; i < (int)frame.length; ++i) {
+			uint8_t inByte = frame.data[i];
+			n3bytes = ((n3bytes & 0xFFFF) << 8) | inByte;
+			if (n3bytes != 0x03) {
+				buffer.add(inByte);
+				int k = (int)buffer.size();
+				if (n3bytes == 0x01) {
+					pushNalUnit(unitStart, lastNonZero);
+					unitStart = k;
+				}
+				if (inByte) {
+					lastNonZero = k;
+				}
 			}
 		}
-	}
-	catch (const Exception& e) {
-		fprintf(stderr, "CaptionASS Error: OX[܂ -> %s\n", e.message());
-		return 1;
+		pushNalUnit(unitStart, lastNonZero);
 	}
 
-	return 0;
-}
+private:
+	void pushNalUnit(int unitStart, int lastNonZero) {
+		if (lastNonZero > 0) {
+			NalUnit nal;
+			nal.offset = unitStart + 1;
+			uint8_t& lastByte = buffer.ptr()[lastNonZero - 1];
+			if (lastByte == 0x80) {
+				--lastNonZero;
+			}
+			else {
+				lastByte &= lastByte - 1;
+			}
+			nal.length = lastNonZero - unitStart;
+			nal.header = (nal.length > 0) ? buffer.ptr()[unitStart] : 0;
+			nalUnits.push_back(nal);
+		}
+	}
+};
 
-static int EncoderOptionParse(AMTContext& ctx, const ConfigWrapper& setting)
+static void CompareH264Parser(H264VideoParser& parser, H264VideoParserRef& ref,
+	MemoryChunk frame, int64_t PTS, int64_t DTS, int& numFrames, double& parseTime, double& refTime)
 {
-	auto info = ParseEncoderOption(ENCODER_NVENC, setting.getEncoderOptions());
-	PrintEncoderInfo(ctx, info);
-	return 0;
+	std::vector<VideoFrameInfo> info, infoRef;
+	Stopwatch sw;
+	sw.start();
+	bool ret = parser.inputFrame(frame, info, PTS, DTS);
+	parseTime += sw.getAndReset();
+	bool retRef = ref.inputFrame(frame, infoRef, PTS, DTS);
+	refTime += sw.getAndReset();
+	if (ret != retRef || info.size() != infoRef.size()) {
+		THROW(TestException, "H264VideoParser result mismatch");
+	}
+	for (int i = 0; i < (int)info.size(); ++i) {
+		const VideoFrameInfo& a = info[i];
+		const VideoFrameInfo& b = infoRef[i];
+		if (a.PTS != b.PTS || a.DTS != b.DTS || a.isGopStart != b.isGopStart ||
+			a.pic != b.pic || a.type != b.type || a.codedDataSize != b.codedDataSize ||
+			a.format != b.format)
+		{
+			THROW(TestException, "VideoFrameInfo mismatch");
+		}
+	}
+	numFrames += (int)info.size();
 }
 
-static int DecodePerformance(AMTContext& ctx, const ConfigWrapper& setting)
+// G~[Vh~oCgNALjbgǉ
+static void AddH264NalUnit(AutoBuffer& au, uint8_t header, const uint8_t* rbsp, int length, bool longStartCode)
 {
-	using namespace av;
-
-	InputContext inputCtx(setting.getSrcFilePath());
-	if (avformat_find_stream_info(inputCtx(), NULL) < 0) {
-		THROW(FormatException, "avformat_find_stream_info failed");
+	if (longStartCode) {
+		au.add(0);
 	}
-	AVStream *videoStream = av::GetVideoStream(inputCtx());
-	if (videoStream == NULL) {
-		THROW(FormatException, "Could not find video stream ...");
+	au.add(0); au.add(0); au.add(1);
+	au.add(header);
+	int zeros = 0;
+	for (int i = 0; i < length; ++i) {
+		if (zeros >= 2 && rbsp[i] <= 3) {
+			au.add(3);
+			zeros = 0;
+		}
+		au.add(rbsp[i]);
+		zeros = (rbsp[i] == 0) ? zeros + 1 : 0;
 	}
-	AVCodecID vcodecId = videoStream->codecpar->codec_id;
-	AVCodec *pCodec = avcodec_find_decoder(vcodecId);
-	if (pCodec == NULL) {
-		THROW(FormatException, "Could not find decoder ...");
+}
+
+static void WriteExpGolom(BitWriter& writer, uint32_t v) {
+	int len = 0;
+	while (((v + 1) >> (len + 1)) != 0) ++len;
+	writer.writen(0, len);
+	writer.writen(v + 1, len + 1);
+}
+
+// gƓ悤ȍ\AU
+// 1440x1080i Main Profile, pic_timing SEI
+static void MakeH264TestAU(AutoBuffer& au, int frameIndex)
+{
+	AutoBuffer rbsp;
+	bool gopStart = (frameIndex % 15) == 0;
+
+	// AUf~^
+	uint8_t primary_pic_type = gopStart ? 0 : (rand() % 3);
+	uint8_t aud = (primary_pic_type << 5) | 0x10;
+	AddH264NalUnit(au, 0x09, &aud, 1, true);
+
+	if (gopStart) {
+		// SPS
+		BitWriter writer(rbsp);
+		writer.write<8>(77); // profile_idc
+		writer.write<8>(0); // constraint_set_flags, reserved_zero_2bits
+		writer.write<8>(40); // level_idc
+		WriteExpGolom(writer, 0); // seq_parameter_set_id
+		WriteExpGolom(writer, 0); // log2_max_frame_num_minus4
+		WriteExpGolom(writer, 0); // pic_order_cnt_type
+		WriteExpGolom(writer, 0); // log2_max_pic_order_cnt_lsb_minus4
+		WriteExpGolom(writer, 1); // max_num_ref_frames
+		writer.write<1>(0); // gaps_in_frame_num_value_allowed_flag
+		WriteExpGolom(writer, 1440 / 16 - 1); // pic_width_in_mbs_minus1
+		WriteExpGolom(writer, 1088 / 32 - 1); // pic_height_in_map_units_minus1
+		writer.write<1>(0); // frame_mbs_only_flag
+		writer.write<1>(0); // mb_adaptive_frame_field_flag
+		writer.write<1>(1); // direct_8x8_inference_flag
+		writer.write<1>(1); // frame_cropping_flag
+		WriteExpGolom(writer, 0);
+		WriteExpGolom(writer, 0);
+		WriteExpGolom(writer, 0);
+		WriteExpGolom(writer, 2); // 1088 -> 1080
+		writer.write<1>(1); // vui_parameters_present_flag
+		writer.write<1>(1); // aspect_ratio_info_present_flag
+		writer.write<8>(14); // 4:3
+		writer.write<1>(0); // overscan_info_present_flag
+		writer.write<1>(0); // video_signal_type_present_flag
+		writer.write<1>(0); // chroma_loc_info_present_flag
+		writer.write<1>(1); // timing_info_present_flag
+		writer.write<32>(1001);
+		writer.write<32>(60000);
+		writer.write<1>(1); // fixed_frame_rate_flag
+		writer.write<1>(0); // nal_hrd_parameters_present_flag
+		writer.write<1>(0); // vcl_hrd_parameters_present_flag
+		writer.write<1>(1); // pic_struct_present_flag
+		writer.write<1>(0); // bitstream_restriction_flag
+		writer.write<1>(1); // rbsp_stop_one_bit
+		writer.byteAlign<false>();
+		writer.flush();
+		AddH264NalUnit(au, 0x67, rbsp.ptr(), (int)rbsp.size(), true);
+		rbsp.clear();
+
+		// PPSig͌Ȃ̂œKj
+		uint8_t pps[] = { 0xCE, 0x3C, 0x80 };
+		AddH264NalUnit(au, 0x68, pps, sizeof(pps), true);
 	}
-	CodecContext codecCtx(pCodec);
-	if (avcodec_parameters_to_context(codecCtx(), videoStream->codecpar) != 0) {
-		THROW(FormatException, "avcodec_parameters_to_context failed");
+
+	// SEI pic_timing
+	static const uint8_t picStructs[] = { 0, 3, 4, 5, 6 };
+	uint8_t sei[] = { 1, 1, uint8_t((picStructs[rand() % 5] << 4) | 0x08), 0x80 };
+	AddH264NalUnit(au, 0x06, sei, sizeof(sei), false);
+
+	// XCXi[̑_f[^j
+	int numSlices = 1 + rand() % 4;
+	for (int i = 0; i < numSlices; ++i) {
+		int length = 1 + rand() % 20000;
+		rbsp.clear();
+		for (int k = 0; k < length; ++k) {
+			int r = rand() % 16;
+			rbsp.add(uint8_t((r < 4) ? 0 : (r < 6) ? (rand() % 4) : rand()));
+		}
+		// rbsp_slice_trailing_bits
+		rbsp.add(uint8_t((rand() & 0xF0) | 0x08));
+		if ((rand() % 4) == 0) {
+			// cabac_zero_word
+			for (int k = rand() % 8; k >= 0; --k) {
+				rbsp.add(0); rbsp.add(0);
+			}
+		}
+		AddH264NalUnit(au, gopStart ? 0x65 : 0x01, rbsp.ptr(), (int)rbsp.size(), i == 0);
 	}
-	codecCtx()->thread_count = GetFFmpegThreads(GetProcessorCount() - 2);
-	if (avcodec_open2(codecCtx(), pCodec, NULL) != 0) {
-		THROW(FormatException, "avcodec_open2 failed");
+
+	if ((rand() % 20) == 0) {
+		// End of Sequenceiwb_NALjbgj
+		AddH264NalUnit(au, 0x0A, NULL, 0, false);
 	}
+}
 
-	Stopwatch sw;
-	sw.start();
+static int H264NalScanner(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	H264VideoParser parser(ctx);
+	H264VideoParserRef ref(ctx);
+	int numFrames = 0;
+	double parseTime = 0, refTime = 0;
+
+	// AU
+	srand(0);
+	AutoBuffer au;
+	for (int i = 0; i < 3000; ++i) {
+		au.clear();
+		MakeH264TestAU(au, i);
+		int64_t PTS = 90000 + i * 3003;
+		CompareH264Parser(parser, ref, au.get(), PTS, PTS - 3003, numFrames, parseTime, refTime);
+	}
+	printf("Synthetic: %d frames OK (Ref: %f sec, Scanner: %f sec)\n", numFrames, refTime, parseTime);
+
+	// ۂTSoAU
+	tstring srcpath = setting.getSrcFilePath();
+	if (srcpath.size() > 0) {
+		using namespace av;
+
+		parser.reset();
+		ref.reset();
+		numFrames = 0;
+		parseTime = refTime = 0;
+
+		InputContext inputCtx(srcpath);
+		if (avformat_find_stream_info(inputCtx(), NULL) < 0) {
+			THROW(FormatException, "avformat_find_stream_info failed");
+		}
+		AVStream *videoStream = av::GetVideoStream(inputCtx());
+		if (videoStream == NULL) {
+			THROW(FormatException, "Could not find video stream ...");
+		}
+		if (videoStream->codecpar->codec_id != AV_CODEC_ID_H264) {
+			printf("H264ł͂Ȃ̂ŃXLbv\n");
+			return 0;
+		}
+
+		AVPacket packet = AVPacket();
+		while (av_read_frame(inputCtx(), &packet) == 0) {
+			if (packet.stream_index == videoStream->index && packet.size >= 4) {
+				MemoryChunk frame(packet.data, packet.size);
+				int64_t PTS = (packet.pts != AV_NOPTS_VALUE) ? packet.pts : -1;
+				int64_t DTS = (packet.dts != AV_NOPTS_VALUE) ? packet.dts : PTS;
+				CompareH264Parser(parser, ref, frame, PTS, DTS, numFrames, parseTime, refTime);
+			}
+			av_packet_unref(&packet);
+		}
+		printf("Captured: %d frames OK (Ref: %f sec, Scanner: %f sec)\n", numFrames, refTime, parseTime);
+	}
+
+	return 0;
+}
+
+template <typename F>
+static int CountStartCode(F findCandidate, const std::vector<std::vector<uint8_t>>& frames)
+{
+	int count = 0;
+	for (const auto& frame : frames) {
+		int length = (int)frame.size();
+		for (int b = 0; b <= length - 4; ++b) {
+			int next = findCandidate(&frame[b], length - b - 1);
+			if (next < 0) {
+				break;
+			}
+			b += next;
+			if ((read32(&frame[b]) & 0xFFFFFF00) == 0x100) {
+				++count;
+			}
+		}
+	}
+	return count;
+}
+
+static int StartCodeSearchPerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	std::vector<std::vector<uint8_t>> frames;
+	size_t totalBytes = 0;
+
+	tstring srcpath = setting.getSrcFilePath();
+	if (srcpath.size() > 0) {
+		// ۂTSft[o
+		using namespace av;
+		InputContext inputCtx(srcpath);
+		if (avformat_find_stream_info(inputCtx(), NULL) < 0) {
+			THROW(FormatException, "avformat_find_stream_info failed");
+		}
+		AVStream *videoStream = av::GetVideoStream(inputCtx());
+		if (videoStream == NULL) {
+			THROW(FormatException, "Could not find video stream ...");
+		}
+		AVPacket packet = AVPacket();
+		while (frames.size() < 1000 && av_read_frame(inputCtx(), &packet) == 0) {
+			if (packet.stream_index == videoStream->index) {
+				frames.emplace_back(packet.data, packet.data + packet.size);
+				totalBytes += packet.size;
+			}
+			av_packet_unref(&packet);
+		}
+	}
+	else {
+		// 1080iMPEG2t[ۂf[^i68XCXA1t[100KBj
+		srand(0);
+		for (int i = 0; i < 300; ++i) {
+			std::vector<uint8_t> frame;
+			auto addStartCode = [&](uint8_t code) {
+				frame.push_back(0); frame.push_back(0); frame.push_back(1); frame.push_back(code);
+			};
+			if ((i % 15) == 0) {
+				addStartCode(0xB3);
+				for (int k = 0; k < 8; ++k) frame.push_back(uint8_t(rand() | 1));
+				addStartCode(0xB8);
+				for (int k = 0; k < 4; ++k) frame.push_back(uint8_t(rand() | 1));
+			}
+			addStartCode(0x00);
+			for (int k = 0; k < 4; ++k) frame.push_back(uint8_t(rand() | 1));
+			addStartCode(0xB5);
+			for (int k = 0; k < 5; ++k) frame.push_back(uint8_t(rand() | 1));
+			for (int slice = 1; slice <= 68; ++slice) {
+				addStartCode(uint8_t(slice));
+				for (int k = rand() % 3000; k >= 0; --k) {
+					// XCXf[^ɂ00 00͏oĂȂ[̂͂
+					uint8_t v = uint8_t(rand());
+					frame.push_back((v == 0 && frame.back() == 0) ? 1 : v);
+				}
+			}
+			totalBytes += frame.size();
+			frames.push_back(std::move(frame));
+		}
+	}
+
+	auto findRef = [](const uint8_t* data, int length) {
+		for (int i = 0; i + 2 < length; ++i) {
+			if ((read32(data + i) >> 8) <= 3) return i;
+		}
+		return -1;
+	};
+
+	const double MB = totalBytes / (1024.0 * 1024.0);
+	const int numLoops = 10;
+	Stopwatch sw;
+	int counts[4] = { 0 };
+	double times[4] = { 0 };
+	for (int i = 0; i < numLoops; ++i) {
+		sw.start();
+		counts[0] = CountStartCode(findRef, frames);
+		times[0] += sw.getAndReset();
+		counts[1] = CountStartCode(FindStartCodeCandidate_C, frames);
+		times[1] += sw.getAndReset();
+		counts[2] = CountStartCode(FindStartCodeCandidate_SSE2, frames);
+		times[2] += sw.getAndReset();
+		if (IsAVX2Available()) {
+			counts[3] = CountStartCode(FindStartCodeCandidate_AVX2, frames);
+			times[3] += sw.getAndReset();
+		}
+		else {
+			counts[3] = counts[0];
+		}
+	}
+	printf("%d frames %.1f MB, %d start codes\n", (int)frames.size(), MB, counts[0]);
+	const char* names[] = { "Byte", "C", "SSE2", "AVX2" };
+	for (int i = 0; i < 4; ++i) {
+		printf("%s: %f MB/s\n", names[i], (times[i] > 0) ? MB * numLoops / times[i] : 0.0);
+	}
+	if (counts[1] != counts[0] || counts[2] != counts[0] || counts[3] != counts[0]) {
+		THROW(TestException, "start code count mismatch");
+	}
+
+	// p[TS
+	MPEG2VideoParser parser(ctx);
+	std::vector<VideoFrameInfo> info;
+	sw.start();
+	for (int i = 0; i < numLoops; ++i) {
+		parser.reset();
+		for (auto& frame : frames) {
+			parser.inputFrame(MemoryChunk(frame.data(), frame.size()), info, -1, -1);
+		}
+	}
+	printf("MPEG2VideoParser: %f MB/s\n", MB * numLoops / sw.getAndReset());
+
+	return 0;
+}
+
+static int CaptionASS(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	try {
+		StreamReformInfo reformInfo = StreamReformInfo::deserialize(ctx, setting.getStreamInfoPath());
+
+		reformInfo.prepare(false, false);
+		auto audioDiffInfo = reformInfo.genAudio({ CMTYPE_BOTH });
+		audioDiffInfo.printAudioPtsDiff(ctx);
+
+		CaptionASSFormatter formatterASS(ctx);
+		CaptionSRTFormatter formatterSRT(ctx);
+		const auto& keys = reformInfo.getOutFileKeys();
+		for (int i = 0; i < (int)keys.size(); ++i) {
+			auto key = keys[i];
+			auto& capList = reformInfo.getEncodeFile(key).captionList;
+			for (int lang = 0; lang < capList.size(); ++lang) {
+				WriteUTF8File(
+					setting.getTmpASSFilePath(key, lang),
+					formatterASS.generate(capList[lang]));
+				WriteUTF8File(
+					setting.getTmpSRTFilePath(key, lang),
+					formatterSRT.generate(capList[lang]));
+			}
+		}
+	}
+	catch (const Exception& e) {
+		fprintf(stderr, "CaptionASS Error: OX[܂ -> %s\n", e.message());
+		return 1;
+	}
+
+	return 0;
+}
+
+static int EncoderOptionParse(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	auto info = ParseEncoderOption(ENCODER_NVENC, setting.getEncoderOptions());
+	PrintEncoderInfo(ctx, info);
+	return 0;
+}
+
+static int DecodePerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	using namespace av;
+
+	InputContext inputCtx(setting.getSrcFilePath());
+	if (avformat_find_stream_info(inputCtx(), NULL) < 0) {
+		THROW(FormatException, "avformat_find_stream_info failed");
+	}
+	AVStream *videoStream = av::GetVideoStream(inputCtx());
+	if (videoStream == NULL) {
+		THROW(FormatException, "Could not find video stream ...");
+	}
+	AVCodecID vcodecId = videoStream->codecpar->codec_id;
+	AVCodec *pCodec = avcodec_find_decoder(vcodecId);
+	if (pCodec == NULL) {
+		THROW(FormatException, "Could not find decoder ...");
+	}
+	CodecContext codecCtx(pCodec);
+	if (avcodec_parameters_to_context(codecCtx(), videoStream->codecpar) != 0) {
+		THROW(FormatException, "avcodec_parameters_to_context failed");
+	}
+	codecCtx()->thread_count = GetFFmpegThreads(GetProcessorCount() - 2);
+	if (avcodec_open2(codecCtx(), pCodec, NULL) != 0) {
+		THROW(FormatException, "avcodec_open2 failed");
+	}
+
+	Stopwatch sw;
+	sw.start();
 
 	int nframes = 0;
 	Frame frame;
@@ -715,4 +1720,744 @@ static int ResourceTest(AMTContext& ctx, const ConfigWrapper& setting)
 	return 0;
 }
 
+
+// fԂɕĕGR[hAAo͂̃t[ƓŉߕsȂmF
+static int SegmentedEncode(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	using namespace av;
+
+	const_cast<ConfigWrapper&>(setting).CreateTempDir();
+
+	// t[ԍ64x64̃ubN102iƂĕ`悷
+	// tGR[hłubN̖Â͕Ȃ̂ŃfR[hʂ猳̃t[ԍ
+	const int numFrames = 900;
+	const int numBits = 10;
+	const int blockSize = 64;
+	std::string script = StringFormat(
+		"base = BlankClip(length=%d, width=%d, height=%d, pixel_type=\"YV12\", fps=30000, fps_denominator=1001)\n",
+		numFrames, blockSize, blockSize);
+	std::string stack = "StackHorizontal(";
+	for (int b = 0; b < numBits; ++b) {
+		script += StringFormat(
+			"b%d = ScriptClip(base, \"BlankClip(last, color_yuv=((current_frame / %d) %% 2 == 1) ? $EB8080 : $108080)\")\n",
+			b, 1 << b);
+		stack += StringFormat("%sb%d", (b == 0) ? "" : ", ", b);
+	}
+	stack += ")";
+	script += StringFormat("StackVertical(%s, BlankClip(base, width=%d, height=%d))\n",
+		stack, blockSize * numBits, 360 - blockSize);
+
+	VideoFormat fmt = VideoFormat();
+	fmt.width = fmt.displayWidth = 640;
+	fmt.height = fmt.displayHeight = 360;
+	fmt.sarWidth = fmt.sarHeight = 1;
+	fmt.frameRateNum = 30000;
+	fmt.frameRateDenom = 1001;
+	fmt.colorPrimaries = AVCOL_PRI_UNSPECIFIED;
+	fmt.transferCharacteristics = AVCOL_TRC_UNSPECIFIED;
+	fmt.colorSpace = AVCOL_SPC_UNSPECIFIED;
+	fmt.progressive = true;
+	fmt.fixedFrameRate = true;
+
+	// Ԃ̋E̓][EɊ񂹂
+	std::vector<EncoderZone> zones = { { 200, 280 }, { 610, 700 } };
+	auto segments = MakeEncodeSegments(numFrames, zones, 4, 60);
+	if (segments.size() != 4 || segments[0].startFrame != 0 || segments.back().endFrame != numFrames) {
+		THROW(TestException, "invalid segments");
+	}
+	if (segments[1].startFrame != 200 || segments[3].startFrame != 700) {
+		THROW(TestException, "segments are not aligned to zone boundaries");
+	}
+
+	tstring outpath = setting.getEncVideoFilePath(EncodeFileKey());
+	std::vector<tstring> segmentPaths;
+	std::vector<tstring> segmentArgs;
+	for (int i = 0; i < (int)segments.size(); ++i) {
+		segmentPaths.push_back(setting.getEncVideoSegmentFilePath(EncodeFileKey(), i));
+		segmentArgs.push_back(makeEncoderArgs(setting.getEncoder(), setting.getEncoderPath(),
+			setting.getEncoderOptions(), fmt, tstring(), 0, segmentPaths.back()));
+	}
+
+	{
+		auto env = make_unique_ptr(CreateScriptEnvironment2());
+		PClip clip = env->Invoke("Eval", script.c_str()).AsClip();
+		AMTSegmentedVideoEncoder encoder(ctx, 8);
+		encoder.encode(clip, env.get(), script, fmt, segments, segmentArgs, segmentPaths, outpath);
+	}
+
+	// Ao͂fR[hĊmF
+	InputContext inputCtx(outpath);
+	if (avformat_find_stream_info(inputCtx(), NULL) < 0) {
+		THROW(FormatException, "avformat_find_stream_info failed");
+	}
+	AVStream *videoStream = av::GetVideoStream(inputCtx());
+	if (videoStream == NULL) {
+		THROW(FormatException, "Could not find video stream ...");
+	}
+	AVCodec *pCodec = avcodec_find_decoder(videoStream->codecpar->codec_id);
+	if (pCodec == NULL) {
+		THROW(FormatException, "Could not find decoder ...");
+	}
+	CodecContext codecCtx(pCodec);
+	if (avcodec_parameters_to_context(codecCtx(), videoStream->codecpar) != 0) {
+		THROW(FormatException, "avcodec_parameters_to_context failed");
+	}
+	if (avcodec_open2(codecCtx(), pCodec, NULL) != 0) {
+		THROW(FormatException, "avcodec_open2 failed");
+	}
+
+	// fR[ht[ɕ`悳Ăt[ԍǂݎ
+	std::vector<int> frameNumbers;
+	Frame frame;
+	auto readFrameNumber = [&](AVFrame* f) {
+		const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)(f->format));
+		int depth = desc->comp[0].depth;
+		int thresh = ((16 + 235) / 2) << (depth - 8);
+		int number = 0;
+		for (int b = 0; b < numBits; ++b) {
+			// ubN̕
+			int64_t sum = 0;
+			int count = 0;
+			for (int y = blockSize / 4; y < blockSize * 3 / 4; ++y) {
+				const uint8_t* line = f->data[0] + y * f->linesize[0];
+				for (int x = b * blockSize + blockSize / 4; x < b * blockSize + blockSize * 3 / 4; ++x) {
+					sum += (depth > 8) ? ((const uint16_t*)line)[x] : line[x];
+					++count;
+				}
+			}
+			if (sum / count > thresh) {
+				number |= 1 << b;
+			}
+		}
+		return number;
+	};
+	auto receiveFrames = [&]() {
+		while (avcodec_receive_frame(codecCtx(), frame()) == 0) {
+			frameNumbers.push_back(readFrameNumber(frame()));
+		}
+	};
+	AVPacket packet = AVPacket();
+	while (av_read_frame(inputCtx(), &packet) == 0) {
+		if (packet.stream_index == videoStream->index) {
+			if (avcodec_send_packet(codecCtx(), &packet) != 0) {
+				THROW(FormatException, "avcodec_send_packet failed");
+			}
+			receiveFrames();
+		}
+		av_packet_unref(&packet);
+	}
+	if (avcodec_send_packet(codecCtx(), NULL) != 0) {
+		THROW(FormatException, "avcodec_send_packet failed");
+	}
+	receiveFrames();
+
+	if (frameNumbers.size() != numFrames) {
+		THROWF(TestException, "frame count mismatch %d vs %d", (int)frameNumbers.size(), numFrames);
+	}
+	// Ԃ̂ȂڂłAdA̓ւ肪Ȃ
+	for (int i = 0; i < numFrames; ++i) {
+		if (frameNumbers[i] != i) {
+			THROWF(TestException, "frame %d has wrong content (source frame %d)", i, frameNumbers[i]);
+		}
+	}
+	printf("Segmented encode OK: %d frames in %d segments\n", numFrames, (int)segments.size());
+
+	return 0;
+}
+
+
+// 2pXpt[LbVɏ񂾃t[Ɠɓǂ߂邱ƂmF
+static int FrameCache(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	const_cast<ConfigWrapper&>(setting).CreateTempDir();
+
+	auto env = make_unique_ptr(CreateScriptEnvironment2());
+	tstring path = setting.getEncFrameCachePath(EncodeFileKey());
+
+	// UtVideoňkYV12Ɩkŕۑ10bit
+	const char* scripts[] = {
+		"BlankClip(length=60, width=640, height=360, pixel_type=\"YV12\").ShowFrameNumber()",
+		"BlankClip(length=60, width=640, height=360, pixel_type=\"YV12\").ShowFrameNumber().ConvertBits(10)"
+	};
+	for (const char* script : scripts) {
+		PClip clip = env->Invoke("Eval", script).AsClip();
+		VideoInfo vi = clip->GetVideoInfo();
+
+		FilteredFrameCache cache(ctx, path, 1024 * 1024 * 1024);
+		cache.beginWrite(vi);
+		for (int i = 0; i < vi.num_frames; ++i) {
+			cache.writeFrame(clip->GetFrame(i, env.get()));
+		}
+		cache.endWrite();
+		if (!cache.isAvailable()) {
+			THROW(TestException, "frame cache is not available");
+		}
+
+		cache.beginRead();
+		int yuv[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+		for (int i = 0; i < vi.num_frames; ++i) {
+			PVideoFrame a = clip->GetFrame(i, env.get());
+			PVideoFrame b = cache.readFrame(i, env.get());
+			for (int c = 0; c < 3; ++c) {
+				int rowsize = a->GetRowSize(yuv[c]);
+				for (int y = 0; y < a->GetHeight(yuv[c]); ++y) {
+					if (memcmp(a->GetReadPtr(yuv[c]) + y * a->GetPitch(yuv[c]),
+						b->GetReadPtr(yuv[c]) + y * b->GetPitch(yuv[c]), rowsize)) {
+						THROWF(TestException, "frame %d mismatch", i);
+					}
+				}
+			}
+		}
+		cache.endRead();
+
+		// 𒴂LbV͎gȂ
+		FilteredFrameCache small(ctx, path, 1024);
+		small.beginWrite(vi);
+		for (int i = 0; i < vi.num_frames; ++i) {
+			small.writeFrame(clip->GetFrame(i, env.get()));
+		}
+		small.endWrite();
+		if (small.isAvailable() || File::exists(path)) {
+			THROW(TestException, "frame cache should be abandoned");
+		}
+	}
+
+	return 0;
+}
+
+// ̖EV[`FWȍo͂CMAnalyzeƓǂݍݏœǂ߂邩mF
+static int ChapterExeInternal(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	const_cast<ConfigWrapper&>(setting).CreateTempDir();
+
+	// IvV: ߂ȂIvVl̂ȂtOĂ낪Ȃ
+	// lsȂG[
+	const tchar* badOptions[] = { _T("-m abc"), _T("-s"), _T("-e 5x"), _T("-m 99999999999") };
+	for (const tchar* options : badOptions) {
+		bool thrown = false;
+		try {
+			ChapterExeAnalyzer analyzer(ctx, options);
+		}
+		catch (const ArgumentException&) {
+			thrown = true;
+		}
+		if (!thrown) {
+			THROWF(TestException, "invalid option accepted: %s", options);
+		}
+	}
+
+	// /Ɖf̐FԂƂɐ؂ւNbv
+	// Ԃ̓rŐFς̂ŁAV[`FWƂďo͂͂
+	struct Segment { int length; int color; bool loud; };
+	const Segment segments[] = {
+		{ 150, 0x408080, true },
+		{ 10, 0x408080, false },
+		{ 10, 0xC08080, false },
+		{ 130, 0xC08080, true },
+		{ 10, 0xC08080, false },
+		{ 10, 0x808080, false },
+		{ 80, 0x808080, true },
+	};
+	const int expected[] = { 160, 310 };
+
+	std::string script;
+	for (const Segment& seg : segments) {
+		std::string clip = StringFormat(
+			"BlankClip(length=%d, width=320, height=240, pixel_type=\"YV12\", fps=30000, fps_denominator=1001, "
+			"color_yuv=$%06X, audio_rate=48000, channels=2, sample_type=\"16bit\")", seg.length, seg.color);
+		if (seg.loud) {
+			clip = StringFormat("AudioDub(%s, Tone(length=%f, frequency=440, samplerate=48000, channels=2, level=0.5).ConvertAudioTo16bit())",
+				clip, seg.length * 1001.0 / 30000.0);
+		}
+		script += (script.size() ? " ++ " : "") + clip;
+	}
+	script += "\n";
+
+	auto env = make_unique_ptr(CreateScriptEnvironment2());
+	PClip clip = env->Invoke("Eval", script.c_str()).AsClip();
+
+	ChapterExeAnalyzer analyzer(ctx, _T("-v in.ts -m 50 -debug -s 10 -e 1"));
+	analyzer.beginScan(clip);
+	int numFrames = clip->GetVideoInfo().num_frames;
+	for (int n = 0; n < numFrames; ++n) {
+		PVideoFrame frame = clip->GetFrame(n, env.get());
+		analyzer.onFrame(n, frame, env.get());
+	}
+	analyzer.endScan();
+
+	tstring outPath = setting.getTmpChapterExeOutPath(0);
+	analyzer.writeResult(setting.getTmpChapterExePath(0), outPath);
+
+	auto sceneChanges = ReadChapterExeSceneChanges(outPath);
+	if (sceneChanges != std::vector<int>(std::begin(expected), std::end(expected))) {
+		std::string found;
+		for (int sc : sceneChanges) {
+			found += StringFormat(" %d", sc);
+		}
+		THROWF(TestException, "scene change mismatch:%s", found);
+	}
+
+	return 0;
+}
+
+
+class PumpBenchThread : public DataPumpThread<int64_t, true> {
+public:
+	PumpBenchThread(size_t maximum, size_t ringSlots)
+		: DataPumpThread(maximum, ringSlots)
+		, sum(0)
+	{ }
+	int64_t sum;
+protected:
+	virtual void OnDataReceived(int64_t&& data) {
+		sum += data;
+	}
+};
+
+// DataPumpThreaddequełƃOobt@ł̃X[vbgr
+static int DataPumpPerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	const int64_t numItems = 2000000;
+	const int64_t expected = numItems * (numItems - 1) / 2;
+	const size_t maximums[] = { 1024, 16 };
+	const char* names[] = { "deque", "ring" };
+	for (size_t maximum : maximums) {
+		for (int backend = 0; backend < 2; ++backend) {
+			PumpBenchThread thread(maximum, backend ? 1024 : 0);
+			Stopwatch sw;
+			sw.start();
+			thread.start();
+			for (int64_t i = 0; i < numItems; ++i) {
+				thread.put(int64_t(i), 1);
+			}
+			thread.join();
+			double elapsed = sw.getAndReset();
+			double prod, cons; thread.getTotalWait(prod, cons);
+			printf("%s (max %d): %.2f Mitems/s ProducerWait: %.2fs ConsumerWait: %.2fs\n",
+				names[backend], (int)maximum, numItems / elapsed / 1000000.0, prod, cons);
+			if (thread.sum != expected) {
+				THROW(TestException, "data lost in DataPumpThread");
+			}
+		}
+	}
+	return 0;
+}
+
+// TSt@CFileCutter͈̔͐؂oƃpPbgE킹mF
+static int FileCutterTs(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	const_cast<ConfigWrapper&>(setting).CreateTempDir();
+
+	std::string srcpath = to_string(setting.getIntVideoFilePath(0));
+	std::string dstpath = to_string(setting.getIntVideoFilePath(1));
+	const int numPackets = 30000; // 4MB̃Rs[obt@ׂ傫
+	const int dropPacket = numPackets / 2;
+
+	srand(0);
+	for (int packetSize : { 188, 192 }) {
+		// 擪ƓrɃS~ioCgȂj
+		std::vector<uint8_t> ts;
+		std::vector<int64_t> packetPos;
+		auto addGarbage = [&](int n) {
+			for (int i = 0; i < n; ++i) {
+				uint8_t b = uint8_t(rand());
+				ts.push_back((b == 0x47) ? 0 : b);
+			}
+		};
+		addGarbage(100);
+		for (int i = 0; i < numPackets; ++i) {
+			if (i == dropPacket) addGarbage(50);
+			packetPos.push_back(ts.size());
+			if (packetSize == 192) {
+				for (int s = 24; s >= 0; s -= 8) ts.push_back(uint8_t(i >> s));
+			}
+			ts.push_back(0x47);
+			for (int k = 1; k < 188; ++k) {
+				uint8_t b = uint8_t(rand());
+				ts.push_back((b == 0x47) ? 0 : b);
+			}
+		}
+		File(setting.getIntVideoFilePath(0), _T("wb")).write(MemoryChunk(ts.data(), ts.size()));
+		const int64_t fileSize = ts.size();
+
+		for (int snap = 0; snap < 2; ++snap) {
+			for (int trial = 0; trial < 20; ++trial) {
+				std::vector<filecutter::CutRange> ranges;
+				int numRanges = rand() % 3 + 1;
+				for (int i = 0; i < numRanges; ++i) {
+					int64_t from = (((int64_t)rand() << 15) ^ rand()) % fileSize;
+					int64_t length = (trial == 0) ? -1 : (((int64_t)rand() << 15) ^ rand()) % (fileSize / 2) + 1;
+					filecutter::CutRange range = { from, length };
+					ranges.push_back(range);
+				}
+
+				// Ғl
+				std::vector<uint8_t> expected;
+				for (auto r : ranges) {
+					int64_t start = r.from;
+					int64_t end = (r.length < 0) ? fileSize : std::min(fileSize, r.from + r.length);
+					if (snap) {
+						// start܂ރpPbg̐擪Aend܂ރpPbg̏I[
+						auto it = std::upper_bound(packetPos.begin(), packetPos.end(), start);
+						start = (it == packetPos.begin()) ? packetPos.front() : *(it - 1);
+						int64_t snappedEnd = packetPos.back() + packetSize;
+						for (int64_t pos : packetPos) {
+							if (pos + packetSize >= end) {
+								snappedEnd = pos + packetSize;
+								break;
+							}
+						}
+						end = std::max(start, snappedEnd);
+					}
+					expected.insert(expected.end(), ts.begin() + start, ts.begin() + end);
+				}
+
+				filecutter::FileCutter cutter;
+				if (!cutter.open(srcpath.c_str(), dstpath.c_str())) {
+					THROW(TestException, "failed to open files");
+				}
+				if (snap) {
+					if (!cutter.snapToTsPackets(ranges)) {
+						THROW(TestException, "TS packets not found");
+					}
+					if (cutter.getTsFormat().packetSize != packetSize) {
+						THROWF(TestException, "wrong packet size detected (%d)", cutter.getTsFormat().packetSize);
+					}
+				}
+				if (!cutter.cut(ranges)) {
+					THROW(TestException, "cut failed");
+				}
+
+				File dst(setting.getIntVideoFilePath(1), _T("rb"));
+				std::vector<uint8_t> out((size_t)dst.size());
+				if (out.size() > 0) {
+					dst.read(MemoryChunk(out.data(), out.size()));
+				}
+				if (out != expected) {
+					THROWF(TestException, "FileCutter output mismatch (packetSize=%d,snap=%d,trial=%d)",
+						packetSize, snap, trial);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+// AsyncFileWriterɔ[ȃTCYŏ񂾃t@C̃TCYƓemF
+// iFILE_FLAG_NO_BUFFERING͖ZN^E܂ŃpfBOďĂ؂l߂Ăj
+static int AsyncFileWriterTest(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	const_cast<ConfigWrapper&>(setting).CreateTempDir();
+
+	tstring path = setting.getIntVideoFilePath(0);
+	const size_t bufferSize = 64 * 1024;
+
+	srand(0);
+	for (int unbuffered = 0; unbuffered < 2; ++unbuffered) {
+		// AZN^E傤ǁA[
+		for (int64_t total : { 0, 4096 * 40, 1000003 }) {
+			std::vector<uint8_t> data((size_t)total);
+			for (auto& b : data) b = uint8_t(rand());
+
+			AsyncFileWriter writer(path, unbuffered != 0, bufferSize, 3);
+			for (size_t pos = 0; pos < data.size(); ) {
+				size_t sz = (((size_t)rand() << 15) ^ rand()) % (bufferSize * 3) + 1;
+				sz = std::min(sz, data.size() - pos);
+				writer.write(MemoryChunk(data.data() + pos, sz));
+				pos += sz;
+			}
+			writer.close();
+
+			File file(path, _T("rb"));
+			if (writer.getTotalBytes() != total || file.size() != total) {
+				THROWF(TestException, "file size mismatch (unbuffered=%d,size=%lld,actual=%lld)",
+					unbuffered, total, file.size());
+			}
+			std::vector<uint8_t> out(data.size());
+			if (out.size() > 0) {
+				file.read(MemoryChunk(out.data(), out.size()));
+			}
+			if (out != data) {
+				THROWF(TestException, "file content mismatch (unbuffered=%d,size=%lld)", unbuffered, total);
+			}
+		}
+	}
+
+	// ݃G[close()ŗOɂȂ
+	// ʂ̃nhŃt@CŜbNĂWriteFileERROR_LOCK_VIOLATIONŎs
+	for (int unbuffered = 0; unbuffered < 2; ++unbuffered) {
+		AsyncFileWriter writer(path, unbuffered != 0, bufferSize, 3);
+		// obt@1Ɏ܂̂close()܂ŏ܂Ȃ
+		std::vector<uint8_t> data(bufferSize / 2 + 1);
+		writer.write(MemoryChunk(data.data(), data.size()));
+
+		HANDLE hLock = CreateFileW(path.c_str(), GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+		if (hLock == INVALID_HANDLE_VALUE) {
+			THROW(TestException, "failed to open file for locking");
+		}
+		OVERLAPPED overlapped = OVERLAPPED();
+		bool locked = (LockFileEx(hLock, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY,
+			0, MAXDWORD, MAXDWORD, &overlapped) != FALSE);
+		bool thrown = false;
+		if (locked) {
+			try {
+				writer.close();
+			}
+			catch (const IOException&) {
+				thrown = true;
+			}
+			UnlockFileEx(hLock, 0, MAXDWORD, MAXDWORD, &overlapped);
+		}
+		CloseHandle(hLock);
+		if (!locked) {
+			THROW(TestException, "failed to lock file");
+		}
+		if (!thrown) {
+			THROWF(TestException, "write error was not reported by close() (unbuffered=%d)", unbuffered);
+		}
+	}
+
+	// close()ɔjƎc̃f[^͎̂Ă
+	// ܂̂͂ςɂȂobt@Ȃ̂Ńobt@TCY̔{ɂȂ
+	{
+		std::vector<uint8_t> data(bufferSize * 10 + 123);
+		{
+			AsyncFileWriter writer(path, true, bufferSize, 3);
+			writer.write(MemoryChunk(data.data(), data.size()));
+		}
+		int64_t size = File(path, _T("rb")).size();
+		if (size > (int64_t)(bufferSize * 10) || size % bufferSize != 0) {
+			THROWF(TestException, "unexpected file size after destruction (%lld)", size);
+		}
+	}
+
+	return 0;
+}
+
+class TsPacketCollector : public TsPacketParser {
+public:
+	TsPacketCollector(AMTContext& ctx) : TsPacketParser(ctx) { }
+	std::vector<uint8_t> packets;
+protected:
+	virtual void onTsPacket(TsPacket packet) {
+		packets.insert(packets.end(), packet.data, packet.data + packet.length);
+	}
+};
+
+// inputTSDirectinputTSœpPbg񂪐؂o邩mF
+// 擪̃S~ƓrŌpPbgAMappedFilẽr[EpPbgׂ悤ɂ
+static int TsPacketDirect(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	const_cast<ConfigWrapper&>(setting).CreateTempDir();
+
+	tstring path = setting.getIntVideoFilePath(0);
+	const int numPackets = 20000; // 64KB̃r[50ȏׂ
+	const int dropPacket = numPackets / 3;
+
+	srand(0);
+	for (int garbage : { 0, 1000 }) {
+		// oCg̓pPbg擪ɒu
+		auto randomByte = []() {
+			uint8_t b = uint8_t(rand());
+			return (b == TS_SYNC_BYTE) ? uint8_t(0) : b;
+		};
+		std::vector<uint8_t> ts;
+		std::vector<uint8_t> expected;
+		for (int i = 0; i < garbage; ++i) {
+			ts.push_back(randomByte());
+		}
+		for (int i = 0; i < numPackets; ++i) {
+			uint8_t packet[TS_PACKET_LENGTH];
+			int pid = 0x100 + i % 32;
+			packet[0] = TS_SYNC_BYTE;
+			packet[1] = uint8_t(pid >> 8);
+			packet[2] = uint8_t(pid);
+			packet[3] = uint8_t(0x10 | (i & 0x0F)); // yC[ĥ
+			for (int s = 0; s < 4; ++s) {
+				packet[4 + s] = uint8_t(i >> (24 - 8 * s));
+			}
+			for (int k = 8; k < TS_PACKET_LENGTH; ++k) {
+				packet[k] = randomByte();
+			}
+			if (garbage > 0 && i == dropPacket) {
+				// pPbg̓rŌ̂ł̃pPbg͏o͂Ȃ
+				ts.insert(ts.end(), packet, packet + 100);
+				continue;
+			}
+			ts.insert(ts.end(), packet, packet + TS_PACKET_LENGTH);
+			expected.insert(expected.end(), packet, packet + TS_PACKET_LENGTH);
+		}
+		File(path, _T("wb")).write(MemoryChunk(ts.data(), ts.size()));
+
+		TsPacketCollector ref(ctx);
+		ref.inputTS(MemoryChunk(ts.data(), ts.size()));
+		ref.flush();
+		if (ref.packets != expected) {
+			THROWF(TestException, "inputTS packet mismatch (garbage=%d)", garbage);
+		}
+
+		// r[ŏɂăr[E𑝂₷
+		TsPacketCollector direct(ctx);
+		MappedFile srcfile(path, 0);
+		for (int64_t offset = 0; offset < srcfile.size(); ) {
+			MemoryChunk view = srcfile.map(offset);
+			direct.inputTSDirect(view);
+			offset += view.length;
+		}
+		direct.flush();
+		if (direct.packets != ref.packets) {
+			THROWF(TestException, "inputTSDirect packet mismatch with MappedFile (garbage=%d)", garbage);
+		}
+
+		// [ȃTCYŋ؂ē
+		TsPacketCollector chunked(ctx);
+		for (size_t pos = 0; pos < ts.size(); ) {
+			size_t sz = std::min<size_t>(rand() % (TS_PACKET_LENGTH * 20) + 1, ts.size() - pos);
+			chunked.inputTSDirect(MemoryChunk(ts.data() + pos, sz));
+			pos += sz;
+		}
+		chunked.flush();
+		if (chunked.packets != ref.packets) {
+			THROWF(TestException, "inputTSDirect packet mismatch with odd chunks (garbage=%d)", garbage);
+		}
+	}
+
+	return 0;
+}
+
+class SplitterForTest : public AMTSplitter {
+public:
+	SplitterForTest(AMTContext& ctx, const ConfigWrapper& setting, int failAudioPacket)
+		: AMTSplitter(ctx, setting)
+		, failAudioPacket_(failAudioPacket)
+		, numAudioPackets_(0)
+	{ }
+
+	StreamReformInfo split(bool pipelined) {
+		if (pipelined) {
+			readAllPipelined();
+		}
+		else {
+			readAllBuffered();
+		}
+		closeOutputs();
+		return StreamReformInfo(ctx, videoFileCount_,
+			videoFrameList_, audioFrameList_, captionTextList_, streamEventList_, timeList_);
+	}
+
+	int getNumVideoFiles() const {
+		return videoFileCount_;
+	}
+
+	int getNumAudioPackets() const {
+		return numAudioPackets_;
+	}
+
+protected:
+	virtual void onAudioPesPacket(
+		int audioIdx,
+		int64_t clock,
+		const std::vector<AudioFrameData>& frames,
+		PESPacket packet)
+	{
+		// pCvCł͏o̓XbhĂ΂̂ŁAo̓Xe[W̃G[ɂȂ
+		if (numAudioPackets_++ == failAudioPacket_) {
+			THROW(TestException, "injected split error");
+		}
+		AMTSplitter::onAudioPesPacket(audioIdx, clock, frames, packet);
+	}
+
+private:
+	int failAudioPacket_;
+	int numAudioPackets_;
+};
+
+static void CheckSameFile(const tstring& a, const tstring& b)
+{
+	File fa(a, _T("rb"));
+	File fb(b, _T("rb"));
+	if (fa.size() != fb.size()) {
+		THROWF(TestException, "file size mismatch: %s (%lld) %s (%lld)",
+			a, fa.size(), b, fb.size());
+	}
+	enum { BUFSIZE = 4 * 1024 * 1024 };
+	std::vector<uint8_t> bufa(BUFSIZE), bufb(BUFSIZE);
+	for (int64_t remain = fa.size(); remain > 0; ) {
+		size_t sz = (size_t)std::min<int64_t>(BUFSIZE, remain);
+		fa.read(MemoryChunk(bufa.data(), sz));
+		fb.read(MemoryChunk(bufb.data(), sz));
+		if (memcmp(bufa.data(), bufb.data(), sz)) {
+			THROWF(TestException, "file content mismatch: %s %s", a, b);
+		}
+		remain -= sz;
+	}
+}
+
+// ʏƃpCvCTS͂Œԃt@CStreamReformInfoɂȂ邩mF
+// pCvC̓rŃG[NƂɍŏ̃G[̂܂ܕԂ邱ƂmF
+static int PipelinedSplit(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	const_cast<ConfigWrapper&>(setting).CreateTempDir();
+
+	tstring serialInfoPath = setting.getAudioFilePath() + _T(".serial.info");
+	tstring pipelinedInfoPath = setting.getAudioFilePath() + _T(".pipelined.info");
+	ctx.registerTmpFile(serialInfoPath);
+	ctx.registerTmpFile(pipelinedInfoPath);
+
+	int numVideoFiles, numAudioPackets;
+	{
+		SplitterForTest splitter(ctx, setting, -1);
+		splitter.split(false).serialize(serialInfoPath);
+		numVideoFiles = splitter.getNumVideoFiles();
+		numAudioPackets = splitter.getNumAudioPackets();
+	}
+
+	// ʏ̏o͖͂OςĎcĂ
+	std::vector<tstring> outputs;
+	for (int i = 0; i < numVideoFiles; ++i) {
+		outputs.push_back(setting.getIntVideoFilePath(i));
+	}
+	outputs.push_back(setting.getAudioFilePath());
+	outputs.push_back(setting.getWaveFilePath());
+	for (const auto& path : outputs) {
+		tstring serialPath = path + _T(".serial");
+		ctx.registerTmpFile(serialPath);
+		if (MoveFileExW(path.c_str(), serialPath.c_str(), MOVEFILE_REPLACE_EXISTING) == FALSE) {
+			THROWF(TestException, "failed to rename %s", path);
+		}
+	}
+
+	{
+		SplitterForTest splitter(ctx, setting, -1);
+		splitter.split(true).serialize(pipelinedInfoPath);
+		if (splitter.getNumVideoFiles() != numVideoFiles) {
+			THROWF(TestException, "number of video files mismatch (%d,%d)",
+				numVideoFiles, splitter.getNumVideoFiles());
+		}
+	}
+	for (const auto& path : outputs) {
+		CheckSameFile(path + _T(".serial"), path);
+	}
+	CheckSameFile(serialInfoPath, pipelinedInfoPath);
+
+	// o̓Xe[W̃G[͑̃G[ɒu炸1񂾂
+	if (numAudioPackets > 0) {
+		SplitterForTest splitter(ctx, setting, numAudioPackets / 2);
+		bool thrown = false;
+		try {
+			splitter.split(true);
+		}
+		catch (const TestException&) {
+			thrown = true;
+		}
+		if (!thrown) {
+			THROW(TestException, "injected error was not reported");
+		}
+	}
+
+	return 0;
+}
+
 } // namespace test
@@ -104,3 +104,66 @@ void EncodeAudio(AMTContext& ctx, const tstring& encoder_args,
 		THROWF(RuntimeException, "GR[_IR[h: 0x%x", ret);
 	}
 }
+
+// GR[hʃXbhŏԂɎs
+// fGR[hƕɓāAmuxOjoin()Ŋ҂
+class AudioEncodeThread : public ThreadBase, AMTObject
+{
+public:
+	struct Job {
+		tstring args;
+		AudioFormat afmt;
+		std::vector<FilterAudioFrame> audioFrames;
+	};
+
+	AudioEncodeThread(AMTContext& ctx, const tstring& audiopath, std::vector<Job>&& jobs)
+		: AMTObject(ctx)
+		, audiopath(audiopath)
+		, jobs(std::move(jobs))
+		, times(this->jobs.size())
+		, error(false)
+	{ }
+
+	~AudioEncodeThread() {
+		// fGR[hŗOoꍇXbh͏I点
+		ThreadBase::join();
+	}
+
+	// SWů҂
+	// G[ꍇ͗O𓊂
+	void join() {
+		ThreadBase::join();
+		if (error) {
+			THROWF(RuntimeException, "%s", errorMessage.c_str());
+		}
+	}
+
+	// eWuɂԁibjjoin()ɗL
+	const std::vector<double>& getTimes() const {
+		return times;
+	}
+
+protected:
+	virtual void run() {
+		try {
+			for (int i = 0; i < (int)jobs.size(); ++i) {
+				Stopwatch sw;
+				sw.start();
+				EncodeAudio(ctx, jobs[i].args, audiopath, jobs[i].afmt, jobs[i].audioFrames);
+				times[i] = sw.getAndReset();
+				ctx.infoF("GR[h %d/%d : %.2fb", i + 1, (int)jobs.size(), times[i]);
+			}
+		}
+		catch (const Exception& e) {
+			error = true;
+			errorMessage = e.message();
+		}
+	}
+
+private:
+	tstring audiopath;
+	std::vector<Job> jobs;
+	std::vector<double> times;
+	bool error;
+	std::string errorMessage;
+};
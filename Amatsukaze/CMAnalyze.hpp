@@ -12,6 +12,9 @@
 #include <iostream>
 #include <memory>
 #include <regex>
+#include <sstream>
+#include <array>
+#include <cmath>
 
 #include "StreamUtils.hpp"
 #include "TranscodeSetting.hpp"
@@ -19,6 +22,252 @@
 #include "ProcessThread.hpp"
 #include "PerformanceUtil.hpp"
 
+// chapter_exeƓ`̌ʂo͂閳EV[`FWo
+// S͂̃t[ǂݍ݂ɂԂ牺ē̂ŁAfR[h1ōς
+// chapter_exẽIvV -mi臒lj-siŒᖳt[j
+// -eiV[`FWTԑO̊gt[ĵ݉߂
+class ChapterExeAnalyzer : public AMTObject, public logo::ScanFrameHandler
+{
+public:
+	ChapterExeAnalyzer(AMTContext& ctx, const tstring& options)
+		: AMTObject(ctx)
+		, muteLevel(50)
+		, minMuteFrames(10)
+		, searchExtend(1)
+		, vi()
+		, hasAudio(false)
+		, prevFrame(-1)
+	{
+		parseOptions(options);
+	}
+
+	// t[󂯎OɌĂ
+	void beginScan(PClip clip_) {
+		clip = clip_;
+		vi = clip->GetVideoInfo();
+		hasAudio = vi.HasAudio() && vi.sample_type == SAMPLE_INT16;
+		sceneScores.assign(vi.num_frames, 0.0f);
+		audioLevels.assign(vi.num_frames, 0);
+		prevFrame = -1;
+		if (!hasAudio) {
+			ctx.warn("Ȃߖo͂ł܂");
+		}
+	}
+
+	// St[󂯎Ăԁiclipj
+	void endScan() {
+		clip = nullptr;
+	}
+
+	virtual void onFrame(int n, PVideoFrame& frame, IScriptEnvironment2* env) {
+		// f: Ot[Ƃ̋PxqXgO̍
+		if (vi.ComponentSize() == 1) {
+			makeHistogram<uint8_t>(frame, curHist);
+		}
+		else {
+			makeHistogram<uint16_t>(frame, curHist);
+		}
+		if (prevFrame >= 0 && prevFrame + 1 == n) {
+			int total = 0, diff = 0;
+			for (int i = 0; i < HIST_BINS; ++i) {
+				total += curHist[i];
+				diff += std::abs(curHist[i] - prevHist[i]);
+			}
+			sceneScores[n] = (total > 0) ? (float)diff / (2 * total) : 0.0f;
+		}
+		std::swap(curHist, prevHist);
+		prevFrame = n;
+
+		// : t[̋Ԃ̍őU
+		if (hasAudio) {
+			int64_t start = vi.AudioSamplesFromFrames(n);
+			int64_t count = vi.AudioSamplesFromFrames(n + 1) - start;
+			audioBuf.resize((size_t)(count * vi.nchannels));
+			if (count > 0) {
+				clip->GetAudio(audioBuf.data(), start, count, env);
+			}
+			int level = 0;
+			for (int16_t v : audioBuf) {
+				level = std::max(level, std::abs((int)v));
+			}
+			audioLevels[n] = level;
+		}
+	}
+
+	// chapterPath: chapter_exe-oo outPath: chapter_exe̕Wo
+	void writeResult(const tstring& chapterPath, const tstring& outPath)
+	{
+		StringBuilder out;
+		out.append("chapter_exe (internal)\n");
+		out.append("Setting\n");
+		out.append("\tmute: %d\n", muteLevel);
+		out.append("\tseri: %d\n", minMuteFrames);
+		out.append("\textend: %d\n", searchExtend);
+		out.append("\tframes: %d\n", vi.num_frames);
+		out.append("--------\n");
+
+		StringBuilder chapter;
+		int numChapters = 0;
+		int numMutes = 0;
+		int prevPos = 0;
+		int n = 0;
+		while (hasAudio && n < vi.num_frames) {
+			if (audioLevels[n] >= muteLevel) {
+				++n;
+				continue;
+			}
+			int start = n;
+			while (n < vi.num_frames && audioLevels[n] < muteLevel) {
+				++n;
+			}
+			int length = n - start;
+			if (length < minMuteFrames) {
+				continue;
+			}
+
+			// ԁiƑOjňԕω̑傫t[V[`FWƂ
+			int searchStart = std::max(1, start - searchExtend);
+			int searchEnd = std::min(vi.num_frames, n + searchExtend);
+			int scPos = std::max(1, start);
+			for (int i = searchStart; i < searchEnd; ++i) {
+				if (sceneScores[i] > sceneScores[scPos]) {
+					scPos = i;
+				}
+			}
+
+			out.append("mute%2d: %d - %dt[\n", ++numMutes, start, length);
+			out.append(" SCPos: %d %d\n", scPos, scPos - 1);
+
+			// Öʒu15bPʂȂCM̋؂̉\̂ň
+			double sec = (double)(scPos - prevPos) * vi.fps_denominator / vi.fps_numerator;
+			double rem = std::fmod(sec, 15.0);
+			const char* mark = (sec >= 14.5 && (rem < 0.5 || rem > 14.5)) ? "" : "";
+			appendChapter(chapter, ++numChapters, scPos, StringFormat("%dt[ %s SCPos:%d %d",
+				length, mark, scPos, scPos - 1));
+			prevPos = scPos;
+		}
+
+		File chapterFile(chapterPath, _T("w"));
+		chapterFile.write(chapter.getMC());
+		File outFile(outPath, _T("w"));
+		outFile.write(out.getMC());
+	}
+
+private:
+	enum { HIST_BINS = 64 };
+
+	int muteLevel;
+	int minMuteFrames;
+	int searchExtend;
+
+	PClip clip;
+	VideoInfo vi;
+	bool hasAudio;
+
+	int prevFrame;
+	std::array<int, HIST_BINS> curHist;
+	std::array<int, HIST_BINS> prevHist;
+	std::vector<int16_t> audioBuf;
+
+	std::vector<float> sceneScores;
+	std::vector<int> audioLevels;
+
+	// l͉̂߂IvVƂAȊÕg[N͓ǂݔ΂
+	// il̂ȂtOẴIvVȂ悤Ɂj
+	void parseOptions(const tstring& options) {
+		std::basic_istringstream<tchar> iss(options);
+		tstring key;
+		while (iss >> key) {
+			int* target = nullptr;
+			if (key == _T("-m")) target = &muteLevel;
+			else if (key == _T("-s")) target = &minMuteFrames;
+			else if (key == _T("-e")) target = &searchExtend;
+			if (target == nullptr) {
+				continue;
+			}
+			tstring value;
+			if (!(iss >> value)) {
+				THROWF(ArgumentException, "chapter_exeIvV%sɒl܂", key);
+			}
+			*target = parseInt(key, value);
+		}
+	}
+
+	static int parseInt(const tstring& key, const tstring& value) {
+		size_t pos = 0;
+		int v = 0;
+		try {
+			v = std::stoi(value, &pos);
+		}
+		catch (const std::logic_error&) {
+			// invalid_argument, out_of_range
+			pos = 0;
+		}
+		if (pos == 0 || pos != value.size() || v < 0) {
+			THROWF(ArgumentException, "chapter_exeIvV%s̒lsł: %s", key, value);
+		}
+		return v;
+	}
+
+	// c4fƂɊԈPxqXgO
+	template <typename pixel_t>
+	void makeHistogram(PVideoFrame& frame, std::array<int, HIST_BINS>& hist) {
+		const pixel_t* srcY = reinterpret_cast<const pixel_t*>(frame->GetReadPtr(PLANAR_Y));
+		int pitchY = frame->GetPitch(PLANAR_Y) / sizeof(pixel_t);
+		int shift = vi.BitsPerComponent() - 6;
+		hist.fill(0);
+		for (int y = 0; y < vi.height; y += 4) {
+			const pixel_t* line = srcY + y * pitchY;
+			for (int x = 0; x < vi.width; x += 4) {
+				hist[line[x] >> shift]++;
+			}
+		}
+	}
+
+	void appendChapter(StringBuilder& sb, int idx, int frame, const std::string& title) {
+		double t = (double)frame * vi.fps_denominator / vi.fps_numerator;
+		int h = (int)(t / 3600);
+		int m = (int)((t - h * 3600) / 60);
+		double sec = t - h * 3600 - m * 60;
+		sb.append("CHAPTER%02d=%02d:%02d:%06.3f\n", idx, h, m, sec);
+		sb.append("CHAPTER%02dNAME=%s\n", idx, title);
+	}
+};
+
+// chapter_exe̕WóiChapterExeAnalyzer::writeResult`jV[`FWʒuǂ
+static std::vector<int> ReadChapterExeSceneChanges(const tstring& path)
+{
+	File file(path, _T("r"));
+	std::string str;
+	std::vector<int> sceneChanges;
+
+	// wb_XLbv
+	while (1) {
+		if (!file.getline(str)) {
+			THROW(FormatException, "ChapterExe.exȅo̓t@Cǂ߂܂");
+		}
+		if (starts_with(str, "----")) {
+			break;
+		}
+	}
+
+	std::regex re0("mute\\s*(\\d+):\\s*(\\d+)\\s*-\\s*(\\d+).*");
+	std::regex re1("\\s*SCPos:\\s*(\\d+).*");
+
+	while (file.getline(str)) {
+		std::smatch m;
+		if (std::regex_search(str, m, re0)) {
+			//std::stoi(m[1].str());
+			//std::stoi(m[2].str());
+		}
+		else if (std::regex_search(str, m, re1)) {
+			sceneChanges.push_back(std::stoi(m[1].str()));
+		}
+	}
+
+	return sceneChanges;
+}
+
 class CMAnalyze : public AMTObject
 {
 public:
@@ -31,11 +280,20 @@ public:
 		Stopwatch sw;
 		tstring avspath = makeAVSFile(videoFileIndex);
 
+		// ŖEV[`FW͂ꍇ̓S͂Ɠt[g
+		std::unique_ptr<ChapterExeAnalyzer> chapterAnalyzer;
+		if (setting_.isInternalChapterExe()) {
+			chapterAnalyzer = std::unique_ptr<ChapterExeAnalyzer>(
+				new ChapterExeAnalyzer(ctx, setting_.getChapterExeOptions()));
+		}
+		bool chapterScanned = false;
+
 		// S
 		if (setting_.getLogoPath().size() > 0 || setting_.getEraseLogoPath().size() > 0) {
 			ctx.info("[S]");
 			sw.start();
-			logoFrame(videoFileIndex, avspath);
+			logoFrame(videoFileIndex, avspath, chapterAnalyzer.get());
+			chapterScanned = (chapterAnalyzer != nullptr);
 			ctx.infoF(": %.2fb", sw.getAndReset());
 
 			ctx.info("[S͌]");
@@ -53,7 +311,20 @@ public:
 		// `v^[
 		ctx.info("[EV[`FW]");
 		sw.start();
-		chapterExe(videoFileIndex, avspath);
+		if (chapterAnalyzer != nullptr) {
+			if (chapterScanned) {
+				ctx.info("S͂̃fR[hʂŉ͍ς");
+			}
+			else {
+				chapterScan(videoFileIndex, *chapterAnalyzer);
+			}
+			chapterAnalyzer->writeResult(
+				setting_.getTmpChapterExePath(videoFileIndex),
+				setting_.getTmpChapterExeOutPath(videoFileIndex));
+		}
+		else {
+			chapterExe(videoFileIndex, avspath);
+		}
 		ctx.infoF(": %.2fb", sw.getAndReset());
 
 		ctx.info("[EV[`FW͌]");
@@ -270,15 +541,20 @@ private:
 		return sb.str();
 	}
 
-	void logoFrame(int videoFileIndex, const tstring& avspath)
+	PClip makeSourceClip(int videoFileIndex, IScriptEnvironment2* env)
+	{
+		AVSValue result;
+		env->Invoke("Eval", AVSValue(makePreamble().c_str()));
+		env->LoadPlugin(to_string(GetModulePath()).c_str(), true, &result);
+		return env->Invoke("AMTSource", to_string(setting_.getTmpAMTSourcePath(videoFileIndex)).c_str()).AsClip();
+	}
+
+	void logoFrame(int videoFileIndex, const tstring& avspath, ChapterExeAnalyzer* chapterAnalyzer)
 	{
 		ScriptEnvironmentPointer env = make_unique_ptr(CreateScriptEnvironment2());
 
 		try {
-			AVSValue result;
-			env->Invoke("Eval", AVSValue(makePreamble().c_str()));
-			env->LoadPlugin(to_string(GetModulePath()).c_str(), true, &result);
-			PClip clip = env->Invoke("AMTSource", to_string(setting_.getTmpAMTSourcePath(videoFileIndex)).c_str()).AsClip();
+			PClip clip = makeSourceClip(videoFileIndex, env.get());
 
 			auto vi = clip->GetVideoInfo();
 			int duration = vi.num_frames * vi.fps_denominator / vi.fps_numerator;
@@ -289,7 +565,13 @@ private:
 			std::vector<tstring> allLogoPath = logoPath;
 			allLogoPath.insert(allLogoPath.end(), eraseLogoPath.begin(), eraseLogoPath.end());
 			logo::LogoFrame logof(ctx, allLogoPath, 0.35f);
-			logof.scanFrames(clip, env.get());
+			if (chapterAnalyzer != nullptr) {
+				chapterAnalyzer->beginScan(clip);
+			}
+			logof.scanFrames(clip, env.get(), -1, chapterAnalyzer);
+			if (chapterAnalyzer != nullptr) {
+				chapterAnalyzer->endScan();
+			}
 
 			if (logoPath.size() > 0) {
 #if 0
@@ -316,6 +598,29 @@ private:
 		}
 	}
 
+	// S͂Ȃꍇ͖EV[`FW͂̂߂ɃfR[h
+	void chapterScan(int videoFileIndex, ChapterExeAnalyzer& chapterAnalyzer)
+	{
+		ScriptEnvironmentPointer env = make_unique_ptr(CreateScriptEnvironment2());
+
+		try {
+			PClip clip = makeSourceClip(videoFileIndex, env.get());
+			int numFrames = clip->GetVideoInfo().num_frames;
+			chapterAnalyzer.beginScan(clip);
+			for (int n = 0; n < numFrames; ++n) {
+				PVideoFrame frame = clip->GetFrame(n, env.get());
+				chapterAnalyzer.onFrame(n, frame, env.get());
+				if ((n % 5000) == 0) {
+					ctx.infoF("%6d/%d", n, numFrames);
+				}
+			}
+			chapterAnalyzer.endScan();
+		}
+		catch (const AvisynthError& avserror) {
+			THROWF(AviSynthException, "%s", avserror.msg);
+		}
+	}
+
 	tstring MakeChapterExeArgs(int videoFileIndex, const tstring& avspath)
 	{
 		return StringFormat(_T("\"%s\" -v \"%s\" -o \"%s\" %s"),
@@ -410,32 +715,8 @@ private:
 
 	void readSceneChanges(int videoFileIndex)
 	{
-		File file(setting_.getTmpChapterExeOutPath(videoFileIndex), _T("r"));
-		std::string str;
-
-		// wb_XLbv
-		while (1) {
-			if (!file.getline(str)) {
-				THROW(FormatException, "ChapterExe.exȅo̓t@Cǂ߂܂");
-			}
-			if (starts_with(str, "----")) {
-				break;
-			}
-		}
-
-		std::regex re0("mute\\s*(\\d+):\\s*(\\d+)\\s*-\\s*(\\d+).*");
-		std::regex re1("\\s*SCPos:\\s*(\\d+).*");
-
-		while (file.getline(str)) {
-			std::smatch m;
-			if (std::regex_search(str, m, re0)) {
-				//std::stoi(m[1].str());
-				//std::stoi(m[2].str());
-			}
-			else if (std::regex_search(str, m, re1)) {
-				sceneChanges.push_back(std::stoi(m[1].str()));
-			}
-		}
+		auto scpos = ReadChapterExeSceneChanges(setting_.getTmpChapterExeOutPath(videoFileIndex));
+		sceneChanges.insert(sceneChanges.end(), scpos.begin(), scpos.end());
 	}
 
 	void makeCMZones(int numFrames) {
@@ -10,9 +10,10 @@
 #include <intrin.h>
 #include <immintrin.h>
 #include <stdio.h>
+#include <stdint.h>
 
 struct CPUInfo {
-	bool initialized, avx, avx2;
+	bool initialized, avx, avx2, pclmul;
 };
 
 static CPUInfo g_cpuinfo;
@@ -22,6 +23,7 @@ static inline void InitCPUInfo() {
 		int cpuinfo[4];
 		__cpuid(cpuinfo, 1);
 		g_cpuinfo.avx = cpuinfo[2] & (1 << 28) || false;
+		g_cpuinfo.pclmul = cpuinfo[2] & (1 << 1) || false;
 		bool osxsaveSupported = cpuinfo[2] & (1 << 27) || false;
 		g_cpuinfo.avx2 = false;
 		if (osxsaveSupported && g_cpuinfo.avx)
@@ -48,6 +50,12 @@ bool IsAVX2Available() {
 	return g_cpuinfo.avx2;
 }
 
+// ̃t@CVEXGR[hɂȂ̂AVXKv
+bool IsPCLMULQDQAvailable() {
+	InitCPUInfo();
+	return g_cpuinfo.avx && g_cpuinfo.pclmul;
+}
+
 // https://qiita.com/beru/items/fff00c19968685dada68
 // in  : ( x7, x6, x5, x4, x3, x2, x1, x0 )
 // out : ( -,  -,  -, xsum )
@@ -119,3 +127,185 @@ float CalcCorrelation5x5_AVX(const float* k, const float* Y, int x, int y, int w
 	if (pavg) *pavg = avg;
 	return sum;
 };
+
+// SXLώZiAVX2j
+// ĂяoIsAVX2Available()mF邱
+// 8bit: 32bitώZiĂяoňO64bitɈڂƁj
+void AddLogoScanLine8_AVX2(uint32_t* sumF, uint32_t* sumF2, uint32_t* sumFB, const uint8_t* src, int w, int b)
+{
+	const auto vb = _mm256_set1_epi32(b);
+	int x = 0;
+	for (; x + 8 <= w; x += 8) {
+		const auto f = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + x)));
+		auto vF = _mm256_loadu_si256((const __m256i*)(sumF + x));
+		auto vF2 = _mm256_loadu_si256((const __m256i*)(sumF2 + x));
+		auto vFB = _mm256_loadu_si256((const __m256i*)(sumFB + x));
+		vF = _mm256_add_epi32(vF, f);
+		vF2 = _mm256_add_epi32(vF2, _mm256_mullo_epi32(f, f));
+		vFB = _mm256_add_epi32(vFB, _mm256_mullo_epi32(f, vb));
+		_mm256_storeu_si256((__m256i*)(sumF + x), vF);
+		_mm256_storeu_si256((__m256i*)(sumF2 + x), vF2);
+		_mm256_storeu_si256((__m256i*)(sumFB + x), vFB);
+	}
+	for (; x < w; ++x) {
+		uint32_t f = src[x];
+		sumF[x] += f;
+		sumF2[x] += f * f;
+		sumFB[x] += f * b;
+	}
+}
+
+// 16bit: 64bitώZ
+void AddLogoScanLine16_AVX2(uint64_t* sumF, uint64_t* sumF2, uint64_t* sumFB, const uint16_t* src, int w, int b)
+{
+	const auto vb = _mm256_set1_epi64x(b);
+	int x = 0;
+	for (; x + 4 <= w; x += 4) {
+		const auto f = _mm256_cvtepu16_epi64(_mm_loadl_epi64((const __m128i*)(src + x)));
+		auto vF = _mm256_loadu_si256((const __m256i*)(sumF + x));
+		auto vF2 = _mm256_loadu_si256((const __m256i*)(sumF2 + x));
+		auto vFB = _mm256_loadu_si256((const __m256i*)(sumFB + x));
+		vF = _mm256_add_epi64(vF, f);
+		vF2 = _mm256_add_epi64(vF2, _mm256_mul_epu32(f, f));
+		vFB = _mm256_add_epi64(vFB, _mm256_mul_epu32(f, vb));
+		_mm256_storeu_si256((__m256i*)(sumF + x), vF);
+		_mm256_storeu_si256((__m256i*)(sumF2 + x), vF2);
+		_mm256_storeu_si256((__m256i*)(sumFB + x), vFB);
+	}
+	for (; x < w; ++x) {
+		uint64_t f = src[x];
+		sumF[x] += f;
+		sumF2[x] += f * f;
+		sumFB[x] += f * (uint64_t)b;
+	}
+}
+
+// NV12UV𕪗
+void SplitUVLine8_AVX2(uint8_t* dstU, uint8_t* dstV, const uint8_t* src, int w)
+{
+	const auto mask = _mm256_set1_epi16(0x00FF);
+	int x = 0;
+	for (; x + 32 <= w; x += 32) {
+		const auto a = _mm256_loadu_si256((const __m256i*)(src + x * 2));
+		const auto b = _mm256_loadu_si256((const __m256i*)(src + x * 2 + 32));
+		// packus̓[ƂȂ̂ōŌɕёւ
+		auto u = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+		auto v = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+		u = _mm256_permute4x64_epi64(u, _MM_SHUFFLE(3, 1, 2, 0));
+		v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*)(dstU + x), u);
+		_mm256_storeu_si256((__m256i*)(dstV + x), v);
+	}
+	for (; x < w; ++x) {
+		dstU[x] = src[x * 2 + 0];
+		dstV[x] = src[x * 2 + 1];
+	}
+}
+
+void SplitUVLine16_AVX2(uint16_t* dstU, uint16_t* dstV, const uint16_t* src, int w)
+{
+	const auto mask = _mm256_set1_epi32(0x0000FFFF);
+	int x = 0;
+	for (; x + 16 <= w; x += 16) {
+		const auto a = _mm256_loadu_si256((const __m256i*)(src + x * 2));
+		const auto b = _mm256_loadu_si256((const __m256i*)(src + x * 2 + 16));
+		auto u = _mm256_packus_epi32(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+		auto v = _mm256_packus_epi32(_mm256_srli_epi32(a, 16), _mm256_srli_epi32(b, 16));
+		u = _mm256_permute4x64_epi64(u, _MM_SHUFFLE(3, 1, 2, 0));
+		v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*)(dstU + x), u);
+		_mm256_storeu_si256((__m256i*)(dstV + x), v);
+	}
+	for (; x < w; ++x) {
+		dstU[x] = src[x * 2 + 0];
+		dstV[x] = src[x * 2 + 1];
+	}
+}
+
+// data[i]=0, data[i+1]=0, data[i+2]<=3 ƂȂŏiԂ
+// Ȃꍇ-1
+int FindStartCodeCandidate_AVX2(const uint8_t* data, int length)
+{
+	const auto zero = _mm256_setzero_si256();
+	const auto three = _mm256_set1_epi8(3);
+	int i = 0;
+	for (; i + 34 <= length; i += 32) {
+		const auto a = _mm256_loadu_si256((const __m256i*)(data + i));
+		const auto b = _mm256_loadu_si256((const __m256i*)(data + i + 1));
+		const auto c = _mm256_loadu_si256((const __m256i*)(data + i + 2));
+		const auto m = _mm256_and_si256(
+			_mm256_cmpeq_epi8(_mm256_or_si256(a, b), zero),
+			_mm256_cmpeq_epi8(_mm256_min_epu8(c, three), c));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(m);
+		if (mask) {
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return i + (int)index;
+		}
+	}
+	for (; i + 2 < length; ++i) {
+		if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] <= 3) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// MPEG2 CRC32i0x04C11DB7Arbg]Ȃjx^n mod P
+static uint32_t CRC32XPowMod(int n)
+{
+	uint32_t r = 0x80000000UL; // x^31
+	for (int i = 31; i < n; ++i) {
+		r = (r & 0x80000000UL) ? ((r << 1) ^ 0x04C11DB7UL) : (r << 1);
+	}
+	return r;
+}
+
+// 128bit̃ubNbitsɏݍ
+// 64bit*(x^(bits+64) mod P) + 64bit*(x^bits mod P)
+static inline __m128i CRC32Fold(__m128i x, __m128i k)
+{
+	return _mm_xor_si128(
+		_mm_clmulepi64_si128(x, k, 0x00),
+		_mm_clmulepi64_si128(x, k, 0x11));
+}
+
+// MPEG2 CRC32PCLMULQDQŏݍ
+// length16̔{64ȏł邱
+// crclƂdataŜ128bitɏݍ񂾌ʂrbOGfBAfolded[16]ɏ
+// foldedl0CRCvZdataCRCɂȂ
+// ĂяoIsPCLMULQDQAvailable()mF邱
+void FoldCRC32_CLMUL(const uint8_t* data, int length, uint32_t crc, uint8_t* folded)
+{
+	static const __m128i k512 = _mm_set_epi64x(CRC32XPowMod(576), CRC32XPowMod(512));
+	static const __m128i k128 = _mm_set_epi64x(CRC32XPowMod(192), CRC32XPowMod(128));
+	// 擪oCgŏʂɗ悤ɃoCg𔽓]
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+	auto load = [&](int offset) {
+		return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + offset)), bswap);
+	};
+
+	// l͐擪4oCgXOR΂悢
+	__m128i x0 = _mm_xor_si128(load(0), _mm_set_epi32(crc, 0, 0, 0));
+	__m128i x1 = load(16);
+	__m128i x2 = load(32);
+	__m128i x3 = load(48);
+
+	int i = 64;
+	for (; i + 64 <= length; i += 64) {
+		x0 = _mm_xor_si128(CRC32Fold(x0, k512), load(i));
+		x1 = _mm_xor_si128(CRC32Fold(x1, k512), load(i + 16));
+		x2 = _mm_xor_si128(CRC32Fold(x2, k512), load(i + 32));
+		x3 = _mm_xor_si128(CRC32Fold(x3, k512), load(i + 48));
+	}
+
+	x1 = _mm_xor_si128(CRC32Fold(x0, k128), x1);
+	x2 = _mm_xor_si128(CRC32Fold(x1, k128), x2);
+	x3 = _mm_xor_si128(CRC32Fold(x2, k128), x3);
+	for (; i + 16 <= length; i += 16) {
+		x3 = _mm_xor_si128(CRC32Fold(x3, k128), load(i));
+	}
+
+	_mm_storeu_si128((__m128i*)folded, _mm_shuffle_epi8(x3, bswap));
+}
@@ -10,7 +10,13 @@
 #include "common.h"
 
 #include <string>
+#include <deque>
+#include <set>
+#include <cstring>
+#include <cstdarg>
+#ifdef _MSC_VER
 #include <io.h>
+#endif
 
 #define AMT_MAX_PATH 512
 
@@ -73,10 +79,11 @@ protected:
 	NonCopyable() {}
 	~NonCopyable() {} /// protected Ȕ񉼑zfXgN^
 private:
-	NonCopyable(const NonCopyable &);
-	NonCopyable& operator=(const NonCopyable &) { }
+	NonCopyable(const NonCopyable &) = delete;
+	NonCopyable& operator=(const NonCopyable &) = delete;
 };
 
+#ifdef _MSC_VER
 static void DebugPrint(const char* fmt, ...)
 {
 	va_list argp;
@@ -86,6 +93,7 @@ static void DebugPrint(const char* fmt, ...)
 	va_end(argp);
 	OutputDebugString(buf);
 }
+#endif
 
 /** @brief |C^ƃTCỸZbg */
 struct MemoryChunk {
@@ -232,6 +240,9 @@ private:
 
 #include "StringUtils.hpp"
 
+// PrintFileAll܂łWin32 APIgt@C֘AȂ̂Windowŝ
+#ifdef _MSC_VER
+
 DWORD GetFullPathNameT(LPCWSTR lpFileName, DWORD nBufferLength, LPWSTR lpBuffer, LPWSTR* lpFilePart) {
 	return GetFullPathNameW(lpFileName, nBufferLength, lpBuffer, lpFilePart);
 }
@@ -394,6 +405,86 @@ private:
 	FILE* fp_;
 };
 
+// ǂݍݐp}bvht@C
+// 傫t@CłAhXԂHԂȂ悤Ƀr[PʂŃ}bv
+class MappedFile : NonCopyable
+{
+public:
+	MappedFile(const tstring& path, size_t viewSize = 64 * 1024 * 1024)
+		: path_(path)
+		, hFile_(INVALID_HANDLE_VALUE)
+		, hMap_(NULL)
+		, view_(NULL)
+		, size_(0)
+	{
+		// V[PVANZXw肵OS̐ǂ݂
+		hFile_ = CreateFileW(path.c_str(), GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (hFile_ == INVALID_HANDLE_VALUE) {
+			THROWF(IOException, "t@CJ܂: %s", GetFullPath(path));
+		}
+		LARGE_INTEGER sz;
+		if (GetFileSizeEx(hFile_, &sz) == 0) {
+			CloseHandle(hFile_);
+			THROWF(IOException, "GetFileSizeExɎs: %s", GetFullPath(path));
+		}
+		size_ = sz.QuadPart;
+		if (size_ > 0) {
+			hMap_ = CreateFileMappingW(hFile_, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (hMap_ == NULL) {
+				CloseHandle(hFile_);
+				THROWF(IOException, "CreateFileMappingɎs: %s", GetFullPath(path));
+			}
+		}
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		granularity_ = si.dwAllocationGranularity;
+		viewSize_ = std::max<size_t>(granularity_, viewSize / granularity_ * granularity_);
+	}
+	~MappedFile() {
+		unmap();
+		if (hMap_ != NULL) {
+			CloseHandle(hMap_);
+		}
+		CloseHandle(hFile_);
+	}
+	int64_t size() const {
+		return size_;
+	}
+	// offsetőŃr[TCY}bvĕԂ
+	// OԂf[^͖ɂȂBI[łlength=0
+	MemoryChunk map(int64_t offset) {
+		unmap();
+		if (offset >= size_) {
+			return MemoryChunk();
+		}
+		int64_t base = offset - offset % granularity_;
+		size_t length = (size_t)std::min<int64_t>(viewSize_, size_ - base);
+		view_ = (uint8_t*)MapViewOfFile(hMap_, FILE_MAP_READ,
+			(DWORD)(base >> 32), (DWORD)base, length);
+		if (view_ == NULL) {
+			THROWF(IOException, "MapViewOfFileɎs: %s", GetFullPath(path_));
+		}
+		size_t skip = (size_t)(offset - base);
+		return MemoryChunk(view_ + skip, length - skip);
+	}
+	void unmap() {
+		if (view_ != NULL) {
+			UnmapViewOfFile(view_);
+			view_ = NULL;
+		}
+	}
+private:
+	const tstring path_; // G[bZ[W\p
+	HANDLE hFile_;
+	HANDLE hMap_;
+	uint8_t* view_;
+	int64_t size_;
+	size_t granularity_;
+	size_t viewSize_;
+};
+
 template <typename T>
 void WriteArray(const File& file, const std::vector<T>& arr) {
 	file.writeValue((int)arr.size());
@@ -462,3 +553,140 @@ static void PrintFileAll(const tstring& path)
 	}
 }
 
+#endif // _MSC_VER
+
+// Œ蒷XCfBOEBhEp̃tB^
+// push()ŐVlāApop()ňԌÂlo
+// EBhEpush,pop̌ĂяoŌ܂
+
+// PfbNɂől pO(1)
+template <typename T>
+class SlidingWindowMax
+{
+	struct Entry {
+		int64_t index;
+		T value;
+	};
+	std::deque<Entry> deque_;
+	int64_t head_; // ԌÂl̃CfbNX
+	int64_t tail_; // pushl̃CfbNX
+public:
+	SlidingWindowMax() : head_(0), tail_(0) { }
+
+	void push(T value) {
+		// Vlȉ̒l͍őlɂȂ邱Ƃ͂Ȃ̂Ŏ̂Ă
+		while (deque_.size() > 0 && !(value < deque_.back().value)) {
+			deque_.pop_back();
+		}
+		deque_.push_back({ tail_++, value });
+	}
+	void pop() {
+		if (deque_.size() > 0 && deque_.front().index == head_) {
+			deque_.pop_front();
+		}
+		++head_;
+	}
+	int size() const {
+		return (int)(tail_ - head_);
+	}
+	// ̏ꍇ͌Ă΂Ȃ
+	T get() const {
+		return deque_.front().value;
+	}
+};
+
+// ړa O(1)
+// Accɂ͌덷܂Ȃ悤x̍^w肷
+template <typename T, typename Acc = double>
+class SlidingWindowSum
+{
+	std::deque<T> values_;
+	Acc sum_;
+public:
+	SlidingWindowSum() : sum_(0) { }
+
+	void push(T value) {
+		values_.push_back(value);
+		sum_ += value;
+	}
+	void pop() {
+		sum_ -= values_.front();
+		values_.pop_front();
+	}
+	int size() const {
+		return (int)values_.size();
+	}
+	Acc get() const {
+		return sum_;
+	}
+};
+
+// tWɂ钆l O(logW)
+// vf̏ꍇ͑傫Ԃi\[gz[size/2]Ɠj
+template <typename T>
+class SlidingWindowMedian
+{
+	std::deque<typename std::multiset<T>::iterator> order_;
+	std::multiset<T> set_;
+	typename std::multiset<T>::iterator mid_; // \[g[size/2]̗vf
+public:
+	void push(T value) {
+		auto it = set_.insert(value);
+		order_.push_back(it);
+		size_t size = set_.size();
+		if (size == 1) {
+			mid_ = it;
+		}
+		// lmultiset̖ɓ̂ŁAmidOǂ͒lŔł
+		else if (value < *mid_) {
+			// mid̈ʒu1ɂꂽ
+			if ((size & 1) != 0) {
+				--mid_;
+			}
+		}
+		else {
+			if ((size & 1) == 0) {
+				++mid_;
+			}
+		}
+	}
+	void pop() {
+		auto it = order_.front();
+		order_.pop_front();
+		size_t size = set_.size(); // 폜O̗vf
+		if (size == 1) {
+			set_.erase(it);
+			return;
+		}
+		if (it == mid_) {
+			mid_ = ((size & 1) != 0) ? std::next(mid_) : std::prev(mid_);
+		}
+		else if (*it < *mid_ || (!(*mid_ < *it) && IsBefore(it))) {
+			// mid̈ʒu1Oɂ
+			if ((size & 1) != 0) {
+				++mid_;
+			}
+		}
+		else {
+			if ((size & 1) == 0) {
+				--mid_;
+			}
+		}
+		set_.erase(it);
+	}
+	int size() const {
+		return (int)set_.size();
+	}
+	// ̏ꍇ͌Ă΂Ȃ
+	T get() const {
+		return *mid_;
+	}
+private:
+	// l̏ꍇitmidOɂ邩
+	bool IsBefore(typename std::multiset<T>::iterator it) const {
+		for (auto cur = it; cur != set_.end() && !(*mid_ < *cur); ++cur) {
+			if (cur == mid_) return true;
+		}
+		return false;
+	}
+};
@@ -63,32 +63,39 @@ public:
 		frameHeader.push_back(0x0a);
 		nc = vi.IsY() ? 1 : 3;
 	}
+	// t[̃͂ł̓Rs[AsƁiԂȂ΃v[Ɓjׂ̗̈1t[܂Ƃ߂ēn
+	// WindowsSubProcess::writev͏̈Ȃł珑̂ŁApfBÔs͂1Rs[
 	void inputFrame(const PVideoFrame& frame) {
+		chunks.clear();
 		if (n++ == 0) {
-			buffer.add(MemoryChunk((uint8_t*)header.data(), header.size()));
+			chunks.push_back(MemoryChunk((uint8_t*)header.data(), header.size()));
 		}
-		buffer.add(MemoryChunk((uint8_t*)frameHeader.data(), frameHeader.size()));
+		chunks.push_back(MemoryChunk((uint8_t*)frameHeader.data(), frameHeader.size()));
 		int yuv[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
 		for (int c = 0; c < nc; ++c) {
 			const uint8_t* plane = frame->GetReadPtr(yuv[c]);
 			int pitch = frame->GetPitch(yuv[c]);
 			int height = frame->GetHeight(yuv[c]);
 			int rowsize = frame->GetRowSize(yuv[c]);
+			if (pitch == rowsize) {
+				// ԂȂ΃v[Ŝ1
+				chunks.push_back(MemoryChunk((uint8_t*)plane, rowsize * height));
+				continue;
+			}
 			for (int y = 0; y < height; ++y) {
-				buffer.add(MemoryChunk((uint8_t*)plane + y * pitch, rowsize));
+				chunks.push_back(MemoryChunk((uint8_t*)plane + y * pitch, rowsize));
 			}
-			onWrite(buffer.get());
-			buffer.clear();
 		}
+		onWrite(chunks);
 	}
 protected:
-	virtual void onWrite(MemoryChunk mc) = 0;
+	virtual void onWrite(const std::vector<MemoryChunk>& chunks) = 0;
 private:
 	int n;
 	int nc;
 	std::string header;
 	std::string frameHeader;
-	AutoBuffer buffer;
+	std::vector<MemoryChunk> chunks;
 };
 
 class Y4MEncodeWriter : AMTObject, NonCopyable
@@ -148,8 +155,8 @@ private:
 			, this_(this_)
 		{ }
 	protected:
-		virtual void onWrite(MemoryChunk mc) {
-			this_->onVideoWrite(mc);
+		virtual void onWrite(const std::vector<MemoryChunk>& chunks) {
+			this_->onVideoWrite(chunks);
 		}
 	private:
 		Y4MEncodeWriter* this_;
@@ -158,8 +165,210 @@ private:
 	std::unique_ptr<MyVideoWriter> y4mWriter_;
 	std::unique_ptr<StdRedirectedSubProcess> process_;
 
-	void onVideoWrite(MemoryChunk mc) {
-		process_->write(mc);
+	void onVideoWrite(const std::vector<MemoryChunk>& chunks) {
+		process_->writev(chunks.data(), (int)chunks.size());
+	}
+};
+
+// 2pXGR[h1pXڂ̃tB^o͂ۑ2pXڂɎg񂷂߂̃LbV
+// YV12UtVideoňkAȊO͖kŕۑ
+// eʂ𒴂i݂ɎsjLbV͒߂
+class FilteredFrameCache : AMTObject {
+public:
+	FilteredFrameCache(AMTContext& ctx, const tstring& path, int64_t maxBytes)
+		: AMTObject(ctx)
+		, path_(path)
+		, maxBytes_(maxBytes)
+		, vi_()
+		, codec_(nullptr, DeleteUtVideoCodec)
+		, rawSize_()
+		, codedSize_()
+		, numWritten_()
+		, totalBytes_()
+		, available_(false)
+	{ }
+
+	void beginWrite(const VideoInfo& vi)
+	{
+		vi_ = vi;
+		numWritten_ = 0;
+		totalBytes_ = 0;
+		available_ = true;
+		writeTime_.reset();
+		readTime_.reset();
+
+		int nc = vi_.IsY() ? 1 : 3;
+		int yuv[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+		rawSize_ = 0;
+		for (int c = 0; c < nc; ++c) {
+			rawSize_ += (size_t)vi_.RowSize(yuv[c]) *
+				(vi_.height >> vi_.GetPlaneHeightSubsampling(yuv[c]));
+		}
+		rawFrame_ = std::unique_ptr<uint8_t[]>(new uint8_t[rawSize_]);
+
+		std::vector<uint8_t> extra;
+		if (vi_.IsYV12()) {
+			codec_ = make_unique_ptr(CCodec::CreateInstance(UTVF_ULH0, "Amatsukaze"));
+			codedSize_ = codec_->EncodeGetOutputSize(UTVF_YV12, vi_.width, vi_.height);
+			codedFrame_ = std::unique_ptr<uint8_t[]>(new uint8_t[codedSize_]);
+			extra.resize(codec_->EncodeGetExtraDataSize());
+			if (codec_->EncodeGetExtraData(extra.data(), extra.size(), UTVF_YV12, vi_.width, vi_.height)) {
+				THROW(RuntimeException, "failed to EncodeGetExtraData (UtVideo)");
+			}
+			if (codec_->EncodeBegin(UTVF_YV12, vi_.width, vi_.height, CBGROSSWIDTH_WINDOWS)) {
+				THROW(RuntimeException, "failed to EncodeBegin (UtVideo)");
+			}
+		}
+
+		file_ = std::unique_ptr<LosslessVideoFile>(new LosslessVideoFile(ctx, path_, _T("wb")));
+		file_->writeHeader(vi_.width, vi_.height, vi_.num_frames, extra);
+	}
+
+	// GR[hXbhĂ΂
+	void writeFrame(const PVideoFrame& frame)
+	{
+		if (!available_) return;
+		writeTime_.start();
+		try {
+			copyToRaw(frame);
+			const uint8_t* data = rawFrame_.get();
+			size_t len = rawSize_;
+			if (codec_) {
+				bool keyFrame = false;
+				len = codec_->EncodeFrame(codedFrame_.get(), &keyFrame, rawFrame_.get());
+				data = codedFrame_.get();
+			}
+			if (totalBytes_ + (int64_t)len > maxBytes_) {
+				ctx.infoF("t[LbV(%.0fMB)𒴂̂2pXڂtB^s܂",
+					maxBytes_ / (1024.0 * 1024.0));
+				abandon();
+			}
+			else {
+				file_->writeFrame(data, (int)len);
+				totalBytes_ += len;
+				++numWritten_;
+			}
+		}
+		catch (const Exception& e) {
+			ctx.warnF("t[LbV݂̏Ɏŝ2pXڂtB^s܂: %s", e.message());
+			abandon();
+		}
+		writeTime_.stop();
+	}
+
+	void endWrite()
+	{
+		if (codec_) {
+			codec_->EncodeEnd();
+		}
+		file_ = nullptr;
+		if (available_ && numWritten_ != vi_.num_frames) {
+			abandon();
+		}
+	}
+
+	bool isAvailable() const { return available_; }
+
+	void beginRead()
+	{
+		file_ = std::unique_ptr<LosslessVideoFile>(new LosslessVideoFile(ctx, path_, _T("rb")));
+		file_->readHeader();
+		if (codec_) {
+			auto extra = file_->getExtra();
+			if (codec_->DecodeBegin(UTVF_YV12, vi_.width, vi_.height, CBGROSSWIDTH_WINDOWS, extra.data(), (int)extra.size())) {
+				THROW(RuntimeException, "failed to DecodeBegin (UtVideo)");
+			}
+		}
+	}
+
+	PVideoFrame readFrame(int n, IScriptEnvironment* env)
+	{
+		readTime_.start();
+		PVideoFrame frame = env->NewVideoFrame(vi_);
+		if (codec_) {
+			file_->readFrame(n, codedFrame_.get());
+			if (codec_->DecodeFrame(rawFrame_.get(), codedFrame_.get()) != rawSize_) {
+				THROW(RuntimeException, "failed to DecodeFrame (UtVideo)");
+			}
+		}
+		else {
+			file_->readFrame(n, rawFrame_.get());
+		}
+		copyFromRaw(frame);
+		readTime_.stop();
+		return frame;
+	}
+
+	void endRead()
+	{
+		if (codec_) {
+			codec_->DecodeEnd();
+		}
+		// t@C͏̂ŁǍ̃pXi3pXڂȂǁj̓tB^ǂ
+		available_ = false;
+		file_ = nullptr;
+		removeT(path_.c_str());
+	}
+
+	int64_t getTotalBytes() const { return totalBytes_; }
+	double getWriteTime() const { return writeTime_.getTotal(); }
+	double getReadTime() const { return readTime_.getTotal(); }
+
+private:
+	tstring path_;
+	int64_t maxBytes_;
+	VideoInfo vi_;
+	CCodecPointer codec_;
+	std::unique_ptr<LosslessVideoFile> file_;
+	std::unique_ptr<uint8_t[]> rawFrame_;
+	std::unique_ptr<uint8_t[]> codedFrame_;
+	size_t rawSize_;
+	size_t codedSize_;
+	int numWritten_;
+	int64_t totalBytes_;
+	bool available_;
+	Stopwatch writeTime_;
+	Stopwatch readTime_;
+
+	void abandon()
+	{
+		available_ = false;
+		file_ = nullptr;
+		removeT(path_.c_str());
+	}
+
+	void copyToRaw(const PVideoFrame& frame)
+	{
+		int nc = vi_.IsY() ? 1 : 3;
+		int yuv[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+		uint8_t* dst = rawFrame_.get();
+		for (int c = 0; c < nc; ++c) {
+			const uint8_t* src = frame->GetReadPtr(yuv[c]);
+			int pitch = frame->GetPitch(yuv[c]);
+			int height = frame->GetHeight(yuv[c]);
+			int rowsize = frame->GetRowSize(yuv[c]);
+			for (int y = 0; y < height; ++y) {
+				memcpy(dst, src + y * pitch, rowsize);
+				dst += rowsize;
+			}
+		}
+	}
+
+	void copyFromRaw(PVideoFrame& frame)
+	{
+		int nc = vi_.IsY() ? 1 : 3;
+		int yuv[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+		const uint8_t* src = rawFrame_.get();
+		for (int c = 0; c < nc; ++c) {
+			uint8_t* dst = frame->GetWritePtr(yuv[c]);
+			int pitch = frame->GetPitch(yuv[c]);
+			int height = frame->GetHeight(yuv[c]);
+			int rowsize = frame->GetRowSize(yuv[c]);
+			for (int y = 0; y < height; ++y) {
+				memcpy(dst + y * pitch, src, rowsize);
+				src += rowsize;
+			}
+		}
 	}
 };
 
@@ -168,11 +377,18 @@ public:
 	AMTFilterVideoEncoder(
 		AMTContext&ctx, int numEncodeBufferFrames)
 		: AMTObject(ctx)
+		, cacheWriting_(false)
 		, thread_(this, numEncodeBufferFrames)
 	{
 		ctx.infoF("obt@Ot[: %d", numEncodeBufferFrames);
 	}
 
+	// 2pXȏ̂Ƃ1pXڂ̃tB^o͂pathɕۑ2pXڈȍ~Ŏg
+	void setFrameCache(const tstring& path, int64_t maxBytes)
+	{
+		cache_ = std::unique_ptr<FilteredFrameCache>(new FilteredFrameCache(ctx, path, maxBytes));
+	}
+
 	void encode(
 		PClip source, VideoFormat outfmt, const std::vector<double>& timeCodes,
 		const std::vector<tstring>& encoderOptions,
@@ -189,9 +405,21 @@ public:
 		}
 
 		int npass = (int)encoderOptions.size();
+		double filterTime = 0;
 		for (int i = 0; i < npass; ++i) {
 			ctx.infoF("%d/%dpX GR[hJn \t[: %d", i + 1, npass, vi_.num_frames);
 
+			bool readCache = (cache_ != nullptr && i > 0 && cache_->isAvailable());
+			cacheWriting_ = (cache_ != nullptr && i == 0 && npass > 1);
+			if (cacheWriting_) {
+				cache_->beginWrite(vi_);
+			}
+			if (readCache) {
+				ctx.info("tB^o͂̓LbVǂݍ݂܂");
+				cache_->beginRead();
+			}
+			Stopwatch swFilter;
+
 			const tstring& args = encoderOptions[i];
 
 			ctx.info("[GR[_N]");
@@ -210,7 +438,9 @@ public:
 			try {
 				// GR[h
 				for (int i = 0; i < vi_.num_frames; ++i) {
-					auto frame = source->GetFrame(i, env);
+					swFilter.start();
+					auto frame = readCache ? cache_->readFrame(i, env) : source->GetFrame(i, env);
+					swFilter.stop();
 					thread_.put(std::unique_ptr<PVideoFrame>(new PVideoFrame(frame)), 1);
 				}
 			}
@@ -228,6 +458,18 @@ public:
 			// ct[
 			encoder_->finish();
 
+			if (cacheWriting_) {
+				cache_->endWrite();
+				cacheWriting_ = false;
+				filterTime = swFilter.getTotal();
+			}
+			if (readCache) {
+				cache_->endRead();
+				ctx.infoF("t[LbV: %.1fMB  %.2fb ǂݍ %.2fb tB^ %.2fb Zk %.2fb",
+					cache_->getTotalBytes() / (1024.0 * 1024.0), cache_->getWriteTime(), cache_->getReadTime(),
+					filterTime, filterTime - cache_->getWriteTime() - cache_->getReadTime());
+			}
+
 			if (error) {
 				THROW(RuntimeException, "GR[hɕsȃG[");
 			}
@@ -251,6 +493,9 @@ private:
 	protected:
 		virtual void OnDataReceived(std::unique_ptr<PVideoFrame>&& data) {
 			this_->encoder_->inputFrame(*data);
+			if (this_->cacheWriting_) {
+				this_->cache_->writeFrame(*data);
+			}
 		}
 	private:
 		AMTFilterVideoEncoder * this_;
@@ -259,10 +504,217 @@ private:
 	VideoInfo vi_;
 	VideoFormat outfmt_;
 	std::unique_ptr<Y4MEncodeWriter> encoder_;
+	std::unique_ptr<FilteredFrameCache> cache_;
+	bool cacheWriting_;
 
 	SpDataPumpThread thread_;
 };
 
+// ][ED悵āAɂȂ悤Ƀ^CCԂɕ
+// eԂ̐擪̓L[t[ɂȂ̂ŁAȂׂV[ςƂŐ؂
+// ZԂ͍ȂiԐnumSegments菭ȂȂ邱Ƃj
+static std::vector<EncoderZone> MakeEncodeSegments(
+	int numFrames, const std::vector<EncoderZone>& zones, int numSegments, int minSegmentFrames)
+{
+	std::vector<int> candidates;
+	for (const auto& zone : zones) {
+		candidates.push_back(zone.startFrame);
+		candidates.push_back(zone.endFrame);
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	numSegments = std::max(1, std::min(numSegments, numFrames / std::max(1, minSegmentFrames)));
+	// ͈͓̔Ƀ][E΂Ő؂
+	int tolerance = numFrames / (numSegments * 4);
+
+	std::vector<int> splits;
+	splits.push_back(0);
+	for (int i = 1; i < numSegments; ++i) {
+		int target = (int)((int64_t)numFrames * i / numSegments);
+		int best = target;
+		int bestDist = tolerance + 1;
+		for (int c : candidates) {
+			if (std::abs(c - target) < bestDist) {
+				best = c;
+				bestDist = std::abs(c - target);
+			}
+		}
+		if (best - splits.back() >= minSegmentFrames && numFrames - best >= minSegmentFrames) {
+			splits.push_back(best);
+		}
+	}
+	splits.push_back(numFrames);
+
+	std::vector<EncoderZone> segments;
+	for (int i = 1; i < (int)splits.size(); ++i) {
+		EncoderZone segment = { splits[i - 1], splits[i] };
+		segments.push_back(segment);
+	}
+	return segments;
+}
+
+// ԂɊ܂܂][Ԑ擪̃t[ԍɂĕԂ
+static std::vector<BitrateZone> SliceBitrateZones(
+	const std::vector<BitrateZone>& zones, EncoderZone segment)
+{
+	std::vector<BitrateZone> sliced;
+	for (const auto& zone : zones) {
+		int start = std::max(zone.startFrame, segment.startFrame);
+		int end = std::min(zone.endFrame, segment.endFrame);
+		if (end > start) {
+			BitrateZone newZone = zone;
+			newZone.startFrame = start - segment.startFrame;
+			newZone.endFrame = end - segment.startFrame;
+			sliced.push_back(newZone);
+		}
+	}
+	return sliced;
+}
+
+// ԂƂ̃G^Xg[A
+// x264(--stitchable)x265̏o͂͊eԂwb_IDRn܂̂ł̂܂ܘAł
+static void ConcatEncodedSegments(const std::vector<tstring>& srcPaths, const tstring& dstPath)
+{
+	enum { BUFSIZE = 4 * 1024 * 1024 };
+	auto buffer = std::unique_ptr<uint8_t[]>(new uint8_t[BUFSIZE]);
+	File dst(dstPath, _T("wb"));
+	for (const auto& path : srcPaths) {
+		File src(path, _T("rb"));
+		size_t readBytes;
+		do {
+			readBytes = src.read(MemoryChunk(buffer.get(), BUFSIZE));
+			dst.write(MemoryChunk(buffer.get(), readBytes));
+		} while (readBytes == BUFSIZE);
+	}
+}
+
+// ^CCԂɕāÃGR[_vZXŕɃGR[h
+// 0͌Ăяo̊AȊO̓tB^XNvgԂƂ
+// ʂAviSynthŕ]ēǂށiAviSynth̊̓XbhZ[tłȂ߁j
+class AMTSegmentedVideoEncoder : public AMTObject {
+public:
+	AMTSegmentedVideoEncoder(AMTContext& ctx, int numEncodeBufferFrames)
+		: AMTObject(ctx)
+		, numEncodeBufferFrames_(numEncodeBufferFrames)
+	{ }
+
+	// encoderOptions,segmentPaths: ԂƂ̃GR[_Əo͐
+	// SԂ̃GR[hIoutpathɘA
+	void encode(
+		PClip source, IScriptEnvironment* env, const std::string& script,
+		VideoFormat outfmt, const std::vector<EncoderZone>& segments,
+		const std::vector<tstring>& encoderOptions,
+		const std::vector<tstring>& segmentPaths,
+		const tstring& outpath)
+	{
+		ctx.infoF("%dԂɕĕGR[h", (int)segments.size());
+		for (int i = 0; i < (int)segments.size(); ++i) {
+			ctx.infoF("%d: %d-%d", i + 1, segments[i].startFrame, segments[i].endFrame);
+		}
+
+		Stopwatch sw;
+		sw.start();
+
+		std::vector<std::unique_ptr<SegmentThread>> threads;
+		for (int i = 1; i < (int)segments.size(); ++i) {
+			threads.emplace_back(new SegmentThread(this, script, outfmt, segments[i], encoderOptions[i]));
+			threads.back()->start();
+		}
+
+		bool error = false;
+		std::string errorMessage;
+		try {
+			encodeSegment(source, env, outfmt, segments[0], encoderOptions[0]);
+		}
+		catch (const AvisynthError& avserror) {
+			error = true;
+			errorMessage = avserror.msg;
+		}
+		catch (const Exception& e) {
+			error = true;
+			errorMessage = e.message();
+		}
+		ctx.infoF("1 : %.2fb", sw.current());
+
+		for (int i = 0; i < (int)threads.size(); ++i) {
+			threads[i]->join();
+			ctx.infoF("%d : %.2fb", i + 2, threads[i]->getTime());
+			if (threads[i]->isError() && !error) {
+				error = true;
+				errorMessage = threads[i]->getErrorMessage();
+			}
+		}
+		if (error) {
+			THROWF(RuntimeException, "ԃGR[hɎs: %s", errorMessage.c_str());
+		}
+
+		ConcatEncodedSegments(segmentPaths, outpath);
+		ctx.infoF("GR[h: %.2fb", sw.getAndReset());
+	}
+
+private:
+	class SegmentThread : public ThreadBase {
+	public:
+		SegmentThread(AMTSegmentedVideoEncoder* this_, const std::string& script,
+			VideoFormat outfmt, EncoderZone segment, const tstring& args)
+			: this_(this_)
+			, script(script)
+			, outfmt(outfmt)
+			, segment(segment)
+			, args(args)
+			, time(0)
+			, error(false)
+		{ }
+		~SegmentThread() {
+			join();
+		}
+		double getTime() const { return time; }
+		bool isError() const { return error; }
+		const std::string& getErrorMessage() const { return errorMessage; }
+	protected:
+		virtual void run() {
+			Stopwatch sw;
+			sw.start();
+			ScriptEnvironmentPointer env = make_unique_ptr(CreateScriptEnvironment2());
+			try {
+				PClip clip = env->Invoke("Eval", script.c_str()).AsClip();
+				this_->encodeSegment(clip, env.get(), outfmt, segment, args);
+			}
+			catch (const AvisynthError& avserror) {
+				error = true;
+				errorMessage = avserror.msg;
+			}
+			catch (const Exception& e) {
+				error = true;
+				errorMessage = e.message();
+			}
+			time = sw.getAndReset();
+		}
+	private:
+		AMTSegmentedVideoEncoder* this_;
+		std::string script;
+		VideoFormat outfmt;
+		EncoderZone segment;
+		tstring args;
+		double time;
+		bool error;
+		std::string errorMessage;
+	};
+
+	int numEncodeBufferFrames_;
+
+	void encodeSegment(PClip source, IScriptEnvironment* env,
+		VideoFormat outfmt, EncoderZone segment, const tstring& args)
+	{
+		// Trim̑2̂Ƃ̓t[
+		AVSValue trimArgs[] = { source, segment.startFrame, -(segment.endFrame - segment.startFrame) };
+		PClip clip = env->Invoke("Trim", AVSValue(trimArgs, 3)).AsClip();
+		AMTFilterVideoEncoder encoder(ctx, numEncodeBufferFrames_);
+		std::vector<tstring> encoderOptions = { args };
+		encoder.encode(clip, outfmt, std::vector<double>(), encoderOptions, env);
+	}
+};
+
 class AMTSimpleVideoEncoder : public AMTObject {
 public:
 	AMTSimpleVideoEncoder(
@@ -223,6 +223,7 @@ public:
 		: AMTObject(ctx)
 		, setting_(setting)
 		, env_(make_unique_ptr((IScriptEnvironment2*)nullptr))
+		, encodeRes_()
 		, vfrTimingFps_(0)
 	{
 		try {
@@ -251,6 +252,7 @@ public:
 			// GR[hp\[XŃAtBjeBݒ
 			res = encodeRes;
 			SetCPUAffinity(res.group, res.mask);
+			encodeRes_ = encodeRes;
 			if (env_ == nullptr) {
 				FilterPass(pass, res.gpuIndex, key, reformInfo, logopath);
 			}
@@ -330,9 +332,15 @@ public:
 		return env_.get();
 	}
 
+	// GR[hpɊmۂ\[X
+	const ResourceAllocation& getEncodeResource() const {
+		return encodeRes_;
+	}
+
 private:
 	const ConfigWrapper& setting_;
 	ScriptEnvironmentPointer env_;
+	ResourceAllocation encodeRes_;
 	AvsScript script_;
 	PClip filter_;
 	VideoFormat outfmt_;
@@ -446,7 +454,9 @@ private:
 		auto& sb = script_.Get();
 		sb.append("function MakeSource(bool \"mt\") {\n");
 		sb.append("\tmt = default(mt, false)\n");
-		sb.append("\tAMTSource(\"%s\")\n", setting_.getTmpAMTSourcePath(key.video));
+		sb.append("\tAMTSource(\"%s\", cachesize=%d, readahead=%d)\n",
+			setting_.getTmpAMTSourcePath(key.video),
+			setting_.getSourceCacheSize(), setting_.getSourceReadAhead());
 		sb.append("\tif(mt) { Prefetch(1, 4) }\n");
 
 		int numEraseLogo = 0;
@@ -618,10 +618,6 @@ public:
 
 
 class H264VideoParser : public AMTObject, public IVideoParser {
-	struct NalUnit {
-		int offset;
-		int length; // rbsp_trailing_bits
-	};
 public:
 
 	H264VideoParser(AMTContext& ctx)
@@ -664,13 +660,12 @@ public:
 
 		for (int i = 0; i < numNalUnits; ++i) {
 			NalUnit nalUnit = nalUnits[i];
-			int payloadLength = nalUnit.length;
+			int payloadLength = nalUnit.length - 1;
+			// yC[hSEI,SPS,PPS,AUf~^̂bufferɓĂ
 			uint8_t* ptr = buffer.ptr() + nalUnit.offset;
 
-			uint8_t nal_ref_idc = bsm(ptr[0], 5, 2);
-			uint8_t nal_unit_type = bsm(ptr[0], 0, 5);
-
-			++ptr; --payloadLength;
+			uint8_t nal_ref_idc = bsm(nalUnit.header, 5, 2);
+			uint8_t nal_unit_type = bsm(nalUnit.header, 0, 5);
 
 			switch (nal_unit_type) {
 			case 1: // IDRȊÕsN`̃XCX
@@ -842,10 +837,57 @@ public:
 		return info.size() > 0;
 	}
 
-private:
+protected:
+	struct NalUnit {
+		uint8_t header; // NALwb_irbsp_stop_one_bit菜j
+		int offset; // bufferł̃yC[hiwb_̎̃oCgj̈ʒu
+		int length; // rbsp_trailing_bitsiwb_܂ށj
+	};
+
+	// NALjbg؂onalUnitsɓ
+	// yC[h͂NALjbgG~[Vh~oCg菜bufferɓ
+	virtual void storeBuffer(MemoryChunk frame) {
+		buffer.clear();
+		nalUnits.clear();
+		escapes.clear();
+		uint8_t* data = frame.data;
+		int length = (int)frame.length;
+		int unitStart = 0;
+		// 00 00 01(JnR[h), 00 00 03(G~[Vh~) T
+		// 擪2oCg͎n܂Ȃ
+		int p = 0;
+		while (true) {
+			int next = FindStartCodeCandidate(data + p, length - p);
+			if (next < 0) {
+				break;
+			}
+			p += next;
+			uint8_t c = data[p + 2];
+			if (c == 0x01) {
+				// start code prefix
+				pushNalUnit(data, unitStart, p + 2);
+				unitStart = p + 3;
+				escapes.clear();
+				p += 3;
+			}
+			else if (c == 0x03) {
+				escapes.push_back(p + 2);
+				p += 3;
+			}
+			else {
+				p += (c == 0) ? 1 : 3;
+			}
+		}
+		pushNalUnit(data, unitStart, length);
+	}
+
 	AutoBuffer buffer;
 	std::vector<NalUnit> nalUnits;
 
+private:
+	// ݂NALjbg̃G~[Vh~oCg̈ʒu
+	std::vector<int> escapes;
+
 	// O beffering period  DTS;
 	int64_t beffering_period_DTS;
 
@@ -873,56 +915,64 @@ private:
 		}
 	}
 
-	void pushNalUnit(int unitStart, int lastNonZero) {
-		if (lastNonZero > 0) {
-			NalUnit nal;
-			nal.offset = unitStart;
-			// rbsp_stop_one_bit菜
-			uint8_t& lastByte = buffer.ptr()[lastNonZero - 1];
-			if (lastByte == 0x80) {
-				// yC[h͂̃oCgɂ͂Ȃ̂1oCg
-				--lastNonZero;
+	// data[unitStart]n܂data[end]OŏINALjbgǉ
+	void pushNalUnit(uint8_t* data, int unitStart, int end) {
+		// ŏNALjbg̐擪2oCg͌Ȃ
+		int minPos = std::max(unitStart, 2);
+		int numEscapes = (int)escapes.size();
+		// 0ƃG~[Vh~oCg΂
+		int last = end - 1;
+		while (last >= minPos) {
+			if (numEscapes > 0 && escapes[numEscapes - 1] == last) {
+				--numEscapes;
 			}
-			else {
-				lastByte &= lastByte - 1;
+			else if (data[last] != 0) {
+				break;
 			}
-			nal.length = lastNonZero - unitStart;
-			nalUnits.push_back(nal);
+			--last;
 		}
-	}
-
-	void storeBuffer(MemoryChunk frame) {
-		buffer.clear();
-		nalUnits.clear();
-		buffer.add(MemoryChunk(frame.data, 2));
-		int32_t n3bytes = (frame.data[0] << 8) | frame.data[1];
-		int unitStart = 0;
-		int lastNonZero = 0;
-		int unitStartOrig = 0;
-		int lastNonZeroOrig = 0;
-		for (int i = 2; i < (int)frame.length; ++i) {
-			uint8_t inByte = frame.data[i];
-			n3bytes = ((n3bytes & 0xFFFF) << 8) | inByte;
-			if (n3bytes == 0x03) {
-				// skip one byte
-				//PRINTF("Skip one byte (H264 NAL)\n");
+		if (last < minPos) {
+			if (unitStart > 0) {
+				// ĝȂNALjbg
+				NalUnit nal = NalUnit();
+				nalUnits.push_back(nal);
 			}
-			else {
-				buffer.add(inByte);
-				int k = (int)buffer.size();
-
-				if (n3bytes == 0x01) {
-					// start code prefix
-					pushNalUnit(unitStart, lastNonZero);
-					unitStart = k;
-					unitStartOrig = i;
-				}
-				if (inByte) {
-					lastNonZero = k;
-					lastNonZeroOrig = i;
+			return;
+		}
+
+		NalUnit nal;
+		nal.length = last + 1 - unitStart - numEscapes;
+		// rbsp_stop_one_bit菜
+		uint8_t lastByte = data[last];
+		if (lastByte == 0x80) {
+			// yC[h͂̃oCgɂ͂Ȃ̂1oCg
+			--nal.length;
+		}
+		else {
+			lastByte &= lastByte - 1;
+		}
+		nal.header = (nal.length <= 0) ? 0 : (last == unitStart) ? lastByte : data[unitStart];
+		nal.offset = 0;
+
+		switch (bsm(nal.header, 0, 5)) {
+		case 6: // SEI
+		case 7: // SPS
+		case 8: // PPS
+		case 9: // AUf~^
+			// yC[h͂̂ŃG~[Vh~oCg菜ăRs[
+			nal.offset = (int)buffer.size();
+			if (last > unitStart) {
+				int from = unitStart + 1;
+				for (int i = 0; i < numEscapes; ++i) {
+					buffer.add(MemoryChunk(data + from, escapes[i] - from));
+					from = escapes[i] + 1;
 				}
+				buffer.add(MemoryChunk(data + from, last + 1 - from));
+				buffer.ptr()[buffer.size() - 1] = lastByte;
 			}
+			break;
 		}
-		pushNalUnit(unitStart, lastNonZero);
+
+		nalUnits.push_back(nal);
 	}
 };
@@ -16,6 +16,7 @@
 #include "AMTLogo.hpp"
 #include "TsInfo.hpp"
 #include "TextOut.h"
+#include "ProcessThread.hpp"
 
 #include <cmath>
 #include <numeric>
@@ -42,7 +43,30 @@ float CalcCorrelation5x5(const float* k, const float* Y, int x, int y, int w, fl
 
 // ComputeKernel.cpp
 bool IsAVXAvailable();
+bool IsAVX2Available();
 float CalcCorrelation5x5_AVX(const float* k, const float* Y, int x, int y, int w, float* pavg);
+void AddLogoScanLine8_AVX2(uint32_t* sumF, uint32_t* sumF2, uint32_t* sumFB, const uint8_t* src, int w, int b);
+void AddLogoScanLine16_AVX2(uint64_t* sumF, uint64_t* sumF2, uint64_t* sumFB, const uint16_t* src, int w, int b);
+
+void AddLogoScanLine8(uint32_t* sumF, uint32_t* sumF2, uint32_t* sumFB, const uint8_t* src, int w, int b)
+{
+	for (int x = 0; x < w; ++x) {
+		uint32_t f = src[x];
+		sumF[x] += f;
+		sumF2[x] += f * f;
+		sumFB[x] += f * b;
+	}
+}
+
+void AddLogoScanLine16(uint64_t* sumF, uint64_t* sumF2, uint64_t* sumFB, const uint16_t* src, int w, int b)
+{
+	for (int x = 0; x < w; ++x) {
+		uint64_t f = src[x];
+		sumF[x] += f;
+		sumF2[x] += f * f;
+		sumFB[x] += f * (uint64_t)b;
+	}
+}
 
 #if 0
 float CalcCorrelation5x5_Debug(const float* k, const float* Y, int x, int y, int w, float* pavg)
@@ -254,6 +278,68 @@ public:
 		return CorrelationScore(work, maxv) / blackScore;
 	}
 
+	// 複数のfade値でまとめて評価
+	// ロゴ除去後の値 fade*(a*src+b*maxv)+(1-fade)*src = src+fade*(a*src+b*maxv-src) は
+	// fadeに対して線形なので、相関とウィンドウ平均も線形になる。
+	// srcと除去差分の相関を1回ずつ取れば全fade値の相関が求まる
+	// work: w*h*2+8以上必要
+	void EvaluateLogoMulti(const float *src, float maxv,
+		const float* fades, int numFades, float* result, float* work, int stride = -1)
+	{
+		const float *logoAY = GetA(PLANAR_Y);
+		const float *logoBY = GetB(PLANAR_Y);
+
+		if (stride == -1) {
+			stride = w;
+		}
+
+		float* workS = work;
+		float* workD = work + w * h;
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				float srcv = src[x + y * stride];
+				float a = logoAY[x + y * w];
+				float b = logoBY[x + y * w];
+				workS[x + y * w] = srcv;
+				workD[x + y * w] = a * srcv + b * maxv - srcv;
+			}
+		}
+
+		const uint8_t* mask = GetMask();
+		const float* kernels = GetKernels();
+
+		std::fill_n(result, numFades, 0.0f);
+		int count = 0;
+		for (int y = 2; y < h - 2; ++y) {
+			for (int x = 2; x < w - 2; ++x) {
+				if (mask[x + y * w]) {
+					const float* k = &kernels[count * KLEN];
+					const ScaleLimit* s = &scales[count * CLEN];
+
+					float avgS, avgD;
+					float sumS = pCalcCorrelation5x5(k, workS, x, y, w, &avgS);
+					float sumD = pCalcCorrelation5x5(k, workD, x, y, w, &avgD);
+
+					for (int f = 0; f < numFades; ++f) {
+						float avg = avgS + fades[f] * avgD;
+						float sum = sumS + fades[f] * sumD;
+						// 以下CorrelationScoreと同じ
+						ScaleLimit sl = s[std::max(0, std::min(255, (int)avg)) >> CSHIFT];
+						float normalized = std::max(-1.0f, std::min(1.0f, sum * sl.scale));
+						result[f] += normalized * sl.scale2;
+					}
+
+					++count;
+				}
+			}
+		}
+
+		// 正規化
+		for (int f = 0; f < numFades; ++f) {
+			result[f] /= blackScore;
+		}
+	}
+
 	std::unique_ptr<LogoDataParam> MakeFieldLogo(bool bottom)
 	{
 		auto logo = std::unique_ptr<LogoDataParam>(
@@ -345,34 +431,14 @@ class LogoColor
 {
 	double sumF, sumB, sumF2, sumB2, sumFB;
 public:
-	LogoColor()
-		: sumF()
-		, sumB()
-		, sumF2()
-		, sumB2()
-		, sumFB()
+	LogoColor(double sumF, double sumB, double sumF2, double sumB2, double sumFB)
+		: sumF(sumF)
+		, sumB(sumB)
+		, sumF2(sumF2)
+		, sumB2(sumB2)
+		, sumFB(sumFB)
 	{ }
 
-	// ピクセルの色を追加 f:前景 b:背景
-	void Add(int f, int b)
-	{
-		sumF += f;
-		sumB += b;
-		sumF2 += f * f;
-		sumB2 += b * b;
-		sumFB += f * b;
-	}
-
-	// 値を0～1に正規化
-	void Normalize(int maxv)
-	{
-		sumF /= (double)maxv;
-		sumB /= (double)maxv;
-		sumF2 /= (double)maxv*maxv;
-		sumB2 /= (double)maxv*maxv;
-		sumFB /= (double)maxv*maxv;
-	}
-
 	/*====================================================================
 	* 	GetAB_?()
 	* 		回帰直線の傾きと切片を返す X軸:前景 Y軸:背景
@@ -395,6 +461,114 @@ public:
 	}
 };
 
+// 1プレーン分のロゴスキャン積算値
+// ピクセルごとの値は別々の配列に持つ（SoA）
+// 背景色はフレーム内で一定なのでsumB,sumB2はプレーンで1つだけ持つ
+// 全て整数で積算するので、積算の順序や分割によらず結果は同じになる
+class LogoColorPlane
+{
+	enum {
+		// 8bitで32bit積算が溢れない最大フレーム数（255*255*65536 < 2^32）
+		BLOCK_FRAMES = 65536
+	};
+
+	int w, h;
+	std::unique_ptr<uint64_t[]> sumF, sumF2, sumFB;
+	// 8bit用の32bit積算（BLOCK_FRAMESごとにsumF,sumF2,sumFBに移す）
+	std::unique_ptr<uint32_t[]> blkF, blkF2, blkFB;
+	int blkFrames;
+	uint64_t sumB, sumB2;
+
+	void(*pAddLine8)(uint32_t* sumF, uint32_t* sumF2, uint32_t* sumFB, const uint8_t* src, int w, int b);
+	void(*pAddLine16)(uint64_t* sumF, uint64_t* sumF2, uint64_t* sumFB, const uint16_t* src, int w, int b);
+
+	void Flush()
+	{
+		int size = w * h;
+		for (int i = 0; i < size; ++i) {
+			sumF[i] += blkF[i];
+			sumF2[i] += blkF2[i];
+			sumFB[i] += blkFB[i];
+		}
+		std::fill_n(blkF.get(), size, 0);
+		std::fill_n(blkF2.get(), size, 0);
+		std::fill_n(blkFB.get(), size, 0);
+		blkFrames = 0;
+	}
+
+	void AddPlane(const uint8_t* src, int pitch, int b)
+	{
+		if (blkFrames == BLOCK_FRAMES) {
+			Flush();
+		}
+		for (int y = 0; y < h; ++y) {
+			pAddLine8(&blkF[y * w], &blkF2[y * w], &blkFB[y * w], src + y * pitch, w, b);
+		}
+		++blkFrames;
+	}
+
+	void AddPlane(const uint16_t* src, int pitch, int b)
+	{
+		for (int y = 0; y < h; ++y) {
+			pAddLine16(&sumF[y * w], &sumF2[y * w], &sumFB[y * w], src + y * pitch, w, b);
+		}
+	}
+
+public:
+	LogoColorPlane(int w, int h)
+		: w(w)
+		, h(h)
+		, sumF(new uint64_t[w * h]())
+		, sumF2(new uint64_t[w * h]())
+		, sumFB(new uint64_t[w * h]())
+		, blkF(new uint32_t[w * h]())
+		, blkF2(new uint32_t[w * h]())
+		, blkFB(new uint32_t[w * h]())
+		, blkFrames()
+		, sumB()
+		, sumB2()
+	{
+		bool avx2 = IsAVX2Available();
+		pAddLine8 = avx2 ? AddLogoScanLine8_AVX2 : AddLogoScanLine8;
+		pAddLine16 = avx2 ? AddLogoScanLine16_AVX2 : AddLogoScanLine16;
+	}
+
+	// 1フレーム分のピクセルの色を追加 src:前景 b:背景
+	template <typename pixel_t>
+	void Add(const pixel_t* src, int pitch, int b)
+	{
+		AddPlane(src, pitch, b);
+		sumB += b;
+		sumB2 += (uint64_t)b * b;
+	}
+
+	// 別のフレーム範囲の積算値を足す
+	void Merge(const LogoColorPlane& o)
+	{
+		int size = w * h;
+		for (int i = 0; i < size; ++i) {
+			sumF[i] += o.sumF[i] + o.blkF[i];
+			sumF2[i] += o.sumF2[i] + o.blkF2[i];
+			sumFB[i] += o.sumFB[i] + o.blkFB[i];
+		}
+		sumB += o.sumB;
+		sumB2 += o.sumB2;
+	}
+
+	// 値を0～1に正規化したもの
+	LogoColor Get(int off, int maxv) const
+	{
+		double m = maxv;
+		double m2 = (double)maxv * maxv;
+		return LogoColor(
+			(double)(sumF[off] + blkF[off]) / m,
+			(double)sumB / m,
+			(double)(sumF2[off] + blkF2[off]) / m2,
+			(double)sumB2 / m2,
+			(double)(sumFB[off] + blkFB[off]) / m2);
+	}
+};
+
 class LogoScan
 {
 	int scanw;
@@ -406,7 +580,8 @@ class LogoScan
 	std::vector<short> tmpY, tmpU, tmpV;
 
 	int nframes;
-	std::unique_ptr<LogoColor[]> logoY, logoU, logoV;
+	int maxv;
+	LogoColorPlane logoY, logoU, logoV;
 
 	/*--------------------------------------------------------------------
 	*	真中らへんを平均
@@ -462,29 +637,26 @@ public:
 		, logUVy(logUVy)
 		, thy(thy)
 		, nframes()
-		, logoY(new LogoColor[scanw*scanh])
-		, logoU(new LogoColor[scanw*scanh >> (logUVx + logUVy)])
-		, logoV(new LogoColor[scanw*scanh >> (logUVx + logUVy)])
+		, maxv(1)
+		, logoY(scanw, scanh)
+		, logoU(scanw >> logUVx, scanh >> logUVy)
+		, logoV(scanw >> logUVx, scanh >> logUVy)
 	{
 	}
 
+	// 正規化はGetLogo()で行う
 	void Normalize(int mavx)
 	{
-		int scanUVw = scanw >> logUVx;
-		int scanUVh = scanh >> logUVy;
+		maxv = mavx;
+	}
 
-		// 8bitなので255
-		for (int y = 0; y < scanh; ++y) {
-			for (int x = 0; x < scanw; ++x) {
-				logoY[x + y * scanw].Normalize(mavx);
-			}
-		}
-		for (int y = 0; y < scanUVh; ++y) {
-			for (int x = 0; x < scanUVw; ++x) {
-				logoU[x + y * scanUVw].Normalize(mavx);
-				logoV[x + y * scanUVw].Normalize(mavx);
-			}
-		}
+	// 別のフレーム範囲をスキャンした結果を足す
+	void Merge(const LogoScan& o)
+	{
+		logoY.Merge(o.logoY);
+		logoU.Merge(o.logoU);
+		logoV.Merge(o.logoV);
+		nframes += o.nframes;
 	}
 
 	std::unique_ptr<LogoData> GetLogo(bool clean) const
@@ -502,14 +674,14 @@ public:
 		for (int y = 0; y < scanh; ++y) {
 			for (int x = 0; x < scanw; ++x) {
 				int off = x + y * scanw;
-				if (!logoY[off].GetAB(aY[off], bY[off], nframes)) return nullptr;
+				if (!logoY.Get(off, maxv).GetAB(aY[off], bY[off], nframes)) return nullptr;
 			}
 		}
 		for (int y = 0; y < scanUVh; ++y) {
 			for (int x = 0; x < scanUVw; ++x) {
 				int off = x + y * scanUVw;
-				if (!logoU[off].GetAB(aU[off], bU[off], nframes)) return nullptr;
-				if (!logoV[off].GetAB(aV[off], bV[off], nframes)) return nullptr;
+				if (!logoU.Get(off, maxv).GetAB(aU[off], bU[off], nframes)) return nullptr;
+				if (!logoV.Get(off, maxv).GetAB(aV[off], bV[off], nframes)) return nullptr;
 			}
 		}
 
@@ -573,30 +745,21 @@ public:
 		int pitchY, int pitchUV,
 		int bgY, int bgU, int bgV)
 	{
-		int scanUVw = scanw >> logUVx;
-		int scanUVh = scanh >> logUVy;
-
-		for (int y = 0; y < scanh; ++y) {
-			for (int x = 0; x < scanw; ++x) {
-				logoY[x + y * scanw].Add(srcY[x + y * pitchY], bgY);
-			}
-		}
-		for (int y = 0; y < scanUVh; ++y) {
-			for (int x = 0; x < scanUVw; ++x) {
-				logoU[x + y * scanUVw].Add(srcU[x + y * pitchUV], bgU);
-				logoV[x + y * scanUVw].Add(srcV[x + y * pitchUV], bgV);
-			}
-		}
+		logoY.Add(srcY, pitchY, bgY);
+		logoU.Add(srcU, pitchUV, bgU);
+		logoV.Add(srcV, pitchUV, bgV);
 
 		++nframes;
 	}
 
+	// 背景が単一色ならその色を返す
 	template <typename pixel_t>
-	bool AddFrame(
+	bool GetBackground(
 		const pixel_t* srcY,
 		const pixel_t* srcU,
 		const pixel_t* srcV,
-		int pitchY, int pitchUV)
+		int pitchY, int pitchUV,
+		int& bgY, int& bgU, int& bgV)
 	{
 		int scanUVw = scanw >> logUVx;
 		int scanUVh = scanh >> logUVy;
@@ -648,9 +811,24 @@ public:
 			return false;
 		}
 
-		int bgY = med_average(tmpY);
-		int bgU = med_average(tmpU);
-		int bgV = med_average(tmpV);
+		bgY = med_average(tmpY);
+		bgU = med_average(tmpU);
+		bgV = med_average(tmpV);
+
+		return true;
+	}
+
+	template <typename pixel_t>
+	bool AddFrame(
+		const pixel_t* srcY,
+		const pixel_t* srcU,
+		const pixel_t* srcV,
+		int pitchY, int pitchUV)
+	{
+		int bgY, bgU, bgV;
+		if (!GetBackground(srcY, srcU, srcV, pitchY, pitchUV, bgY, bgU, bgV)) {
+			return false;
+		}
 
 		// 有効フレームを追加
 		AddScanFrame(srcY, srcU, srcV, pitchY, pitchUV, bgY, bgU, bgV);
@@ -811,18 +989,25 @@ class LogoAnalyzer : AMTObject
 	float progressbase;
 
 	// 今の所可逆圧縮が8bitのみなので対応は8bitのみ
+	// 背景色の判定はデコード順に行い、有効フレームの積算はバッチごとに
+	// スレッドで分けて行う（積算は整数なので分けて合算しても結果は同じ）
 	class InitialLogoCreator : SimpleVideoReader
 	{
+		enum { BATCH_FRAMES = 128 };
+
 		LogoAnalyzer* pThis;
 		CCodecPointer codec;
 		size_t scanDataSize;
 		size_t codedSize;
 		int readCount;
 		int64_t filesize;
-		std::unique_ptr<uint8_t[]> memScanData;
+		std::unique_ptr<uint8_t[]> memBatch;
+		std::unique_ptr<int[]> batchBg;
+		int batchCount;
 		std::unique_ptr<uint8_t[]> memCoded;
 		std::unique_ptr<LosslessVideoFile> file;
-		std::unique_ptr<LogoScan> logoscan;
+		ParallelTaskPool pool;
+		std::vector<std::unique_ptr<LogoScan>> logoscans;
 	public:
 		InitialLogoCreator(LogoAnalyzer* pThis)
 			: SimpleVideoReader(pThis->ctx)
@@ -831,8 +1016,12 @@ class LogoAnalyzer : AMTObject
 			, scanDataSize(pThis->scanw * pThis->scanh * 3 / 2)
 			, codedSize(codec->EncodeGetOutputSize(UTVF_YV12, pThis->scanw, pThis->scanh))
 			, readCount()
-			, memScanData(new uint8_t[scanDataSize])
+			, memBatch(new uint8_t[scanDataSize * BATCH_FRAMES])
+			, batchBg(new int[3 * BATCH_FRAMES])
+			, batchCount()
 			, memCoded(new uint8_t[codedSize])
+			// デコーダもスレッドを使うので控えめにする
+			, pool(std::max(1, std::min(GetProcessorCount() / 2, 4)))
 		{ }
 		void readAll(const tstring& src, int serviceid)
 		{
@@ -842,6 +1031,15 @@ class LogoAnalyzer : AMTObject
 
 			codec->EncodeEnd();
 
+			if (logoscans.size() == 0) {
+				THROW(RuntimeException, "Insufficient logo frames");
+			}
+			flushBatch();
+			auto& logoscan = logoscans[0];
+			for (int t = 1; t < (int)logoscans.size(); ++t) {
+				logoscan->Merge(*logoscans[t]);
+			}
+
 			logoscan->Normalize(255);
 			pThis->logodata = logoscan->GetLogo(false);
 			if (pThis->logodata == nullptr) {
@@ -870,8 +1068,10 @@ class LogoAnalyzer : AMTObject
 
 			file = std::unique_ptr<LosslessVideoFile>(
 				new LosslessVideoFile(pThis->ctx, pThis->workfile, _T("wb")));
-			logoscan = std::unique_ptr<LogoScan>(
-				new LogoScan(pThis->scanw, pThis->scanh, pThis->logUVx, pThis->logUVy, pThis->thy));
+			for (int t = 0; t < pool.getNumThreads(); ++t) {
+				logoscans.emplace_back(
+					new LogoScan(pThis->scanw, pThis->scanh, pThis->logUVx, pThis->logUVy, pThis->thy));
+			}
 
 			// フレーム数は最大フレーム数（実際はそこまで書き込まないこともある）
 			file->writeHeader(pThis->scanw, pThis->scanh, pThis->numMaxFrames, extra);
@@ -893,14 +1093,20 @@ class LogoAnalyzer : AMTObject
 			const uint8_t* scanU = frame->data[1] + offUV;
 			const uint8_t* scanV = frame->data[2] + offUV;
 
-			if (logoscan->AddFrame(scanY, scanU, scanV, pitchY, pitchUV)) {
+			int* bg = &batchBg[3 * batchCount];
+			if (logoscans[0]->GetBackground(scanY, scanU, scanV, pitchY, pitchUV, bg[0], bg[1], bg[2])) {
 				++pThis->numFrames;
 
 				// 有効なフレームは保存しておく
-				CopyYV12(memScanData.get(), scanY, scanU, scanV, pitchY, pitchUV, pThis->scanw, pThis->scanh);
+				uint8_t* scanData = &memBatch[scanDataSize * batchCount];
+				CopyYV12(scanData, scanY, scanU, scanV, pitchY, pitchUV, pThis->scanw, pThis->scanh);
 				bool keyFrame = false;
-				size_t codedSize = codec->EncodeFrame(memCoded.get(), &keyFrame, memScanData.get());
+				size_t codedSize = codec->EncodeFrame(memCoded.get(), &keyFrame, scanData);
 				file->writeFrame(memCoded.get(), (int)codedSize);
+
+				if (++batchCount == BATCH_FRAMES) {
+					flushBatch();
+				}
 			}
 
 			if ((readCount % 200) == 0) {
@@ -912,6 +1118,108 @@ class LogoAnalyzer : AMTObject
 
 			return true;
 		};
+
+	private:
+		// バッチ内のフレームをスレッドごとのLogoScanに積算
+		void flushBatch()
+		{
+			int scanw = pThis->scanw;
+			int scanUVw = scanw >> pThis->logUVx;
+			int offU = scanw * pThis->scanh;
+			int offV = offU + scanUVw * (pThis->scanh >> pThis->logUVy);
+			int numTasks = (int)logoscans.size();
+			std::vector<std::function<void()>> tasks;
+			for (int t = 0; t < numTasks; ++t) {
+				int start = batchCount * t / numTasks;
+				int end = batchCount * (t + 1) / numTasks;
+				LogoScan* logoscan = logoscans[t].get();
+				tasks.push_back([=]() {
+					for (int i = start; i < end; ++i) {
+						const uint8_t* ptr = &memBatch[scanDataSize * i];
+						const int* bg = &batchBg[3 * i];
+						logoscan->AddScanFrame(ptr, ptr + offU, ptr + offV,
+							scanw, scanUVw, bg[0], bg[1], bg[2]);
+					}
+				});
+			}
+			pool.runAll(tasks);
+			batchCount = 0;
+		}
+	};
+
+	// ReMakeLogoの再スキャンをフレーム範囲ごとに行うスレッド
+	// 積算は整数なので範囲を分けて合算しても結果は同じ
+	class ReScanThread : public ThreadBase
+	{
+		LogoAnalyzer* pThis;
+		const int* minFades;
+		int minFadeIndex;
+		int start, end;
+	public:
+		LogoScan logoscan;
+		bool error;
+		std::string errorMessage;
+
+		ReScanThread(LogoAnalyzer* pThis, const int* minFades, int minFadeIndex, int start, int end)
+			: pThis(pThis)
+			, minFades(minFades)
+			, minFadeIndex(minFadeIndex)
+			, start(start)
+			, end(end)
+			, logoscan(pThis->scanw, pThis->scanh, pThis->logUVx, pThis->logUVy, pThis->thy)
+			, error(false)
+		{ }
+
+	protected:
+		virtual void run()
+		{
+			try {
+				scan();
+			}
+			catch (const Exception& e) {
+				error = true;
+				errorMessage = e.message();
+			}
+		}
+
+	private:
+		void scan()
+		{
+			int scanw = pThis->scanw;
+			int scanh = pThis->scanh;
+			auto codec = make_unique_ptr(CCodec::CreateInstance(UTVF_ULH0, "Amatsukaze"));
+			size_t scanDataSize = scanw * scanh * 3 / 2;
+			size_t codedSize = codec->EncodeGetOutputSize(UTVF_YV12, scanw, scanh);
+			auto memScanData = std::unique_ptr<uint8_t[]>(new uint8_t[scanDataSize]);
+			auto memCoded = std::unique_ptr<uint8_t[]>(new uint8_t[codedSize]);
+
+			LosslessVideoFile file(pThis->ctx, pThis->workfile, _T("rb"));
+			file.readHeader();
+			auto extra = file.getExtra();
+
+			if (codec->DecodeBegin(UTVF_YV12, scanw, scanh, CBGROSSWIDTH_WINDOWS, extra.data(), (int)extra.size())) {
+				THROW(RuntimeException, "failed to DecodeBegin (UtVideo)");
+			}
+
+			int scanUVw = scanw >> pThis->logUVx;
+			int scanUVh = scanh >> pThis->logUVy;
+			int offU = scanw * scanh;
+			int offV = offU + scanUVw * scanUVh;
+
+			for (int i = start; i < end; ++i) {
+				file.readFrame(i, memCoded.get());
+				if (codec->DecodeFrame(memScanData.get(), memCoded.get()) != scanDataSize) {
+					THROW(RuntimeException, "failed to DecodeFrame (UtVideo)");
+				}
+				// ロゴのあるフレームだけAddFrame
+				if (minFades[i] > minFadeIndex) {
+					const uint8_t* ptr = memScanData.get();
+					logoscan.AddFrame(ptr, ptr + offU, ptr + offV, scanw, scanUVw);
+				}
+			}
+
+			codec->DecodeEnd();
+		}
 	};
 
 	void MakeInitialLogo()
@@ -938,9 +1246,14 @@ class LogoAnalyzer : AMTObject
 		auto memCoded = std::unique_ptr<uint8_t[]>(new uint8_t[codedSize]);
 
 		auto memDeint = std::unique_ptr<float[]>(new float[YSize + 8]);
-		auto memWork = std::unique_ptr<float[]>(new float[YSize + 8]);
+		auto memWork = std::unique_ptr<float[]>(new float[YSize * 2 + 8]);
 
 		const int numFade = 20;
+		float fades[numFade];
+		float results[numFade];
+		for (int fi = 0; fi < numFade; ++fi) {
+			fades[fi] = 0.1f * fi;
+		}
 		auto minFades = std::unique_ptr<int[]>(new int[numFrames]);
 		{
 			LosslessVideoFile file(ctx, workfile, _T("rb"));
@@ -959,13 +1272,12 @@ class LogoAnalyzer : AMTObject
 				}
 				// フレームをインタレ解除
 				DeintY(memDeint.get(), memScanData.get(), scanw, scanw, scanh);
-				// fade値ループ
+				// ロゴを全fade値で評価
+				deintLogo.EvaluateLogoMulti(memDeint.get(), 255.0f, fades, numFade, results, memWork.get());
 				float minResult = FLT_MAX;
 				int minFadeIndex = 0;
 				for (int fi = 0; fi < numFade; ++fi) {
-					float fade = 0.1f * fi;
-					// ロゴを評価
-					float result = std::abs(deintLogo.EvaluateLogo(memDeint.get(), 255.0f, fade, memWork.get()));
+					float result = std::abs(results[fi]);
 					if (result < minResult) {
 						minResult = result;
 						minFadeIndex = fi;
@@ -993,37 +1305,38 @@ class LogoAnalyzer : AMTObject
 		int maxi = (int)(std::max_element(numMinFades.begin(), numMinFades.end()) - numMinFades.begin());
 		printf("maxi = %d (%.1f%%)\n", maxi, numMinFades[maxi] / (float)numFrames * 100.0f);
 
-		LogoScan logoscan(scanw, scanh, logUVx, logUVy, thy);
-		{
-			LosslessVideoFile file(ctx, workfile, _T("rb"));
-			file.readHeader();
-			auto extra = file.getExtra();
+		// ロゴがほぼ完全に出ている（fade 0.8より大きい）フレームだけで作り直す
+		const int minFadeIndex = 8;
 
-			if (codec->DecodeBegin(UTVF_YV12, scanw, scanh, CBGROSSWIDTH_WINDOWS, extra.data(), (int)extra.size())) {
-				THROW(RuntimeException, "failed to DecodeBegin (UtVideo)");
+		// フレーム範囲ごとに並列にスキャンして合算
+		int numThreads = std::max(1, std::min(GetProcessorCount(), numFrames / 1000));
+		std::vector<std::unique_ptr<ReScanThread>> threads;
+		for (int t = 0; t < numThreads; ++t) {
+			int start = (int)((int64_t)numFrames * t / numThreads);
+			int end = (int)((int64_t)numFrames * (t + 1) / numThreads);
+			threads.emplace_back(new ReScanThread(this, minFades.get(), minFadeIndex, start, end));
+		}
+		try {
+			for (auto& thread : threads) {
+				thread->start();
 			}
-
-			int scanUVw = scanw >> logUVx;
-			int scanUVh = scanh >> logUVy;
-			int offU = scanw * scanh;
-			int offV = offU + scanUVw * scanUVh;
-
-			// 全フレームループ
-			for (int i = 0; i < numFrames; ++i) {
-				int64_t codedSize = file.readFrame(i, memCoded.get());
-				if (codec->DecodeFrame(memScanData.get(), memCoded.get()) != scanDataSize) {
-					THROW(RuntimeException, "failed to DecodeFrame (UtVideo)");
-				}
-				// ロゴのあるフレームだけAddFrame
-				if (minFades[i] > 8) { // TODO: 調整
-					const uint8_t* ptr = memScanData.get();
-					logoscan.AddFrame(ptr, ptr + offU, ptr + offV, scanw, scanUVw);
-				}
-
-				if ((i % 2000) == 0) printf("%d frames\n", i);
+		}
+		catch (...) {
+			// 開始したスレッドはjoinしないと破棄できない（開始していないスレッドのjoinは何もしない）
+			for (auto& thread : threads) {
+				thread->join();
 			}
-
-			codec->DecodeEnd();
+			throw;
+		}
+		for (auto& thread : threads) {
+			thread->join();
+		}
+		LogoScan logoscan(scanw, scanh, logUVx, logUVy, thy);
+		for (auto& thread : threads) {
+			if (thread->error) {
+				THROWF(RuntimeException, "%s", thread->errorMessage.c_str());
+			}
+			logoscan.Merge(thread->logoscan);
 		}
 
 		// ロゴ作成
@@ -1122,7 +1435,12 @@ class AMTAnalyzeLogo : public GenericVideoFilter
 		size_t YSize = header.w * header.h;
 		auto memCopy = std::unique_ptr<float[]>(new float[YSize + 8]);
 		auto memDeint = std::unique_ptr<float[]>(new float[YSize + 8]);
-		auto memWork = std::unique_ptr<float[]>(new float[YSize + 8]);
+		auto memWork = std::unique_ptr<float[]>(new float[YSize * 2 + 8]);
+
+		float fades[11];
+		for (int f = 0; f <= 10; ++f) {
+			fades[f] = (float)f / 10.0f;
+		}
 
 		PVideoFrame dst = env->NewVideoFrame(vi);
 		LogoAnalyzeFrame* pDst = reinterpret_cast<LogoAnalyzeFrame*>(dst->GetWritePtr());
@@ -1148,10 +1466,13 @@ class AMTAnalyzeLogo : public GenericVideoFilter
 			DeintY(memDeint.get(), srcY + off, pitchY, header.w, header.h);
 
 			LogoAnalyzeFrame info;
+			deintLogo->EvaluateLogoMulti(memDeint.get(), maxv, fades, 11, info.p, memWork.get());
+			fieldLogoT->EvaluateLogoMulti(memCopy.get(), maxv, fades, 11, info.t, memWork.get(), header.w * 2);
+			fieldLogoB->EvaluateLogoMulti(memCopy.get() + header.w, maxv, fades, 11, info.b, memWork.get(), header.w * 2);
 			for (int f = 0; f <= 10; ++f) {
-				info.p[f] = std::abs(deintLogo->EvaluateLogo(memDeint.get(), maxv, (float)f / 10.0f, memWork.get()));
-				info.t[f] = std::abs(fieldLogoT->EvaluateLogo(memCopy.get(), maxv, (float)f / 10.0f, memWork.get(), header.w * 2));
-				info.b[f] = std::abs(fieldLogoB->EvaluateLogo(memCopy.get() + header.w, maxv, (float)f / 10.0f, memWork.get(), header.w * 2));
+				info.p[f] = std::abs(info.p[f]);
+				info.t[f] = std::abs(info.t[f]);
+				info.b[f] = std::abs(info.b[f]);
 			}
 
 			pDst[i] = info;
@@ -1518,6 +1839,16 @@ public:
 	}
 };
 
+// LogoFrame::scanFramesで読み込んだフレームを受け取る
+// ロゴ解析と同じデコード結果で他の解析も行うために使う
+// onFrameはフレームを読み込んだスレッドから順番に呼ばれる
+class ScanFrameHandler
+{
+public:
+	virtual ~ScanFrameHandler() { }
+	virtual void onFrame(int n, PVideoFrame& frame, IScriptEnvironment2* env) = 0;
+};
+
 class LogoFrame : AMTObject
 {
 	int numLogos;
@@ -1540,6 +1871,29 @@ class LogoFrame : AMTObject
 	int bestLogo;
 	float logoRatio;
 
+	bool isScanTarget(int logoIndex) const
+	{
+		const LogoDataParam& logo = deintArr[logoIndex];
+		return logo.isValid() &&
+			logo.getImgWidth() == vi.width &&
+			logo.getImgHeight() == vi.height;
+	}
+
+	template <typename pixel_t>
+	void ScanLogo(const pixel_t* srcY, int pitchY, int logoIndex,
+		float* memDeint, float* memWork, float maxv, EvalResult* outResult)
+	{
+		LogoDataParam& logo = deintArr[logoIndex];
+
+		// フレームをインタレ解除
+		int off = logo.getImgX() + logo.getImgY() * pitchY;
+		DeintY(memDeint, srcY + off, pitchY, logo.getWidth(), logo.getHeight());
+
+		// ロゴ評価
+		outResult->corr0 = logo.EvaluateLogo(memDeint, maxv, 0, memWork);
+		outResult->corr1 = logo.EvaluateLogo(memDeint, maxv, 1, memWork);
+	}
+
 	template <typename pixel_t>
 	void ScanFrame(PVideoFrame& frame, float* memDeint, float* memWork, float maxv, EvalResult* outResult)
 	{
@@ -1547,41 +1901,221 @@ class LogoFrame : AMTObject
 		int pitchY = frame->GetPitch(PLANAR_Y);
 
 		for (int i = 0; i < numLogos; ++i) {
-			LogoDataParam& logo = deintArr[i];
-			if (logo.isValid() == false ||
-				logo.getImgWidth() != vi.width ||
-				logo.getImgHeight() != vi.height)
-			{
+			if (isScanTarget(i) == false) {
 				outResult[i].corr0 = 0;
 				outResult[i].corr1 = -1;
 				continue;
 			}
+			ScanLogo<pixel_t>(srcY, pitchY, i, memDeint, memWork, maxv, &outResult[i]);
+		}
+	}
 
-			// フレームをインタレ解除
-			int off = logo.getImgX() + logo.getImgY() * pitchY;
-			DeintY(memDeint, srcY + off, pitchY, logo.getWidth(), logo.getHeight());
+	// 並列スキャン用の(フレーム,ロゴ)単位の仕事
+	struct ScanTask {
+		PVideoFrame frame;
+		int n;
+		int logoIndex;
+	};
 
-			// ロゴ評価
-			outResult[i].corr0 = logo.EvaluateLogo(memDeint, maxv, 0, memWork);
-			outResult[i].corr1 = logo.EvaluateLogo(memDeint, maxv, 1, memWork);
+	struct ScanQueue {
+		std::mutex mutex;
+		std::condition_variable cond;
+		std::deque<ScanTask> tasks;
+		bool finished;
+		bool error;
+		std::string errorMessage;
+
+		ScanQueue() : finished(false), error(false) { }
+	};
+
+	// 各スレッドは自分用のmemDeint,memWorkを持ち、結果はevalResultsに直接書き込む
+	// 計算自体はシリアル版と同じなので結果は完全に一致する
+	template <typename pixel_t>
+	class ScanThread : public ThreadBase
+	{
+		LogoFrame* pThis;
+		ScanQueue* queue;
+		float maxv;
+		std::unique_ptr<float[]> memDeint;
+		std::unique_ptr<float[]> memWork;
+	public:
+		ScanThread(LogoFrame* pThis, ScanQueue* queue, float maxv)
+			: pThis(pThis)
+			, queue(queue)
+			, maxv(maxv)
+			, memDeint(new float[pThis->maxYSize + 8])
+			, memWork(new float[pThis->maxYSize + 8])
+		{ }
+
+	protected:
+		virtual void run()
+		{
+			try {
+				scan();
+			}
+			catch (const Exception& e) {
+				setError(e.message());
+			}
+			catch (const AvisynthError& e) {
+				setError(e.msg);
+			}
+			catch (...) {
+				setError("不明なエラー");
+			}
 		}
-	}
+
+		void setError(const std::string& message)
+		{
+			std::unique_lock<std::mutex> lock(queue->mutex);
+			queue->error = true;
+			queue->errorMessage = message;
+			queue->cond.notify_all();
+		}
+
+	private:
+		void scan()
+		{
+			while (true) {
+				ScanTask task;
+				{
+					std::unique_lock<std::mutex> lock(queue->mutex);
+					while (queue->tasks.empty() && !queue->finished && !queue->error) {
+						queue->cond.wait(lock);
+					}
+					if (queue->tasks.empty() || queue->error) {
+						break;
+					}
+					task = std::move(queue->tasks.front());
+					queue->tasks.pop_front();
+					// 空きができたので読み込み側を起こす
+					queue->cond.notify_all();
+				}
+				const pixel_t* srcY = reinterpret_cast<const pixel_t*>(task.frame->GetReadPtr(PLANAR_Y));
+				int pitchY = task.frame->GetPitch(PLANAR_Y);
+				pThis->ScanLogo<pixel_t>(srcY, pitchY, task.logoIndex, memDeint.get(), memWork.get(), maxv,
+					&pThis->evalResults[task.n * pThis->numLogos + task.logoIndex]);
+			}
+		}
+	};
 
 	template <typename pixel_t>
-	void IterateFrames(PClip clip, IScriptEnvironment2* env)
+	void IterateFramesSerial(PClip clip, IScriptEnvironment2* env, float maxv, ScanFrameHandler* handler)
 	{
 		auto memDeint = std::unique_ptr<float[]>(new float[maxYSize + 8]);
 		auto memWork = std::unique_ptr<float[]>(new float[maxYSize + 8]);
-		float maxv = (float)((1 << vi.BitsPerComponent()) - 1);
-		evalResults = std::unique_ptr<EvalResult[]>(new EvalResult[vi.num_frames * numLogos]);
 		for (int n = 0; n < vi.num_frames; ++n) {
 			PVideoFrame frame = clip->GetFrame(n, env);
+			if (handler != nullptr) {
+				handler->onFrame(n, frame, env);
+			}
 			ScanFrame<pixel_t>(frame, memDeint.get(), memWork.get(), maxv, &evalResults[n * numLogos]);
 
 			if ((n % 5000) == 0) {
 				ctx.infoF("%6d/%d", n, vi.num_frames);
 			}
 		}
+	}
+
+	// フレームの取得はこのスレッドで先読みしながら行い（AviSynthはスレッドセーフでないため）
+	// ロゴ評価をスレッドプールに分配する
+	template <typename pixel_t>
+	void IterateFramesParallel(PClip clip, IScriptEnvironment2* env, float maxv, int numThreads, ScanFrameHandler* handler)
+	{
+		ScanQueue queue;
+		std::vector<std::unique_ptr<ScanThread<pixel_t>>> threads;
+
+		// ワーカーを止めてjoinする
+		// 例外で抜ける場合もjoinしないとThreadBaseのデストラクタが例外を投げるので必ず呼ぶ
+		auto stopThreads = [&](bool error) {
+			{
+				std::unique_lock<std::mutex> lock(queue.mutex);
+				queue.finished = true;
+				if (error) {
+					queue.error = true;
+				}
+				queue.cond.notify_all();
+			}
+			for (auto& th : threads) {
+				th->join();
+			}
+		};
+
+		try {
+			for (int i = 0; i < numThreads; ++i) {
+				threads.emplace_back(new ScanThread<pixel_t>(this, &queue, maxv));
+				threads.back()->start();
+			}
+			produceScanTasks<pixel_t>(clip, env, numThreads, handler, queue);
+		}
+		catch (...) {
+			stopThreads(true);
+			throw;
+		}
+
+		stopThreads(false);
+		if (queue.error) {
+			THROWF(RuntimeException, "ロゴスキャンに失敗: %s", queue.errorMessage.c_str());
+		}
+	}
+
+	// フレームを読み込んでスキャンタスクをキューに入れる
+	template <typename pixel_t>
+	void produceScanTasks(PClip clip, IScriptEnvironment2* env, int numThreads, ScanFrameHandler* handler, ScanQueue& queue)
+	{
+		// 先読みするフレーム数
+		const int numAheadFrames = numThreads * 2;
+
+		int numTargets = 0;
+		for (int i = 0; i < numLogos; ++i) {
+			if (isScanTarget(i)) {
+				++numTargets;
+			}
+		}
+		size_t maxTasks = std::max(1, numTargets * numAheadFrames);
+
+		for (int n = 0; n < vi.num_frames; ++n) {
+			PVideoFrame frame = clip->GetFrame(n, env);
+			if (handler != nullptr) {
+				handler->onFrame(n, frame, env);
+			}
+			{
+				std::unique_lock<std::mutex> lock(queue.mutex);
+				while (queue.tasks.size() >= maxTasks && !queue.error) {
+					queue.cond.wait(lock);
+				}
+				if (queue.error) {
+					break;
+				}
+				for (int i = 0; i < numLogos; ++i) {
+					if (isScanTarget(i) == false) {
+						auto& r = evalResults[n * numLogos + i];
+						r.corr0 = 0;
+						r.corr1 = -1;
+						continue;
+					}
+					ScanTask task = { frame, n, i };
+					queue.tasks.push_back(std::move(task));
+				}
+				queue.cond.notify_all();
+			}
+
+			if ((n % 5000) == 0) {
+				ctx.infoF("%6d/%d", n, vi.num_frames);
+			}
+		}
+	}
+
+	template <typename pixel_t>
+	void IterateFrames(PClip clip, IScriptEnvironment2* env, int numThreads, ScanFrameHandler* handler)
+	{
+		float maxv = (float)((1 << vi.BitsPerComponent()) - 1);
+		evalResults = std::unique_ptr<EvalResult[]>(new EvalResult[vi.num_frames * numLogos]);
+		if (numThreads > 1) {
+			IterateFramesParallel<pixel_t>(clip, env, maxv, numThreads, handler);
+		}
+		else {
+			IterateFramesSerial<pixel_t>(clip, env, maxv, handler);
+		}
 		numFrames = vi.num_frames;
 		framesPerSec = (int)std::round((float)vi.fps_numerator / vi.fps_denominator);
 
@@ -1615,15 +2149,20 @@ public:
 		}
 	}
 
-	void scanFrames(PClip clip, IScriptEnvironment2* env)
+	// numThreads: ロゴ評価スレッド数 1以下でシリアル -1でCPU数
+	// handler: 読み込んだフレームを渡す先（なければnullptr）
+	void scanFrames(PClip clip, IScriptEnvironment2* env, int numThreads = -1, ScanFrameHandler* handler = nullptr)
 	{
 		vi = clip->GetVideoInfo();
+		if (numThreads < 0) {
+			numThreads = GetProcessorCount();
+		}
 		int pixelSize = vi.ComponentSize();
 		switch (pixelSize) {
 		case 1:
-			return IterateFrames<uint8_t>(clip, env);
+			return IterateFrames<uint8_t>(clip, env, numThreads, handler);
 		case 2:
-			return IterateFrames<uint16_t>(clip, env);
+			return IterateFrames<uint16_t>(clip, env, numThreads, handler);
 		default:
 			env->ThrowError("[LogoFrame] Unsupported pixel format");
 		}
@@ -1681,23 +2220,20 @@ public:
 		logoRatio = (float)logoSummary[bestLogo].numFrames / numFrames;
 	}
 
-	// logoIndexに指定したロゴのlogoframeファイルを出力
-	// logoIndexの指定がない場合(-1)は、bestLogoを出力
-	void writeResult(const tstring& outpath, int logoIndex = -1)
-	{
-		if (logoIndex < 0) {
-			if (bestLogo < 0) {
-				selectLogo();
-			}
-			logoIndex = bestLogo;
-		}
+	struct FrameResult {
+		int result; // 0:ロゴなし 1:不明 2:ロゴあり
+		float score;
+	};
 
+	// フレームごとの生スコアをフィルタで均して判定する
+	static std::vector<FrameResult> FilterScores(const std::vector<float>& scores, int framesPerSec, float thresh)
+	{
 		const float threshL = 0.5f; // MinMax評価用
-																// MinMax幅
+		// MinMax幅
 		const float avgDur = 1.0f;
 		const float medianDur = 0.5f;
 
-		// スコアに変換
+		int numFrames = (int)scores.size();
 		int halfAvgFrames = int(framesPerSec * avgDur / 2 + 0.5f);
 		int aveFrames = halfAvgFrames * 2 + 1;
 		int halfMedianFrames = int(framesPerSec * medianDur / 2 + 0.5f);
@@ -1706,49 +2242,68 @@ public:
 		int halfWinFrames = winFrames / 2;
 		std::vector<float> rawScores_(numFrames + winFrames);
 		auto rawScores = rawScores_.begin() + halfWinFrames;
-		for (int n = 0; n < numFrames; ++n) {
-			auto& r = evalResults[n * numLogos + logoIndex];
-			// corr0のマイナスとcorr1のプラスはノイズなので消す
-			rawScores[n] = std::max(0.0f, r.corr0) + std::min(0.0f, r.corr1);
-		}
+		std::copy(scores.begin(), scores.end(), rawScores);
 		// 両端を端の値で埋める
 		std::fill(rawScores_.begin(), rawScores, rawScores[0]);
 		std::fill(rawScores + numFrames, rawScores_.end(), rawScores[numFrames - 1]);
 
-		struct FrameResult {
-			int result;
-			float score;
-		};
-
 		// フィルタで均す
+		// 各フィルタはスライディングウィンドウで計算するのでフレーム数に対して線形
 		std::vector<FrameResult> frameResult(numFrames);
-		std::vector<float> medianBuf(medianFrames);
+		SlidingWindowMax<float> beforeMaxWin; // [i-halfAvgFrames,i)
+		SlidingWindowMax<float> afterMaxWin;  // (i,i+halfAvgFrames]
+		SlidingWindowSum<float> avgWin;       // [i-halfAvgFrames,i+halfAvgFrames]
+		SlidingWindowMedian<float> medianWin; // [i-halfMedianFrames,i+halfMedianFrames]
+		for (int k = -halfAvgFrames; k < 0; ++k) {
+			beforeMaxWin.push(rawScores[k]);
+		}
+		for (int k = 1; k <= halfAvgFrames; ++k) {
+			afterMaxWin.push(rawScores[k]);
+		}
+		for (int k = -halfAvgFrames; k <= halfAvgFrames; ++k) {
+			avgWin.push(rawScores[k]);
+		}
+		for (int k = -halfMedianFrames; k <= halfMedianFrames; ++k) {
+			medianWin.push(rawScores[k]);
+		}
 		for (int i = 0; i < numFrames; ++i) {
 			// MinMax
 			// 前の最大値と後ろの最大値の小さい方を取る
 			// 動きの多い映像でロゴがかき消されることがあるので、それを救済する
-			float beforeMax = *std::max_element(rawScores + i - halfAvgFrames, rawScores + i);
-			float afterMax = *std::max_element(rawScores + i + 1, rawScores + i + 1 + halfAvgFrames);
+			float beforeMax = beforeMaxWin.get();
+			float afterMax = afterMaxWin.get();
 			float minMax = std::min(beforeMax, afterMax);
 			int minMaxResult = (std::abs(minMax) < threshL) ? 1 : (minMax < 0.0f) ? 0 : 2;
 
 			// 移動平均
 			// MinMaxだけだと薄くても安定して表示されてるとかが識別できないので
 			// これも必要
-			float avg = std::accumulate(rawScores + i - halfAvgFrames,
-				rawScores + i + halfAvgFrames + 1, 0.0f) / aveFrames;
-			int avgResult = (std::abs(avg) < THRESH) ? 1 : (avg < 0.0f) ? 0 : 2;
+			float avg = (float)avgWin.get() / aveFrames;
+			int avgResult = (std::abs(avg) < thresh) ? 1 : (avg < 0.0f) ? 0 : 2;
 
 			// 両者が違ってたら不明とする
 			frameResult[i].result = (minMaxResult != avgResult) ? 1 : minMaxResult;
 
 			// 生の値は動きが激しいので少しメディアンフィルタをかけておく
-			std::copy(rawScores + i - halfMedianFrames,
-				rawScores + i + halfMedianFrames + 1, medianBuf.begin());
-			std::sort(medianBuf.begin(), medianBuf.end());
-			frameResult[i].score = medianBuf[halfMedianFrames];
+			frameResult[i].score = medianWin.get();
+
+			// ウィンドウを1フレーム進める
+			beforeMaxWin.push(rawScores[i]);
+			beforeMaxWin.pop();
+			afterMaxWin.push(rawScores[i + 1 + halfAvgFrames]);
+			afterMaxWin.pop();
+			avgWin.push(rawScores[i + 1 + halfAvgFrames]);
+			avgWin.pop();
+			medianWin.push(rawScores[i + 1 + halfMedianFrames]);
+			medianWin.pop();
 		}
 
+		return frameResult;
+	}
+
+	// 判定を整えてロゴ区間を出力する
+	static void WriteSections(std::vector<FrameResult>& frameResult, float thresh, StringBuilder& sb)
+	{
 		// 不明部分を推測
 		// 両側がロゴありとなっていたらロゴありとする
 		for (auto it = frameResult.begin(); it != frameResult.end();) {
@@ -1765,7 +2320,6 @@ public:
 		}
 
 		// ロゴ区間を出力
-		StringBuilder sb;
 		for (auto it = frameResult.begin(); it != frameResult.end();) {
 			auto sEnd_ = std::find_if(it, frameResult.end(), [](FrameResult r) { return r.result == 2; });
 			auto eEnd_ = std::find_if(sEnd_, frameResult.end(), [](FrameResult r) { return r.result == 0; });
@@ -1774,34 +2328,34 @@ public:
 			auto sEnd = sEnd_;
 			auto eEnd = eEnd_;
 			if (sEnd != frameResult.end()) {
-				if (sEnd->score >= THRESH) {
+				if (sEnd->score >= thresh) {
 					// すでに始まっているので戻ってみる
 					sEnd = std::find_if(std::make_reverse_iterator(sEnd), frameResult.rend(),
-						[=](FrameResult r) { return r.score < THRESH; }).base();
+						[=](FrameResult r) { return r.score < thresh; }).base();
 				}
 				else {
 					// まだ始まっていないので進んでみる
 					sEnd = std::find_if(sEnd, frameResult.end(),
-						[=](FrameResult r) { return r.score >= THRESH; });
+						[=](FrameResult r) { return r.score >= thresh; });
 				}
 			}
 			if (eEnd != frameResult.end()) {
-				if (eEnd->score <= -THRESH) {
+				if (eEnd->score <= -thresh) {
 					// すでに終わっているので戻ってみる
 					eEnd = std::find_if(std::make_reverse_iterator(eEnd), std::make_reverse_iterator(sEnd),
-						[=](FrameResult r) { return r.score > -THRESH; }).base();
+						[=](FrameResult r) { return r.score > -thresh; }).base();
 				}
 				else {
 					// まだ終わっていないので進んでみる
 					eEnd = std::find_if(eEnd, frameResult.end(),
-						[=](FrameResult r) { return r.score <= -THRESH; });
+						[=](FrameResult r) { return r.score <= -thresh; });
 				}
 			}
 
 			auto sStart = std::find_if(std::make_reverse_iterator(sEnd),
-				std::make_reverse_iterator(it), [=](FrameResult r) { return r.score <= -THRESH; }).base();
+				std::make_reverse_iterator(it), [=](FrameResult r) { return r.score <= -thresh; }).base();
 			auto eStart = std::find_if(std::make_reverse_iterator(eEnd),
-				std::make_reverse_iterator(sEnd), [=](FrameResult r) { return r.score >= THRESH; }).base();
+				std::make_reverse_iterator(sEnd), [=](FrameResult r) { return r.score >= thresh; }).base();
 
 			auto sBest = std::find_if(sStart, sEnd, [](FrameResult r) { return r.score > 0; });
 			auto eBest = std::find_if(std::make_reverse_iterator(eEnd),
@@ -1821,6 +2375,31 @@ public:
 
 			it = eEnd_;
 		}
+	}
+
+	// logoIndexに指定したロゴのlogoframeファイルを出力
+	// logoIndexの指定がない場合(-1)は、bestLogoを出力
+	void writeResult(const tstring& outpath, int logoIndex = -1)
+	{
+		if (logoIndex < 0) {
+			if (bestLogo < 0) {
+				selectLogo();
+			}
+			logoIndex = bestLogo;
+		}
+
+		// スコアに変換
+		std::vector<float> scores(numFrames);
+		for (int n = 0; n < numFrames; ++n) {
+			auto& r = evalResults[n * numLogos + logoIndex];
+			// corr0のマイナスとcorr1のプラスはノイズなので消す
+			scores[n] = std::max(0.0f, r.corr0) + std::min(0.0f, r.corr1);
+		}
+
+		auto frameResult = FilterScores(scores, framesPerSec, THRESH);
+
+		StringBuilder sb;
+		WriteSections(frameResult, THRESH, sb);
 
 		File file(outpath, _T("w"));
 		file.write(sb.getMC());
@@ -304,6 +304,46 @@ public:
 		}
 	}
 
+	/** @brief TSf[^Rs[ɓ
+	* ĂԂdata璼ڃpPbg؂oďo͂B
+	* obt@ĝ̓pPbgE܂[ƓOꂽƂB
+	* o͂TsPacketdatawĂ̂ŁAĂяodataLł邱ƁB
+	*/
+	void inputTSDirect(MemoryChunk data) {
+		uint8_t* ptr = data.data;
+		uint8_t* end = data.data + data.length;
+
+		// ăobt@pPbgEɑ܂ł̓obt@oRŏ
+		while (ptr < end && !(syncOK && buffer.size() % TS_PACKET_LENGTH == 0)) {
+			size_t n = syncOK
+				? TS_PACKET_LENGTH - buffer.size() % TS_PACKET_LENGTH
+				: CHECK_PACKET_NUM * TS_PACKET_LENGTH;
+			n = std::min<size_t>(n, end - ptr);
+			inputTS(MemoryChunk(ptr, n));
+			ptr += n;
+		}
+		if (ptr == end) {
+			return;
+		}
+
+		// obt@ɎcĂpPbgo
+		if (buffer.size() > 0 && !outBufferedPackets(*ptr)) {
+			// ̂Œʏ폈ɔC
+			inputTS(MemoryChunk(ptr, end - ptr));
+			return;
+		}
+
+		while (end - ptr >= 2 * TS_PACKET_LENGTH && checkSyncByte(ptr, 2)) {
+			checkAndOutPacket(MemoryChunk(ptr, TS_PACKET_LENGTH));
+			ptr += TS_PACKET_LENGTH;
+		}
+
+		// ci[܂͓j͒ʏ폈
+		if (ptr < end) {
+			inputTS(MemoryChunk(ptr, end - ptr));
+		}
+	}
+
 	/** @brief obt@tbV */
 	void flush() {
 		while (buffer.size() >= TS_PACKET_LENGTH) {
@@ -354,6 +394,19 @@ private:
 		}
 	}
 
+	// obt@̃pPbgƎ̃pPbg̓oCgĂΑSďo
+	bool outBufferedPackets(uint8_t nextSyncByte) {
+		int numPackets = (int)(buffer.size() / TS_PACKET_LENGTH);
+		if (nextSyncByte != TS_SYNC_BYTE || !checkSyncByte(buffer.ptr(), numPackets)) {
+			return false;
+		}
+		while (buffer.size() >= TS_PACKET_LENGTH) {
+			checkAndOutPacket(MemoryChunk(buffer.ptr(), TS_PACKET_LENGTH));
+			buffer.trimHead(TS_PACKET_LENGTH);
+		}
+		return true;
+	}
+
 	// pPbg`FbNďo
 	void checkAndOutPacket(MemoryChunk data) {
 		TsPacket packet(data.data);
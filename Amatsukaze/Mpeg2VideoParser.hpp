@@ -331,7 +331,14 @@ public:
 		FRAME_TYPE type = FRAME_NO_INFO;
 		int codedDataSize = (int)frame.length;
 
-		for (int b = 0; b <= (int)frame.length - 4; ++b) {
+		int length = (int)frame.length;
+		for (int b = 0; b <= length - 4; ++b) {
+			// start code܂Ŕ΂i4oCgڂ܂œǂ߂͈͂ŒTj
+			int next = FindStartCodeCandidate(&frame.data[b], length - b - 1);
+			if (next < 0) {
+				break;
+			}
+			b += next;
 			switch (read32(&frame.data[b])) {
 			case SEQ_HEADER_START_CODE:
 				if (sequenceHeader.parse(&frame.data[b], (int)frame.length - b)) {
@@ -23,6 +23,7 @@ struct EncodeFileOutput {
 	double targetBitrate;
 	int vfrTimingFps;
 	tstring timecode;
+	double audioEncodeTime; // GR[hɂԁibj
 };
 
 class AMTMuxder : public AMTObject {
@@ -0,0 +1,285 @@
+/**
+* Sub process for POSIX
+* Copyright (c) 2017-2019 Nekopanda
+*
+* This software is released under the MIT License.
+* http://opensource.org/licenses/mit-license.php
+*/
+#pragma once
+
+// ProcessThread.hppSubProcessƓC^[tF[XPOSIX
+// ProcessThread.hppWindowspȂ̂ŁAPOSIXł͂̃wb_𒼐ڎg
+#ifdef _MSC_VER
+#error "Windows uses SubProcess in ProcessThread.hpp"
+#endif
+
+#include <spawn.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#ifdef AMT_USE_VMSPLICE
+#include <sys/ioctl.h>
+#endif
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "CoreUtils.hpp"
+
+extern char **environ;
+
+// posix_spawnŋNstdin/stdout/stderrpCvłȂ
+// stdiñpCv̓mubLOɂāAtɂȂpollő҂
+// writev()͕̃̈Rs[ɂ̂܂܃pCvɏ
+// AMT_USE_VMSPLICE`LinuxłvmspliceŃy[WpCvɒړn
+// iy[W͎QƂœn̂ŁA݌͎qvZXǂݏI܂ő҂j
+class SubProcess
+{
+public:
+	SubProcess(const tstring& args)
+		: pid_(-1)
+		, exitCode_(0)
+	{
+		// qvZXɏIƂɏ݂ŃVOi󂯂ėȂ悤ɂ
+		signal(SIGPIPE, SIG_IGN);
+
+		auto argv = splitCommandLine(args);
+		if (argv.size() == 0) {
+			THROW(ArgumentException, "R}hł");
+		}
+		std::vector<char*> argvp;
+		for (auto& arg : argv) {
+			argvp.push_back(&arg[0]);
+		}
+		argvp.push_back(nullptr);
+
+		// pCvFD_CLOEXECōĂ̂ŁAdup2̈ȊO͎qvZXɎcȂ
+		posix_spawn_file_actions_t actions;
+		posix_spawn_file_actions_init(&actions);
+		posix_spawn_file_actions_adddup2(&actions, stdInPipe_.readFd, STDIN_FILENO);
+		posix_spawn_file_actions_adddup2(&actions, stdOutPipe_.writeFd, STDOUT_FILENO);
+		posix_spawn_file_actions_adddup2(&actions, stdErrPipe_.writeFd, STDERR_FILENO);
+		int ret = posix_spawnp(&pid_, argvp[0], &actions, NULL, argvp.data(), environ);
+		posix_spawn_file_actions_destroy(&actions);
+		if (ret != 0) {
+			pid_ = -1;
+			THROW(RuntimeException, "vZXNɎsBexẽpXmFĂB");
+		}
+
+		// qvZXp̃nh͕KvȂ̂ŕ
+		stdErrPipe_.closeWrite();
+		stdOutPipe_.closeWrite();
+		stdInPipe_.closeRead();
+
+		int flags = fcntl(stdInPipe_.writeFd, F_GETFL);
+		fcntl(stdInPipe_.writeFd, F_SETFL, flags | O_NONBLOCK);
+#ifdef F_SETPIPE_SZ
+		// ftHg64KBƃt[Ƃɉx҂ƂɂȂ̂ő傫
+		// i/proc/sys/fs/pipe-max-sizej𒴂Ă玸s邪Â܂܂ł̂Ŗ
+		fcntl(stdInPipe_.writeFd, F_SETPIPE_SZ, PIPE_BUFFER_SIZE);
+#endif
+	}
+	~SubProcess() {
+		join();
+	}
+	void write(MemoryChunk mc) {
+		writev(&mc, 1);
+	}
+	// ̃̈܂Ƃ߂ď
+	void writev(const MemoryChunk* chunks, int count) {
+		iov_.clear();
+		for (int i = 0; i < count; ++i) {
+			if (chunks[i].length > 0) {
+				struct iovec v = { chunks[i].data, chunks[i].length };
+				iov_.push_back(v);
+			}
+		}
+		int fd = stdInPipe_.writeFd;
+		size_t idx = 0;
+		while (idx < iov_.size()) {
+			int n = (int)std::min<size_t>(iov_.size() - idx, IOV_MAX);
+#ifdef AMT_USE_VMSPLICE
+			ssize_t written = vmsplice(fd, &iov_[idx], n, SPLICE_F_NONBLOCK);
+#else
+			ssize_t written = ::writev(fd, &iov_[idx], n);
+#endif
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					waitWritable(fd);
+					continue;
+				}
+				THROW(RuntimeException, "failed to write to stdin pipe");
+			}
+			// ߂Ƃ܂Ői߂
+			while (written > 0) {
+				if ((size_t)written >= iov_[idx].iov_len) {
+					written -= iov_[idx].iov_len;
+					++idx;
+				}
+				else {
+					iov_[idx].iov_base = (uint8_t*)iov_[idx].iov_base + written;
+					iov_[idx].iov_len -= written;
+					written = 0;
+				}
+			}
+		}
+#ifdef AMT_USE_VMSPLICE
+		waitDrained(fd);
+#endif
+	}
+	size_t readErr(MemoryChunk mc) {
+		return readGeneric(mc, stdErrPipe_.readFd);
+	}
+	size_t readOut(MemoryChunk mc) {
+		return readGeneric(mc, stdOutPipe_.readFd);
+	}
+	void finishWrite() {
+		stdInPipe_.closeWrite();
+	}
+	int join() {
+		if (pid_ > 0) {
+			// qvZX̏I҂
+			int status = 0;
+			while (waitpid(pid_, &status, 0) < 0) {
+				if (errno != EINTR) {
+					status = 0;
+					break;
+				}
+			}
+			// IR[h擾iVOiŏIꍇ̓VFƓ128+VOiԍj
+			if (WIFEXITED(status)) {
+				exitCode_ = WEXITSTATUS(status);
+			}
+			else if (WIFSIGNALED(status)) {
+				exitCode_ = 128 + WTERMSIG(status);
+			}
+			pid_ = -1;
+		}
+		return exitCode_;
+	}
+private:
+	enum { PIPE_BUFFER_SIZE = 1024 * 1024 };
+
+	class Pipe {
+	public:
+		Pipe() {
+			int fds[2];
+			if (pipe(fds) != 0) {
+				THROW(RuntimeException, "failed to create pipe");
+			}
+			readFd = fds[0];
+			writeFd = fds[1];
+			fcntl(readFd, F_SETFD, FD_CLOEXEC);
+			fcntl(writeFd, F_SETFD, FD_CLOEXEC);
+		}
+		~Pipe() {
+			closeRead();
+			closeWrite();
+		}
+		void closeRead() {
+			if (readFd != -1) {
+				close(readFd);
+				readFd = -1;
+			}
+		}
+		void closeWrite() {
+			if (writeFd != -1) {
+				close(writeFd);
+				writeFd = -1;
+			}
+		}
+		int readFd;
+		int writeFd;
+	};
+
+	pid_t pid_;
+	Pipe stdErrPipe_;
+	Pipe stdOutPipe_;
+	Pipe stdInPipe_;
+	int exitCode_;
+	std::vector<struct iovec> iov_;
+
+	// Windows̃R}hCKi󔒋؂A"ň͂ށA\"̓GXP[vjňɕ
+	static std::vector<std::string> splitCommandLine(const std::string& args)
+	{
+		std::vector<std::string> argv;
+		std::string cur;
+		bool inQuote = false;
+		bool hasArg = false;
+		for (size_t i = 0; i < args.size(); ++i) {
+			char c = args[i];
+			if (c == '\\' && i + 1 < args.size() && args[i + 1] == '"') {
+				cur.push_back('"');
+				hasArg = true;
+				++i;
+			}
+			else if (c == '"') {
+				inQuote = !inQuote;
+				hasArg = true;
+			}
+			else if (!inQuote && (c == ' ' || c == '\t')) {
+				if (hasArg) {
+					argv.push_back(cur);
+					cur.clear();
+					hasArg = false;
+				}
+			}
+			else {
+				cur.push_back(c);
+				hasArg = true;
+			}
+		}
+		if (hasArg) {
+			argv.push_back(cur);
+		}
+		return argv;
+	}
+
+	static void waitWritable(int fd)
+	{
+		struct pollfd pfd = { fd, POLLOUT, 0 };
+		while (poll(&pfd, 1, -1) < 0) {
+			if (errno != EINTR) {
+				THROW(RuntimeException, "failed to poll stdin pipe");
+			}
+		}
+	}
+
+#ifdef AMT_USE_VMSPLICE
+	// pCvɂȂƂm点Cxg͂Ȃ̂ŁA1ms҂ĎcmF
+	// qvZXIēǂݎ肪ȂȂPOLLERRɂȂ̂ŁÂƂ̓G[
+	static void waitDrained(int fd)
+	{
+		struct pollfd pfd = { fd, 0, 0 };
+		int remain = 0;
+		while (ioctl(fd, FIONREAD, &remain) == 0 && remain > 0) {
+			if (poll(&pfd, 1, 1) > 0 && (pfd.revents & POLLERR)) {
+				THROW(RuntimeException, "failed to write to stdin pipe");
+			}
+		}
+	}
+#endif
+
+	size_t readGeneric(MemoryChunk mc, int fd)
+	{
+		while (true) {
+			ssize_t bytesRead = read(fd, mc.data, mc.length);
+			if (bytesRead >= 0) {
+				// 0ȂEOF
+				return (size_t)bytesRead;
+			}
+			if (errno != EINTR) {
+				THROW(RuntimeException, "failed to read from pipe");
+			}
+		}
+	}
+};
@@ -11,9 +11,13 @@
 #include <process.h>
 
 #include <deque>
+#include <vector>
+#include <atomic>
 #include <string>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
+#include <memory>
 
 #include "StreamUtils.hpp"
 #include "PerformanceUtil.hpp"
@@ -69,16 +73,41 @@ private:
 	}
 };
 
+// ringSlots > 0 ɂmutexŎdequȇɃbNt[SPSCOobt@g
+// ̏ꍇput()ĂԃXbh1ɂ邱ƁiXbhȂdequegj
+// Oobt@ł͑҂Ƃɂ΂炭XsĂϐŐQ
+// ǂamount̍vmaximum𒴂put()͑҂iOobt@̓Xbg܂Ă҂j
 template <typename T, bool PERF = false>
 class DataPumpThread : private ThreadBase
 {
 public:
-	DataPumpThread(size_t maximum)
+	DataPumpThread(size_t maximum, size_t ringSlots = 0)
 		: maximum_(maximum)
 		, current_(0)
 		, finished_(false)
 		, error_(false)
-	{ }
+		, ringMask_(0)
+		, ringCurrent_(0)
+		, producerParked_(false)
+		, consumerParked_(false)
+		, ringSpinCount_(0)
+	{
+		ringHead_.value = 0;
+		ringTail_.value = 0;
+		if (ringSlots > 0) {
+			size_t numSlots = 1;
+			while (numSlots < ringSlots) numSlots <<= 1;
+			ring_.resize(numSlots);
+			ringMask_ = numSlots - 1;
+			// 1RAgȂƂ̓XsĂ肪i܂Ȃ̂łɐQ
+			int numCores = 0;
+			DWORD_PTR processMask, systemMask;
+			if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+				for (; processMask; processMask &= processMask - 1) ++numCores;
+			}
+			ringSpinCount_ = (numCores > 1) ? RING_SPIN_COUNT : 0;
+		}
+	}
 
 	~DataPumpThread() {
 		if (isRunning()) {
@@ -88,6 +117,10 @@ public:
 
 	void put(T&& data, size_t amount)
 	{
+		if (ring_.size() > 0) {
+			putRing(std::move(data), amount);
+			return;
+		}
 		std::unique_lock<std::mutex> lock(critical_section_);
 		if (error_) {
 			THROW(RuntimeException, "DataPumpThread error");
@@ -115,7 +148,11 @@ public:
 	}
 
 	void join() {
-		{
+		if (ring_.size() > 0) {
+			finished_ = true;
+			wakeRing(consumerParked_, cond_empty_);
+		}
+		else {
 			std::unique_lock<std::mutex> lock(critical_section_);
 			finished_ = true;
 			cond_empty_.notify_one();
@@ -134,6 +171,14 @@ protected:
 	virtual void OnDataReceived(T&& data) = 0;
 
 private:
+	enum { RING_SPIN_COUNT = 4000 };
+
+	// headtailLbVCɏȂ悤ɂ
+	struct PaddedIndex {
+		std::atomic<size_t> value;
+		char padding[64 - sizeof(std::atomic<size_t>)];
+	};
+
 	std::mutex critical_section_;
 	std::condition_variable cond_full_;
 	std::condition_variable cond_empty_;
@@ -143,14 +188,113 @@ private:
 	size_t maximum_;
 	size_t current_;
 
-	bool finished_;
-	bool error_;
+	std::atomic<bool> finished_;
+	std::atomic<bool> error_;
+
+	// Oobt@i҂headAY҂taili߂j
+	std::vector<std::pair<size_t, T>> ring_;
+	size_t ringMask_;
+	PaddedIndex ringHead_;
+	PaddedIndex ringTail_;
+	std::atomic<size_t> ringCurrent_;
+	// ϐŐQĂ邩iN͂ꂪtruêƂbNj
+	std::atomic<bool> producerParked_;
+	std::atomic<bool> consumerParked_;
+	int ringSpinCount_;
 
 	Stopwatch producer;
 	Stopwatch consumer;
 
+	bool canPutRing(size_t tail) const {
+		return tail - ringHead_.value < ring_.size() && ringCurrent_ < maximum_;
+	}
+
+	bool canGetRing(size_t head) const {
+		return ringTail_.value != head;
+	}
+
+	template <typename Pred>
+	void waitRing(std::atomic<bool>& parked, std::condition_variable& cond, Pred pred) {
+		for (int i = 0; i < ringSpinCount_; ++i) {
+			if (pred()) return;
+			YieldProcessor();
+		}
+		std::unique_lock<std::mutex> lock(critical_section_);
+		// parked𗧂ĂĂmF̂ŋNƍsႢɂȂȂ
+		while (true) {
+			parked = true;
+			if (pred()) break;
+			cond.wait(lock);
+		}
+		parked = false;
+	}
+
+	// N̂͐QĂŏ1񂾂
+	void wakeRing(std::atomic<bool>& parked, std::condition_variable& cond) {
+		if (parked && parked.exchange(false)) {
+			std::lock_guard<std::mutex> lock(critical_section_);
+			cond.notify_one();
+		}
+	}
+
+	void putRing(T&& data, size_t amount)
+	{
+		if (error_) {
+			THROW(RuntimeException, "DataPumpThread error");
+		}
+		if (finished_) {
+			THROW(InvalidOperationException, "DataPumpThread is already finished");
+		}
+		size_t tail = ringTail_.value.load(std::memory_order_relaxed);
+		if (!canPutRing(tail)) {
+			if (PERF) producer.start();
+			waitRing(producerParked_, cond_full_, [&]() { return canPutRing(tail); });
+			if (PERF) producer.stop();
+		}
+		auto& slot = ring_[tail & ringMask_];
+		slot.first = amount;
+		slot.second = std::move(data);
+		ringCurrent_ += amount;
+		ringTail_.value = tail + 1;
+		wakeRing(consumerParked_, cond_empty_);
+	}
+
+	void runRing()
+	{
+		while (true) {
+			size_t head = ringHead_.value.load(std::memory_order_relaxed);
+			if (!canGetRing(head)) {
+				if (PERF) consumer.start();
+				waitRing(consumerParked_, cond_empty_, [&]() {
+					return canGetRing(head) || finished_ || error_;
+				});
+				if (PERF) consumer.stop();
+				// finished_ȂIifinished_̑Oɓꂽf[^͌Ăj
+				if (!canGetRing(head)) return;
+			}
+			auto& slot = ring_[head & ringMask_];
+			size_t amount = slot.first;
+			T data = std::move(slot.second);
+			ringCurrent_ -= amount;
+			ringHead_.value = head + 1;
+			wakeRing(producerParked_, cond_full_);
+			if (error_ == false) {
+				try {
+					OnDataReceived(std::move(data));
+				}
+				catch (Exception&) {
+					error_ = true;
+				}
+			}
+		}
+	}
+
 	virtual void run()
 	{
+		if (ring_.size() > 0) {
+			runRing();
+			return;
+		}
 		while (true) {
 			T data;
 			{
@@ -183,6 +327,337 @@ private:
 	}
 };
 
+// obNOEhXbhŃt@Cɏ
+// write()̓obt@ɗ߂邾ŁAobt@tɂȂ珑݃Xbhɓn
+// unbufferedɂOS̃LbVʂɏށiFILE_FLAG_NO_BUFFERINGj
+// Ō͕Kclose()ĂԂƁi݃G[close()łj
+// ftHg̓_uobt@i߂Ăobt@Əݑ҂̃obt@j
+class AsyncFileWriter : NonCopyable
+{
+public:
+	AsyncFileWriter(const tstring& path, bool unbuffered = false,
+		size_t bufferSize = 4 * 1024 * 1024, int numBuffers = 2)
+		: path_(path)
+		, unbuffered_(unbuffered)
+		, bufferSize_((bufferSize + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1))
+		, hFile_(INVALID_HANDLE_VALUE)
+		, thread_(this, bufferSize_ * std::max(1, numBuffers - 1))
+		, totalBytes_(0)
+		, error_(false)
+	{
+		DWORD flags = FILE_FLAG_SEQUENTIAL_SCAN;
+		if (unbuffered) {
+			flags |= FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH;
+		}
+		hFile_ = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+			NULL, CREATE_ALWAYS, flags, NULL);
+		if (hFile_ == INVALID_HANDLE_VALUE) {
+			THROWF(IOException, "t@CJ܂: %s", GetFullPath(path));
+		}
+		try {
+			thread_.start();
+		}
+		catch (const Exception&) {
+			CloseHandle(hFile_);
+			throw;
+		}
+	}
+
+	~AsyncFileWriter() {
+		if (hFile_ != INVALID_HANDLE_VALUE) {
+			// close()ꂸɔjꍇiOȂǁj̓f[^̂ĂďI
+			// error_𗧂ĂĂΏ݃Xbh͎c̃obt@Ɏ̂Ă
+			error_ = true;
+			thread_.join();
+			CloseHandle(hFile_);
+		}
+	}
+
+	void write(MemoryChunk mc) {
+		while (mc.length > 0) {
+			if (current_ == nullptr) {
+				checkError();
+				current_ = getBuffer();
+			}
+			size_t sz = std::min(mc.length, bufferSize_ - current_->length);
+			memcpy(current_->data + current_->length, mc.data, sz);
+			current_->length += sz;
+			mc.data += sz;
+			mc.length -= sz;
+			totalBytes_ += sz;
+			if (current_->length == bufferSize_) {
+				thread_.put(std::move(current_), bufferSize_);
+			}
+		}
+	}
+
+	void close() {
+		if (hFile_ == INVALID_HANDLE_VALUE) return;
+		if (current_ != nullptr && current_->length > 0) {
+			size_t length = current_->length;
+			if (unbuffered_) {
+				// ZN^Eɍ킹ď݁Aŗ]؂l߂
+				size_t aligned = (length + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+				memset(current_->data + length, 0, aligned - length);
+				current_->length = aligned;
+			}
+			thread_.put(std::move(current_), length);
+		}
+		current_ = nullptr;
+		thread_.join();
+		if (!error_ && unbuffered_) {
+			FILE_END_OF_FILE_INFO info;
+			info.EndOfFile.QuadPart = totalBytes_;
+			if (SetFileInformationByHandle(hFile_, FileEndOfFileInfo, &info, sizeof(info)) == 0) {
+				setError("t@CTCYݒł܂");
+			}
+		}
+		CloseHandle(hFile_);
+		hFile_ = INVALID_HANDLE_VALUE;
+		checkError();
+	}
+
+	int64_t getTotalBytes() const {
+		return totalBytes_;
+	}
+
+	// obt@tŏ݂҂Ăԁibj
+	double getBlockedTime() {
+		double prod, cons;
+		thread_.getTotalWait(prod, cons);
+		return prod;
+	}
+
+private:
+	enum { ALIGNMENT = 4096 };
+
+	struct WriteBuffer {
+		uint8_t* data;
+		size_t length;
+		WriteBuffer(size_t size)
+			: data((uint8_t*)_aligned_malloc(size, ALIGNMENT))
+			, length(0)
+		{
+			if (data == nullptr) {
+				THROW(RuntimeException, "failed to allocate write buffer");
+			}
+		}
+		~WriteBuffer() {
+			_aligned_free(data);
+		}
+	};
+
+	class WriteThread : public DataPumpThread<std::unique_ptr<WriteBuffer>, true>
+	{
+	public:
+		WriteThread(AsyncFileWriter* this_, size_t maximum)
+			: DataPumpThread(maximum)
+			, this_(this_)
+		{ }
+	protected:
+		virtual void OnDataReceived(std::unique_ptr<WriteBuffer>&& data) {
+			this_->writeBuffer(std::move(data));
+		}
+	private:
+		AsyncFileWriter* this_;
+	};
+
+	const tstring path_; // G[bZ[W\p
+	const bool unbuffered_;
+	const size_t bufferSize_;
+	HANDLE hFile_;
+	WriteThread thread_;
+
+	std::unique_ptr<WriteBuffer> current_;
+	int64_t totalBytes_;
+
+	// ݂Iobt@i݃Xbh߂j
+	std::mutex mutex_;
+	std::vector<std::unique_ptr<WriteBuffer>> freeBuffers_;
+	// ݃Xbhǂނ̂atomicibZ[Wmutex_ŕیj
+	std::atomic<bool> error_;
+	std::string errorMessage_;
+
+	std::unique_ptr<WriteBuffer> getBuffer() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (freeBuffers_.size() > 0) {
+				auto buf = std::move(freeBuffers_.back());
+				freeBuffers_.pop_back();
+				buf->length = 0;
+				return buf;
+			}
+		}
+		return std::unique_ptr<WriteBuffer>(new WriteBuffer(bufferSize_));
+	}
+
+	void writeBuffer(std::unique_ptr<WriteBuffer>&& buf) {
+		if (!error_) {
+			DWORD written;
+			if (WriteFile(hFile_, buf->data, (DWORD)buf->length, &written, NULL) == 0 ||
+				written != buf->length)
+			{
+				setError("failed to write to file");
+			}
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		freeBuffers_.push_back(std::move(buf));
+	}
+
+	void setError(const char* message) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!error_) {
+			errorMessage_ = StringFormat("%s: %s", message, GetFullPath(path_));
+			error_ = true;
+		}
+	}
+
+	void checkError() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (error_) {
+			THROWF(IOException, "%s", errorMessage_.c_str());
+		}
+	}
+};
+
+// ̃^XNɎsXbhv[
+// runAll()͌ĂяoXbh܂߂ă^XNASĊ܂Ŗ߂Ȃ
+class ParallelTaskPool : NonCopyable
+{
+public:
+	// numThreads͌ĂяoXbh܂ސ
+	ParallelTaskPool(int numThreads)
+		: tasks(nullptr)
+		, nextTask(0)
+		, numRemaining(0)
+		, finished(false)
+		, error(false)
+	{
+		for (int i = 1; i < numThreads; ++i) {
+			workers.emplace_back(new Worker(this));
+			workers.back()->start();
+		}
+	}
+
+	~ParallelTaskPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finished = true;
+			condTask.notify_all();
+		}
+		for (auto& worker : workers) {
+			worker->join();
+		}
+	}
+
+	int getNumThreads() const {
+		return (int)workers.size() + 1;
+	}
+
+	void runAll(std::vector<std::function<void()>>& tasks_) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks = &tasks_;
+			nextTask = 0;
+			numRemaining = (int)tasks_.size();
+			error = false;
+			condTask.notify_all();
+		}
+		processTasks();
+		std::unique_lock<std::mutex> lock(mutex);
+		while (numRemaining > 0) {
+			condDone.wait(lock);
+		}
+		tasks = nullptr;
+		if (error) {
+			THROWF(RuntimeException, "%s", errorMessage.c_str());
+		}
+	}
+
+private:
+	class Worker : public ThreadBase
+	{
+	public:
+		Worker(ParallelTaskPool* pool) : pool(pool) { }
+	protected:
+		virtual void run() {
+			pool->workerLoop();
+		}
+	private:
+		ParallelTaskPool* pool;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	std::mutex mutex;
+	std::condition_variable condTask;
+	std::condition_variable condDone;
+
+	std::vector<std::function<void()>>* tasks;
+	int nextTask;
+	int numRemaining;
+	bool finished;
+
+	bool error;
+	std::string errorMessage;
+
+	void workerLoop() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!finished) {
+			if (tasks != nullptr && nextTask < (int)tasks->size()) {
+				lock.unlock();
+				processTasks();
+				lock.lock();
+			}
+			else {
+				condTask.wait(lock);
+			}
+		}
+	}
+
+	// cĂ^XNȂȂ܂ŎĎs
+	void processTasks() {
+		while (true) {
+			std::function<void()>* task;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (tasks == nullptr || nextTask >= (int)tasks->size()) {
+					return;
+				}
+				task = &(*tasks)[nextTask++];
+			}
+			// ǂ̗OłnumRemaining͕K炷
+			// i炳ȂrunAll߂ȂA^XNc܂܌Ăяovectorjj
+			try {
+				(*task)();
+			}
+			catch (const Exception& e) {
+				setError(e.message());
+			}
+			catch (const std::exception& e) {
+				setError(e.what());
+			}
+			catch (...) {
+				setError("ParallelTaskPool: sȗO");
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--numRemaining == 0) {
+					condDone.notify_all();
+				}
+			}
+		}
+	}
+
+	void setError(const std::string& message) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!error) {
+			error = true;
+			errorMessage = message;
+		}
+	}
+};
+
 class SubProcess
 {
 public:
@@ -236,6 +711,24 @@ public:
 			THROW(RuntimeException, "failed to write to stdin pipe (bytes written mismatch)");
 		}
 	}
+	// ̃̈܂Ƃ߂ď
+	// pCvɂWriteFileGathergȂ̂ŁA傫̈iv[ŜȂǁj̓Rs[̂܂܏A
+	// ̈ipfBÔsȂǁj͂Ȃł珑i݉񐔂}邽߁j
+	void writev(const MemoryChunk* chunks, int count) {
+		writeBuffer_.clear();
+		for (int i = 0; i < count; ++i) {
+			if (chunks[i].length >= GATHER_DIRECT_SIZE) {
+				flushWriteBuffer();
+				write(chunks[i]);
+				continue;
+			}
+			writeBuffer_.add(chunks[i]);
+			if (writeBuffer_.size() >= GATHER_DIRECT_SIZE) {
+				flushWriteBuffer();
+			}
+		}
+		flushWriteBuffer();
+	}
 	size_t readErr(MemoryChunk mc) {
 		return readGeneric(mc, stdErrPipe_.readHandle);
 	}
@@ -259,6 +752,8 @@ public:
 		return exitCode_;
 	}
 private:
+	enum { GATHER_DIRECT_SIZE = 64 * 1024 };
+
 	class Pipe {
 	public:
 		Pipe() {
@@ -296,6 +791,14 @@ private:
 	Pipe stdOutPipe_;
 	Pipe stdInPipe_;
 	DWORD exitCode_;
+	AutoBuffer writeBuffer_;
+
+	void flushWriteBuffer() {
+		if (writeBuffer_.size() > 0) {
+			write(writeBuffer_.get());
+			writeBuffer_.clear();
+		}
+	}
 
 	size_t readGeneric(MemoryChunk mc, HANDLE readHandle)
 	{
@@ -10,17 +10,25 @@
 #include <algorithm>
 #include <vector>
 #include <array>
+#include <atomic>
 #include <map>
 #include <set>
 #include <fstream>
 #include <cctype>
 #include <locale>
 #include <codecvt>
+#include <emmintrin.h>
 
 #include "CoreUtils.hpp"
 #include "OSUtil.hpp"
 #include "StringUtils.hpp"
 
+// ComputeKernel.cpp
+bool IsAVX2Available();
+int FindStartCodeCandidate_AVX2(const uint8_t* data, int length);
+bool IsPCLMULQDQAvailable();
+void FoldCRC32_CLMUL(const uint8_t* data, int length, uint32_t crc, uint8_t* folded);
+
 enum {
 	TS_SYNC_BYTE = 0x47,
 
@@ -75,6 +83,60 @@ void write32(uint8_t* ptr, uint32_t w) { writeN<4, uint32_t>(ptr, w); }
 void write40(uint8_t* ptr, uint64_t w) { writeN<5, uint64_t>(ptr, w); }
 void write48(uint8_t* ptr, uint64_t w) { writeN<6, uint64_t>(ptr, w); }
 
+// start code prefix(00 00 01)H264̃G~[Vh~oCg(00 00 03)̌T
+// data[i]=0, data[i+1]=0, data[i+2]<=3 ƂȂŏiԂiȂꍇ-1j
+// Ăяo3oCgڂmF邱
+int FindStartCodeCandidate_C(const uint8_t* data, int length) {
+	int i = 0;
+	while (i + 2 < length) {
+		if (data[i + 1] != 0) {
+			// i,i+1͎n܂Ȃ
+			i += 2;
+		}
+		else if (data[i] != 0) {
+			i += 1;
+		}
+		else if (data[i + 2] > 3) {
+			// i,i+1,i+2͎n܂Ȃ
+			i += 3;
+		}
+		else {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int FindStartCodeCandidate_SSE2(const uint8_t* data, int length) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i three = _mm_set1_epi8(3);
+	int i = 0;
+	for (; i + 18 <= length; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(data + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(data + i + 1));
+		__m128i c = _mm_loadu_si128((const __m128i*)(data + i + 2));
+		__m128i m = _mm_and_si128(
+			_mm_cmpeq_epi8(_mm_or_si128(a, b), zero),
+			_mm_cmpeq_epi8(_mm_min_epu8(c, three), c));
+		int mask = _mm_movemask_epi8(m);
+		if (mask) {
+			DWORD index;
+			_BitScanForward(&index, mask);
+			return i + (int)index;
+		}
+	}
+	int r = FindStartCodeCandidate_C(data + i, length - i);
+	return (r < 0) ? r : i + r;
+}
+
+int FindStartCodeCandidate(const uint8_t* data, int length) {
+	static const bool avx2 = IsAVX2Available();
+	if (avx2) {
+		return FindStartCodeCandidate_AVX2(data, length);
+	}
+	return FindStartCodeCandidate_SSE2(data, length);
+}
+
 
 class BitReader {
 public:
@@ -133,25 +195,24 @@ public:
 	}
 
 	uint32_t readExpGolom() {
-		uint64_t masked = bsm(current, 0, filled);
-		if (masked == 0) {
+		if (filled < 32) {
 			fill();
-			masked = bsm(current, 0, filled);
-			if (masked == 0) {
-				throw EOFException("BitReader.readExpGolomŃI[o[");
-			}
 		}
-		int bodyLen = filled - __builtin_clzl(masked);
-		filled -= bodyLen - 1;
-		if (bodyLen > filled) {
-			fill();
-			if (bodyLen > filled) {
-				throw EOFException("BitReader.readExpGolomŃI[o[");
+		if (filled > 0) {
+			// Lrbgl߂ɂΐ擪0̐̂܂ܕ
+			uint64_t top = current << (64 - filled);
+			if (top != 0) {
+				// common.h__builtin_clzl͍ŏʃrbg̈ʒuԂ
+				int zeros = 63 - __builtin_clzl(top);
+				int codeLen = zeros * 2 + 1;
+				if (codeLen <= filled) {
+					filled -= codeLen;
+					return (uint32_t)((top >> (64 - codeLen)) - 1);
+				}
 			}
 		}
-		int shift = filled - bodyLen;
-		filled -= bodyLen;
-		return (uint32_t)bsm(current, shift, bodyLen) - 1;
+		// I[t߂32bit߂l̏ꍇ
+		return readExpGolomSlow();
 	}
 
 	void skip(int bits) {
@@ -196,7 +257,33 @@ private:
 	int filled;
 
 	void fill() {
-		while (filled + 8 <= 64 && offset < (int)data.length) readByte();
+		int bytes = (64 - filled) >> 3;
+		if (bytes == 0) {
+			return;
+		}
+		if (offset + 8 <= (int)data.length) {
+			// 8oCg܂Ƃ߂ēǂœ镪
+			uint64_t word;
+			memcpy(&word, data.data + offset, 8);
+			word = _byteswap_uint64(word);
+			current = (bytes == 8) ? word : ((current << (bytes * 8)) | (word >> (64 - bytes * 8)));
+			filled += bytes * 8;
+			offset += bytes;
+		}
+		else {
+			while (filled + 8 <= 64 && offset < (int)data.length) readByte();
+		}
+	}
+
+	uint32_t readExpGolomSlow() {
+		int zeros = 0;
+		while (readn(1) == 0) {
+			if (++zeros > 31) {
+				throw FormatException("BitReader.readExpGolom32bit𒴂l");
+			}
+		}
+		uint32_t body = (zeros > 0) ? readn(zeros) : 0;
+		return (uint32_t)(((uint64_t(1) << zeros) | body) - 1);
 	}
 
 	void readByte() {
@@ -274,9 +361,39 @@ class CRC32 {
 public:
 	CRC32() {
 		createTable(table, 0x04C11DB7UL);
+		createSliceTable();
 	}
 
 	uint32_t calc(const uint8_t* data, int length, uint32_t crc) const {
+		static const bool clmul = IsPCLMULQDQAvailable();
+		if (clmul && length >= CLMUL_MIN_LENGTH) {
+			// 16oCgPʂŏݍŎc̓e[uŌvZ
+			int foldLength = length & ~15;
+			uint8_t folded[16];
+			FoldCRC32_CLMUL(data, foldLength, crc, folded);
+			crc = calcSlicing8(folded, 16, 0);
+			data += foldLength;
+			length -= foldLength;
+		}
+		return calcSlicing8(data, length, crc);
+	}
+
+	// 8oCgislicing-by-8j
+	uint32_t calcSlicing8(const uint8_t* data, int length, uint32_t crc) const {
+		int i = 0;
+		for (; i + 8 <= length; i += 8) {
+			uint32_t a = crc ^ read32(data + i);
+			uint32_t b = read32(data + i + 4);
+			crc = slice[7][a >> 24] ^ slice[6][(a >> 16) & 0xFF] ^
+				slice[5][(a >> 8) & 0xFF] ^ slice[4][a & 0xFF] ^
+				slice[3][b >> 24] ^ slice[2][(b >> 16) & 0xFF] ^
+				slice[1][(b >> 8) & 0xFF] ^ slice[0][b & 0xFF];
+		}
+		return calcBytewise(data + i, length - i, crc);
+	}
+
+	// 1oCgit@Xj
+	uint32_t calcBytewise(const uint8_t* data, int length, uint32_t crc) const {
 		for (int i = 0; i < length; ++i) {
 			crc = (crc << 8) ^ table[(crc >> 24) ^ data[i]];
 		}
@@ -286,7 +403,24 @@ public:
 	const uint32_t* getTable() const { return table; }
 
 private:
+	// ZPCLMULQDQgĂȂȂ
+	enum { CLMUL_MIN_LENGTH = 256 };
+
 	uint32_t table[256];
+	// slice[k][b]: oCgb̌koCg0ƂCRC
+	uint32_t slice[8][256];
+
+	void createSliceTable() {
+		for (int i = 0; i < 256; ++i) {
+			slice[0][i] = table[i];
+		}
+		for (int k = 1; k < 8; ++k) {
+			for (int i = 0; i < 256; ++i) {
+				uint32_t crc = slice[k - 1][i];
+				slice[k][i] = (crc << 8) ^ table[crc >> 24];
+			}
+		}
+	}
 
 	static void createTable(uint32_t* table, uint32_t exp) {
 		for (int i = 0; i < 256; ++i) {
@@ -340,12 +474,48 @@ const char* AMT_ERROR_NAMES[] = {
 	 "decode-audio-failed",
 };
 
+enum AMT_PERF_COUNTER {
+	// AMTSourcẽt[LbVqbg
+	AMT_PERF_SOURCE_CACHE_HIT = 0,
+	// AMTSourcẽt[LbV~X
+	AMT_PERF_SOURCE_CACHE_MISS,
+	// AMTSourcẽV[N
+	AMT_PERF_SOURCE_SEEK,
+	// AMTSource̐ǂ݃XbhŃfR[ht[
+	AMT_PERF_SOURCE_READ_AHEAD,
+	// AMTSourceŃfR[h҂ԁi}CNbj
+	AMT_PERF_SOURCE_DECODE_STALL,
+	// TS͂ŉt[́iAACfR[h܂ށjɂԂ̍vi}CNbj
+	AMT_PERF_AUDIO_DECODE,
+	// TS͂̉Xe[Wt[͂Ɏgԁi}CNbj
+	AMT_PERF_AUDIO_DECODE_WALL,
+	// TS͂Œԃt@Cɏ񂾃oCg
+	AMT_PERF_SPLIT_WRITE_BYTES,
+	// TS͂Œԃt@C݂̏҂ԁi}CNbj
+	AMT_PERF_SPLIT_WRITE_BLOCKED,
+	// JE^̌
+	AMT_PERF_MAX,
+};
+
+const char* AMT_PERF_NAMES[] = {
+	"source-cache-hit",
+	"source-cache-miss",
+	"source-seek",
+	"source-read-ahead",
+	"source-decode-stall-us",
+	"audio-decode-us",
+	"audio-decode-wall-us",
+	"split-write-bytes",
+	"split-write-blocked-us",
+};
+
 class AMTContext {
 public:
 	AMTContext()
 		: timePrefix(true)
 		, acp(GetACP())
 		, errCounter()
+		, perfCounter()
 	{ }
 
 	const CRC32* getCRC() const {
@@ -419,6 +589,15 @@ public:
 		return errCounter[err];
 	}
 
+	// vpJE^iXbhĂ΂j
+	void addPerfCounter(AMT_PERF_COUNTER counter, int64_t value = 1) {
+		perfCounter[counter].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	int64_t getPerfCounter(AMT_PERF_COUNTER counter) const {
+		return perfCounter[counter].load(std::memory_order_relaxed);
+	}
+
 	void setError(const Exception& exception) {
 		errMessage = exception.message();
 	}
@@ -474,7 +653,8 @@ private:
 	int acp;
 
 	std::set<tstring> tmpFiles;
-	std::array<int, AMT_ERR_MAX> errCounter;
+	std::array<std::atomic<int>, AMT_ERR_MAX> errCounter;
+	std::array<std::atomic<int64_t>, AMT_PERF_MAX> perfCounter;
 	std::string errMessage;
 
 	std::map<std::string, std::wstring> drcsMap;
@@ -10,7 +10,16 @@
 #include <string>
 #include <cassert>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdarg>
+#ifdef _MSC_VER
 #include <direct.h>
+#else
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 #ifdef _MSC_VER
 typedef std::wstring tstring;
@@ -40,6 +49,7 @@ size_t strlenT(const char* string) {
 	return strlen(string);
 }
 
+#ifdef _MSC_VER
 int stricmpT(const wchar_t* string1, const wchar_t* string2) {
 	return _wcsicmp(string1, string2);
 }
@@ -75,10 +85,42 @@ FILE* fsopenT(const wchar_t* FileName, const wchar_t* Mode, int ShFlag) {
 FILE* fsopenT(const char* FileName, const char* Mode, int ShFlag) {
 	return _fsopen(FileName, Mode, ShFlag);
 }
+#else
+// POSIXłtcharcharȂ̂charł
+int stricmpT(const char* string1, const char* string2) {
+	return strcasecmp(string1, string2);
+}
+
+int rmdirT(const char* dirname) {
+	return rmdir(dirname);
+}
+
+int mkdirT(const char* dirname) {
+	return mkdir(dirname, 0777);
+}
+
+int removeT(const char* dirname) {
+	return remove(dirname);
+}
+
+FILE* fsopenT(const char* FileName, const char* Mode, int /*ShFlag*/) {
+	return fopen(FileName, Mode);
+}
+
+// MSVC_scprintfƓ̕Ԃ
+static int _scprintf(const char* format, ...) {
+	va_list argp;
+	va_start(argp, format);
+	int size = vsnprintf(NULL, 0, format, argp);
+	va_end(argp);
+	return size;
+}
+#endif
 
 
 namespace string_internal {
 
+#ifdef _MSC_VER
 // nullI[̂
 static std::vector<char> to_string(std::wstring str) {
 	if (str.size() == 0) {
@@ -104,6 +146,23 @@ static std::vector<wchar_t> to_wstring(std::string str) {
 	ret.back() = 0; // null terminate
 	return ret;
 }
+#else
+// POSIX݂͌̃P[ŕϊinullI[̂Łj
+static std::vector<char> to_string(std::wstring str) {
+	std::vector<char> ret(str.size() * MB_CUR_MAX + 1);
+	size_t dstlen = wcstombs(ret.data(), str.c_str(), ret.size());
+	ret.resize((dstlen == (size_t)-1) ? 1 : dstlen + 1);
+	ret.back() = 0; // null terminate
+	return ret;
+}
+static std::vector<wchar_t> to_wstring(std::string str) {
+	std::vector<wchar_t> ret(str.size() + 1);
+	size_t dstlen = mbstowcs(ret.data(), str.c_str(), ret.size());
+	ret.resize((dstlen == (size_t)-1) ? 1 : dstlen + 1);
+	ret.back() = 0; // null terminate
+	return ret;
+}
+#endif
 
 class MakeArgContext {
 	std::vector<std::vector<char>> args;
@@ -123,18 +182,18 @@ public:
 	}
 };
 
-template <typename T> T MakeArg(MakeArgContext& ctx, T value) { return value; }
-template <typename T> T MakeArgW(MakeArgWContext& ctx, T value) { return value; }
+template <typename T> T MakeArg(MakeArgContext& /*ctx*/, T value) { return value; }
+template <typename T> T MakeArgW(MakeArgWContext& /*ctx*/, T value) { return value; }
 
-const char* MakeArg(MakeArgContext& ctx, const char* value) { return value; }
+const char* MakeArg(MakeArgContext& /*ctx*/, const char* value) { return value; }
 const char* MakeArg(MakeArgContext& ctx, const wchar_t* value) { return ctx.arg(value); }
-const char* MakeArg(MakeArgContext& ctx, const std::string& value) { return value.c_str(); }
+const char* MakeArg(MakeArgContext& /*ctx*/, const std::string& value) { return value.c_str(); }
 const char* MakeArg(MakeArgContext& ctx, const std::wstring& value) { return ctx.arg(value); }
 
 const wchar_t* MakeArgW(MakeArgWContext& ctx, const char* value) { return ctx.arg(value); }
-const wchar_t* MakeArgW(MakeArgWContext& ctx, const wchar_t* value) { return value; }
+const wchar_t* MakeArgW(MakeArgWContext& /*ctx*/, const wchar_t* value) { return value; }
 const wchar_t* MakeArgW(MakeArgWContext& ctx, const std::string& value) { return ctx.arg(value); }
-const wchar_t* MakeArgW(MakeArgWContext& ctx, const std::wstring& value) { return value.c_str(); }
+const wchar_t* MakeArgW(MakeArgWContext& /*ctx*/, const std::wstring& value) { return value.c_str(); }
 
 class StringBuilderBase {
 public:
@@ -320,6 +379,7 @@ protected:
 	}
 };
 
+#ifdef _MSC_VER
 std::vector<char> utf8ToString(const uint8_t* ptr, int sz) {
 	int dstlen = MultiByteToWideChar(
 		CP_UTF8, 0, (const char*)ptr, sz, nullptr, 0);
@@ -333,6 +393,7 @@ std::vector<char> utf8ToString(const uint8_t* ptr, int sz) {
 		w.data(), (int)w.size(), ret.data(), (int)ret.size(), nullptr, nullptr);
 	return ret;
 }
+#endif
 
 template <typename tchar>
 std::vector<std::basic_string<tchar>> split(const std::basic_string<tchar>& text, const tchar* delimiters)
@@ -402,7 +463,7 @@ static tstring pathRemoveExtension(const tstring& path) {
 	for (int i = 0; exts[i]; ++i) {
 		size_t extlen = strlenT(exts[i]);
 		if (path.size() > extlen) {
-			if (_wcsicmp(c_path + (path.size() - extlen), exts[i]) == 0) {
+			if (stricmpT(c_path + (path.size() - extlen), exts[i]) == 0) {
 				return path.substr(0, path.size() - extlen);
 			}
 		}
@@ -10,6 +10,7 @@
 #include <string>
 #include <memory>
 #include <limits>
+#include <thread>
 #include <smmintrin.h>
 
 #include "TsSplitter.hpp"
@@ -31,9 +32,9 @@ public:
 		: TsSplitter(ctx, true, true, setting.isSubtitlesEnabled())
 		, setting_(setting)
 		, psWriter(ctx)
-		, writeHandler(*this)
-		, audioFile_(setting.getAudioFilePath(), _T("wb"))
-		, waveFile_(setting.getWaveFilePath(), _T("wb"))
+		, writeHandler(*this, setting.isUnbufferedSplitOutput())
+		, audioFile_(setting.getAudioFilePath(), setting.isUnbufferedSplitOutput())
+		, waveFile_(setting.getWaveFilePath(), setting.isUnbufferedSplitOutput())
 		, curVideoFormat_()
 		, videoFileCount_(0)
 		, videoStreamType_(-1)
@@ -48,6 +49,7 @@ public:
 	StreamReformInfo split()
 	{
 		readAll();
+		closeOutputs();
 
 		// for debug
 		printInteraceCount();
@@ -67,11 +69,16 @@ public:
 protected:
 	class StreamFileWriteHandler : public PsStreamWriter::EventHandler {
 		TsSplitter& this_;
-		std::unique_ptr<File> file_;
+		bool unbuffered_;
+		std::unique_ptr<AsyncFileWriter> file_;
 		int64_t totalIntVideoSize_;
+		// t@C̕܂߂v
+		int64_t totalWrittenBytes_;
+		double totalBlockedTime_;
 	public:
-		StreamFileWriteHandler(TsSplitter& this_)
-			: this_(this_), totalIntVideoSize_() { }
+		StreamFileWriteHandler(TsSplitter& this_, bool unbuffered)
+			: this_(this_), unbuffered_(unbuffered), totalIntVideoSize_()
+			, totalWrittenBytes_(), totalBlockedTime_() { }
 		virtual void onStreamData(MemoryChunk mc) {
 			if (file_ != NULL) {
 				file_->write(mc);
@@ -79,22 +86,34 @@ protected:
 			}
 		}
 		void open(const tstring& path) {
+			close();
 			totalIntVideoSize_ = 0;
-			file_ = std::unique_ptr<File>(new File(path, _T("wb")));
+			file_ = std::unique_ptr<AsyncFileWriter>(new AsyncFileWriter(path, unbuffered_));
 		}
 		void close() {
-			file_ = nullptr;
+			if (file_ != NULL) {
+				file_->close();
+				totalWrittenBytes_ += file_->getTotalBytes();
+				totalBlockedTime_ += file_->getBlockedTime();
+				file_ = nullptr;
+			}
 		}
 		int64_t getTotalSize() const {
 			return totalIntVideoSize_;
 		}
+		int64_t getTotalWrittenBytes() const {
+			return totalWrittenBytes_;
+		}
+		double getTotalBlockedTime() const {
+			return totalBlockedTime_;
+		}
 	};
 
 	const ConfigWrapper& setting_;
 	PsStreamWriter psWriter;
 	StreamFileWriteHandler writeHandler;
-	File audioFile_;
-	File waveFile_;
+	AsyncFileWriter audioFile_;
+	AsyncFileWriter waveFile_;
 	VideoFormat curVideoFormat_;
 
 	int videoFileCount_;
@@ -112,6 +131,18 @@ protected:
 	std::vector<std::pair<int64_t, JSTTime>> timeList_;
 
 	void readAll() {
+		if (setting_.isPipelinedSplit()) {
+			readAllPipelined();
+			return;
+		}
+		if (setting_.isMmapInput()) {
+			readAllMapped();
+			return;
+		}
+		readAllBuffered();
+	}
+
+	void readAllBuffered() {
 		enum { BUFSIZE = 4 * 1024 * 1024 };
 		auto buffer_ptr = std::unique_ptr<uint8_t[]>(new uint8_t[BUFSIZE]);
 		MemoryChunk buffer(buffer_ptr.get(), BUFSIZE);
@@ -124,6 +155,66 @@ protected:
 		} while (readBytes == buffer.length);
 	}
 
+	// }bvr[璼ڃpPbg؂oiRs[Ȃj
+	void readAllMapped() {
+		MappedFile srcfile(setting_.getSrcFilePath());
+		srcFileSize_ = srcfile.size();
+		for (int64_t offset = 0; offset < srcFileSize_; ) {
+			MemoryChunk view = srcfile.map(offset);
+			inputTsDataDirect(view);
+			offset += view.length;
+		}
+	}
+
+	// ǂݍ݂͂̃XbhA͈ȍ~̓pCvC̃Xbhōs
+	void readAllPipelined() {
+		enum { BUFSIZE = 4 * 1024 * 1024 };
+		File srcfile(setting_.getSrcFilePath(), _T("rb"));
+		srcFileSize_ = srcfile.size();
+		startPipeline();
+		std::exception_ptr error;
+		try {
+			size_t readBytes;
+			do {
+				std::vector<uint8_t> buffer(BUFSIZE);
+				readBytes = srcfile.read(MemoryChunk(buffer.data(), BUFSIZE));
+				buffer.resize(readBytes);
+				inputTsDataPipelined(std::move(buffer));
+			} while (readBytes == BUFSIZE);
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		// pCvC̃Xbh~߂Ă瓊iG[͍ŏ̂̂j
+		try {
+			finishPipeline();
+		}
+		catch (...) {
+			if (!error) error = std::current_exception();
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	// ԃt@C݂̏ēvo
+	void closeOutputs() {
+		writeHandler.close();
+		audioFile_.close();
+		waveFile_.close();
+
+		int64_t videoBytes = writeHandler.getTotalWrittenBytes();
+		int64_t totalBytes = videoBytes + audioFile_.getTotalBytes() + waveFile_.getTotalBytes();
+		double blocked = writeHandler.getTotalBlockedTime() +
+			audioFile_.getBlockedTime() + waveFile_.getBlockedTime();
+		ctx.infoF("ԃt@C: f %.1fMB  %.1fMB wave %.1fMB ݑ҂ %.2fb",
+			videoBytes / (1024.0 * 1024.0),
+			audioFile_.getTotalBytes() / (1024.0 * 1024.0),
+			waveFile_.getTotalBytes() / (1024.0 * 1024.0), blocked);
+		ctx.addPerfCounter(AMT_PERF_SPLIT_WRITE_BYTES, totalBytes);
+		ctx.addPerfCounter(AMT_PERF_SPLIT_WRITE_BLOCKED, (int64_t)(blocked * 1000000));
+	}
+
 	static bool CheckPullDown(PICTURE_TYPE p0, PICTURE_TYPE p1) {
 		switch (p0) {
 		case PIC_TFF:
@@ -360,6 +451,20 @@ public:
 		tstring timecodepath,
 		int vfrTimingFps,
 		EncodeFileKey key, int pass)
+	{
+		return GenEncoderOptions(numFrames, outfmt, zones, vfrBitrateScale,
+			timecodepath, vfrTimingFps, key, pass, setting_.getEncVideoFilePath(key));
+	}
+
+	tstring GenEncoderOptions(
+		int numFrames,
+		VideoFormat outfmt,
+		std::vector<BitrateZone> zones,
+		double vfrBitrateScale,
+		tstring timecodepath,
+		int vfrTimingFps,
+		EncodeFileKey key, int pass,
+		const tstring& outpath)
 	{
 		VIDEO_STREAM_FORMAT srcFormat = reformInfo_.getVideoStreamFormat();
 		double srcBitrate = getSourceBitrate(key.video);
@@ -372,7 +477,7 @@ public:
 			outfmt,
 			timecodepath,
 			vfrTimingFps,
-			setting_.getEncVideoFilePath(key));
+			outpath);
 	}
 
 	// src, target
@@ -441,6 +546,19 @@ static std::vector<BitrateZone> MakeBitrateZones(
 	return bitrateZones;
 }
 
+// 蓖ĂꂽRAi}XNȂ̂ƂCPUj
+static int CountAllocatedCores(const ResourceAllocation& res)
+{
+	if (res.mask == 0) {
+		return std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	int count = 0;
+	for (uint64_t mask = res.mask; mask; mask &= mask - 1) {
+		++count;
+	}
+	return count;
+}
+
 #if 0
 // y[Wq[v@\Ă邩eXg
 void DoBadThing() {
@@ -486,7 +604,10 @@ static void transcodeMain(AMTContext& ctx, const ConfigWrapper& setting)
 		splitter->setServiceId(setting.getServiceId());
 	}
 	StreamReformInfo reformInfo = splitter->split();
-	ctx.infoF("TS͊: %.2fb", sw.getAndReset());
+	double splitTime = sw.getAndReset();
+	ctx.infoF("TS͊: %.2fb (%s %.1fMB/s)", splitTime,
+		setting.isPipelinedSplit() ? "pCvC" : setting.isMmapInput() ? "}bv" : "obt@",
+		splitter->getSrcFileSize() / (1024.0 * 1024.0) / std::max(splitTime, 0.001));
 	int serviceId = splitter->getActualServiceId();
 	int64_t numTotalPackets = splitter->getNumTotalPackets();
 	int64_t numScramblePackets = splitter->getNumScramblePackets();
@@ -546,13 +667,14 @@ static void transcodeMain(AMTContext& ctx, const ConfigWrapper& setting)
 		// t@Cǂݍݏۑ
 		auto& fmt = reformInfo.getFormat(EncodeFileKey(videoFileIndex, 0));
 		auto amtsPath = setting.getTmpAMTSourcePath(videoFileIndex);
-		av::SaveAMTSource(amtsPath,
+		av::SaveAMTSource(ctx, amtsPath,
 			setting.getIntVideoFilePath(videoFileIndex),
 			setting.getWaveFilePath(),
 			fmt.videoFormat, fmt.audioFormat[0],
 			reformInfo.getFilterSourceFrames(videoFileIndex),
 			reformInfo.getFilterSourceAudioFrames(videoFileIndex),
 			setting.getDecoderSetting());
+		ctx.registerTmpFile(av::GetAMTSeekIndexPath(amtsPath));
 	}
 
 	// SECM
@@ -660,20 +782,40 @@ static void transcodeMain(AMTContext& ctx, const ConfigWrapper& setting)
 	}
 	ctx.infoF("t@C: %.2fb", sw.getAndReset());
 
+	std::unique_ptr<AudioEncodeThread> audioEncodeThread;
 	if (setting.isEncodeAudio()) {
 		ctx.info("[GR[h]");
+		std::vector<AudioEncodeThread::Job> audioJobs;
 		for (int i = 0; i < (int)keys.size(); ++i) {
 			auto key = keys[i];
 			auto outpath = setting.getIntAudioFilePath(key, 0);
-			auto args = makeAudioEncoderArgs(
+			AudioEncodeThread::Job job;
+			job.args = makeAudioEncoderArgs(
 				setting.getAudioEncoder(),
 				setting.getAudioEncoderPath(),
 				setting.getAudioEncoderOptions(),
 				setting.getAudioBitrateInKbps(),
 				outpath);
-			auto format = reformInfo.getFormat(key);
-			auto audioFrames = reformInfo.getWaveInput(reformInfo.getEncodeFile(key).audioFrames[0]);
-			EncodeAudio(ctx, args, setting.getWaveFilePath(), format.audioFormat[0], audioFrames);
+			job.afmt = reformInfo.getFormat(key).audioFormat[0];
+			job.audioFrames = reformInfo.getWaveInput(reformInfo.getEncodeFile(key).audioFrames[0]);
+			audioJobs.push_back(std::move(job));
+		}
+		if (setting.isParallelAudioEncode()) {
+			// fGR[hƕɎsMuxOɑ҂
+			ctx.info("GR[h͉fGR[hƕɎs܂");
+			audioEncodeThread = std::unique_ptr<AudioEncodeThread>(
+				new AudioEncodeThread(ctx, setting.getWaveFilePath(), std::move(audioJobs)));
+			audioEncodeThread->start();
+		}
+		else {
+			for (int i = 0; i < (int)audioJobs.size(); ++i) {
+				const auto& job = audioJobs[i];
+				Stopwatch audioSw;
+				audioSw.start();
+				EncodeAudio(ctx, job.args, setting.getWaveFilePath(), job.afmt, job.audioFrames);
+				outFileInfo[i].audioEncodeTime = audioSw.getAndReset();
+				ctx.infoF("GR[h %d/%d : %.2fb", i + 1, (int)audioJobs.size(), outFileInfo[i].audioEncodeTime);
+			}
 		}
 	}
 
@@ -734,6 +876,33 @@ static void transcodeMain(AMTContext& ctx, const ConfigWrapper& setting)
 
 			auto bitrateZones = MakeBitrateZones(timeCodes, encoderZones, setting, outvi);
 			auto vfrBitrateScale = AdjustVFRBitrate(timeCodes, outvi.fps_numerator, outvi.fps_denominator);
+
+			if (setting.isSegmentedEncode(fileOut.timecode.size() > 0)) {
+				// ԂƂɕʂ̃GR[_ŕɃGR[hiԂ͍Œ10bj
+				// SԂAtBjeBœ̂ŋԐ͊蓖ĂꂽRA܂
+				int minSegmentFrames = 10 * outvi.fps_numerator / outvi.fps_denominator;
+				int numSegments = std::min(setting.getNumEncodeSegments(),
+					CountAllocatedCores(filterSource.getEncodeResource()));
+				auto segments = MakeEncodeSegments(outvi.num_frames, encoderZones,
+					numSegments, minSegmentFrames);
+				if (segments.size() > 1) {
+					std::vector<tstring> segmentArgs;
+					std::vector<tstring> segmentPaths;
+					for (int s = 0; s < (int)segments.size(); ++s) {
+						segmentPaths.push_back(setting.getEncVideoSegmentFilePath(key, s));
+						segmentArgs.push_back(
+							argGen->GenEncoderOptions(
+								segments[s].endFrame - segments[s].startFrame,
+								outfmt, SliceBitrateZones(bitrateZones, segments[s]), vfrBitrateScale,
+								fileOut.timecode, fileOut.vfrTimingFps, key, -1, segmentPaths.back()));
+					}
+					AMTSegmentedVideoEncoder encoder(ctx, std::max(4, setting.getNumEncodeBufferFrames()));
+					encoder.encode(filterClip, env, filterSource.getScript(), outfmt, segments,
+						segmentArgs, segmentPaths, setting.getEncVideoFilePath(key));
+					continue;
+				}
+			}
+
 			// VFRt[^C~O120fps
 			std::vector<tstring> encoderArgs;
 			for (int i = 0; i < (int)pass.size(); ++i) {
@@ -744,6 +913,9 @@ static void transcodeMain(AMTContext& ctx, const ConfigWrapper& setting)
 						fileOut.timecode, fileOut.vfrTimingFps, key, pass[i]));
 			}
 			AMTFilterVideoEncoder encoder(ctx, std::max(4, setting.getNumEncodeBufferFrames()));
+			if (setting.isTwoPass() && setting.getTwoPassFrameCacheBytes() > 0) {
+				encoder.setFrameCache(setting.getEncFrameCachePath(key), setting.getTwoPassFrameCacheBytes());
+			}
 			encoder.encode(filterClip, outfmt,
 				timeCodes, encoderArgs, env);
 		}
@@ -752,9 +924,29 @@ static void transcodeMain(AMTContext& ctx, const ConfigWrapper& setting)
 		}
 	}
 	ctx.infoF("GR[h: %.2fb", sw.getAndReset());
+	ctx.infoF("\[XLbV: qbg %lld ~X %lld V[N %lld",
+		ctx.getPerfCounter(AMT_PERF_SOURCE_CACHE_HIT),
+		ctx.getPerfCounter(AMT_PERF_SOURCE_CACHE_MISS),
+		ctx.getPerfCounter(AMT_PERF_SOURCE_SEEK));
+	ctx.infoF("\[XfR[h҂: %.2fb ǂ: %lldt[",
+		ctx.getPerfCounter(AMT_PERF_SOURCE_DECODE_STALL) / 1000000.0,
+		ctx.getPerfCounter(AMT_PERF_SOURCE_READ_AHEAD));
 
 	argGen = nullptr;
 
+	if (audioEncodeThread != nullptr) {
+		ctx.info("[GR[h҂]");
+		Stopwatch swAudio;
+		swAudio.start();
+		audioEncodeThread->join();
+		ctx.infoF(": %.2fb", swAudio.getAndReset());
+		const auto& times = audioEncodeThread->getTimes();
+		for (int i = 0; i < (int)keys.size(); ++i) {
+			outFileInfo[i].audioEncodeTime = times[i];
+		}
+		audioEncodeThread = nullptr;
+	}
+
 	rm.wait(HOST_CMD_Mux);
 	sw.start();
 	int64_t totalOutSize = 0;
@@ -790,6 +982,7 @@ static void transcodeMain(AMTContext& ctx, const ConfigWrapper& setting)
 			sb.append("{ \"path\": \"%s\", \"srcbitrate\": %d, \"outbitrate\": %d, \"outfilesize\": %lld, ",
 				toJsonString(setting.getOutFilePath(file.outKey, file.keyMax)), (int)info.srcBitrate,
 				std::isnan(info.targetBitrate) ? -1 : (int)info.targetBitrate, info.fileSize);
+			sb.append("\"audioencodetime\": %.3f, ", info.audioEncodeTime);
 			sb.append("\"subs\": [");
 			for (int s = 0; s < (int)info.outSubs.size(); ++s) {
 				if (s > 0) sb.append(", ");
@@ -817,6 +1010,12 @@ static void transcodeMain(AMTContext& ctx, const ConfigWrapper& setting)
 			sb.append("\"%s\": %d", AMT_ERROR_NAMES[i], ctx.getErrorCount((AMT_ERROR_COUNTER)i));
 		}
 		sb.append(" }");
+		sb.append(", \"perf\": {");
+		for (int i = 0; i < AMT_PERF_MAX; ++i) {
+			if (i > 0) sb.append(", ");
+			sb.append("\"%s\": %lld", AMT_PERF_NAMES[i], ctx.getPerfCounter((AMT_PERF_COUNTER)i));
+		}
+		sb.append(" }");
 		sb.append(", \"cmanalyze\": %s", (setting.isChapterEnabled() ? "true" : "false"))
 			.append(", \"nicojk\": %s", (nicoOK ? "true" : "false"))
 			.append(", \"trimavs\": %s", (setting.getTrimAVSPath().size() ? "true" : "false"))
@@ -531,6 +531,8 @@ struct Config {
 	ENUM_FORMAT format;
 	bool splitSub;
 	bool twoPass;
+	// 2pXGR[h1pXڂ̃tB^o͂ۑĂeʏ(MB) 0ȂLbVȂ
+	int twoPassFrameCacheSize;
 	bool autoBitrate;
 	bool chapter;
 	bool subtitles;
@@ -543,7 +545,21 @@ struct Config {
 	int serviceId;
 	DecoderSetting decoderSetting;
 	int audioBitrateInKbps;
+	// GR[hfGR[hƕɍs
+	bool parallelAudioEncode;
+	// fԂɕĕɃGR[hƂ̋Ԑi1ȉŕȂj
+	int numEncodeSegments;
 	int numEncodeBufferFrames;
+	// TS͂}bvœǂ
+	bool mmapInput;
+	// TS͂Xe[WƂɃXbhŕĕɍs
+	bool pipelinedSplit;
+	// TS͂̒ԃt@COS̃LbVʂɏ
+	bool unbufferedSplitOutput;
+	// AMTSourcẽt[LbVe(MB) 0Ȃ玩
+	int sourceCacheSize;
+	// AMTSource̐ǂ݃t[ 0Ȃǂ݂Ȃ
+	int sourceReadAhead;
 	// CM͗pݒ
 	std::vector<tstring> logoPath;
 	std::vector<tstring> eraseLogoPath;
@@ -556,6 +572,8 @@ struct Config {
 	int maxFadeLength;
 	tstring chapterExePath;
 	tstring chapterExeOptions;
+	// EV[`FW͂chapter_exeg킸ɃS͂ƈꏏɍs
+	bool internalChapterExe;
 	tstring joinLogoScpPath;
 	tstring joinLogoScpCmdPath;
 	tstring joinLogoScpOptions;
@@ -686,6 +704,10 @@ public:
 		return conf.twoPass;
 	}
 
+	int64_t getTwoPassFrameCacheBytes() const {
+		return (int64_t)conf.twoPassFrameCacheSize * 1024 * 1024;
+	}
+
 	bool isAutoBitrate() const {
 		return conf.autoBitrate;
 	}
@@ -738,10 +760,51 @@ public:
 		return conf.audioBitrateInKbps;
 	}
 
+	bool isParallelAudioEncode() const {
+		return conf.parallelAudioEncode;
+	}
+
+	int getNumEncodeSegments() const {
+		return conf.numEncodeSegments;
+	}
+
+	// ԕGR[h͏o͂̂܂ܘAłx264/x2651pX̂
+	// x264Ƀ^CR[hnꍇ͋ԂƂɕȂ̂őΏۊO
+	// tB^Ot̃_v͋ԂƂ̊ŏ㏑Ă܂̂őΏۊO
+	bool isSegmentedEncode(bool withTimecode) const {
+		if (conf.numEncodeSegments <= 1 || conf.twoPass || conf.dumpFilter) {
+			return false;
+		}
+		if (conf.encoder == ENCODER_X264) {
+			return !withTimecode;
+		}
+		return conf.encoder == ENCODER_X265;
+	}
+
 	int getNumEncodeBufferFrames() const {
 		return conf.numEncodeBufferFrames;
 	}
 
+	bool isMmapInput() const {
+		return conf.mmapInput;
+	}
+
+	bool isPipelinedSplit() const {
+		return conf.pipelinedSplit;
+	}
+
+	bool isUnbufferedSplitOutput() const {
+		return conf.unbufferedSplitOutput;
+	}
+
+	int getSourceCacheSize() const {
+		return conf.sourceCacheSize;
+	}
+
+	int getSourceReadAhead() const {
+		return conf.sourceReadAhead;
+	}
+
 	const std::vector<tstring>& getLogoPath() const {
 		return conf.logoPath;
 	}
@@ -790,6 +853,10 @@ public:
 		return conf.chapterExeOptions;
 	}
 
+	bool isInternalChapterExe() const {
+		return conf.internalChapterExe;
+	}
+
 	tstring getJoinLogoScpPath() const {
 		return conf.joinLogoScpPath;
 	}
@@ -867,6 +934,16 @@ public:
 			tmpDir.path(), key.video, key.format, key.div, GetCMSuffix(key.cm)));
 	}
 
+	tstring getEncFrameCachePath(EncodeFileKey key) const {
+		return regtmp(StringFormat(_T("%s/v%d-%d-%d%s.framecache.dat"),
+			tmpDir.path(), key.video, key.format, key.div, GetCMSuffix(key.cm)));
+	}
+
+	tstring getEncVideoSegmentFilePath(EncodeFileKey key, int segment) const {
+		return regtmp(StringFormat(_T("%s/v%d-%d-%d%s-s%d.raw"),
+			tmpDir.path(), key.video, key.format, key.div, GetCMSuffix(key.cm), segment));
+	}
+
 	tstring getAfsTimecodePath(EncodeFileKey key) const {
 		return regtmp(StringFormat(_T("%s/v%d-%d-%d%s.timecode.txt"),
 			tmpDir.path(), key.video, key.format, key.div, GetCMSuffix(key.cm)));
@@ -1179,6 +1256,21 @@ public:
 		else {
 			ctx.info("T[rXID: wȂ");
 		}
+		if (conf.pipelinedSplit) {
+			ctx.info("TS: pCvC");
+		}
+		else if (conf.mmapInput) {
+			ctx.info("TS: }bv");
+		}
+		if (conf.unbufferedSplitOutput) {
+			ctx.info("TS͏o: LbVȂ");
+		}
+		if (conf.sourceCacheSize > 0) {
+			ctx.infoF("\[XLbV: %dMB", conf.sourceCacheSize);
+		}
+		if (conf.sourceReadAhead > 0) {
+			ctx.infoF("\[Xǂ: %dt[", conf.sourceReadAhead);
+		}
 		ctx.infoF("fR[_: MPEG2:%s H264:%s",
 			decoderToString(conf.decoderSetting.mpeg2),
 			decoderToString(conf.decoderSetting.h264));
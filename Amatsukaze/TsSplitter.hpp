@@ -13,8 +13,12 @@
 #include <vector>
 #include <map>
 #include <array>
+#include <deque>
+#include <memory>
+#include <exception>
 
 #include "StreamUtils.hpp"
+#include "ProcessThread.hpp"
 #include "Mpeg2TsParser.hpp"
 #include "Mpeg2VideoParser.hpp"
 #include "H264VideoParser.hpp"
@@ -129,7 +133,9 @@ public:
 		int64_t DTS = packet.has_DTS() ? packet.DTS : PTS;
 		MemoryChunk payload = packet.paylod();
 
+		decodeTime.start();
 		adtsParser.inputFrame(payload, frameData, PTS);
+		ctx.addPerfCounter(AMT_PERF_AUDIO_DECODE, (int64_t)(decodeTime.current() * 1000000));
 
 		if (frameData.size() > 0) {
 			const AudioFrameData& frame = frameData[0];
@@ -154,6 +160,7 @@ private:
 	std::vector<AudioFrameData> frameData;
 
 	AdtsParser adtsParser;
+	Stopwatch decodeTime;
 };
 
 // ^̎̂ݑΉBX[p[ɂ͑ΉȂ
@@ -441,10 +448,51 @@ public:
 	void inputTsData(MemoryChunk data) {
 		tsPacketParser.inputTS(data);
 	}
+	// data͂̌Ăяo̊ԂLł΂悢iRs[Ȃj
+	void inputTsDataDirect(MemoryChunk data) {
+		tsPacketParser.inputTSDirect(data);
+	}
 	void flush() {
 		tsPacketParser.flush();
 	}
 
+	// pCvC͂Jn
+	// ȍ~̓͂inputTsDataPipelined()ōsAŌfinishPipeline()ĂԂ
+	void startPipeline() {
+		pipeline = std::unique_ptr<Pipeline>(new Pipeline(this));
+		tsPacketSelector.setHandler(&pipeline->selectorHandler);
+		pipeline->start();
+	}
+
+	// datȁL̓pCvCɈڂ
+	void inputTsDataPipelined(std::vector<uint8_t>&& data) {
+		pipeline->checkError();
+		size_t amount = data.size();
+		pipeline->demuxThread.put(std::move(data), amount);
+	}
+
+	// SXe[W̏҂
+	// Xe[WŃG[ꍇ͑SXbh~߂Ăŏ̃G[𓊂
+	void finishPipeline() {
+		pipeline->join();
+		tsPacketSelector.setHandler(this);
+		auto p = std::move(pipeline);
+		p->checkError();
+
+		// eXe[W͂҂Ă
+		double prod, demux, video, audio, output;
+		p->demuxThread.getTotalWait(prod, demux);
+		p->videoThread.getTotalWait(prod, video);
+		p->audioThread.getTotalWait(prod, audio);
+		p->outputThread.getTotalWait(prod, output);
+		ctx.infoF("TS̓pCvC ͑҂ U蕪: %.2fb f: %.2fb : %.2fb o: %.2fb",
+			demux, video, audio, output);
+		ctx.infoF("fR[h: %.2fb ( %.2fb %dXbh)",
+			ctx.getPerfCounter(AMT_PERF_AUDIO_DECODE) / 1000000.0,
+			ctx.getPerfCounter(AMT_PERF_AUDIO_DECODE_WALL) / 1000000.0,
+			p->audioDecodePool.getNumThreads());
+	}
+
 	int64_t getNumTotalPackets() const {
 		return numTotalPackets;
 	}
@@ -511,10 +559,18 @@ protected:
 				ctx.error("Video PES Packet ɃNbN񂪂܂");
 				return;
 			}
+			if (this_.pipeline != nullptr) {
+				this_.pipelineVideoPesPacket(clock, frames, packet);
+				return;
+			}
 			this_.onVideoPesPacket(clock, frames, packet);
 		}
 
 		virtual void onVideoFormatChanged(VideoFormat fmt) {
+			if (this_.pipeline != nullptr) {
+				this_.pipelineNewEvent(PIPE_VIDEO, PipelineEvent::VIDEO_FORMAT).videoFormat = fmt;
+				return;
+			}
 			this_.onVideoFormatChanged(fmt);
 		}
 	};
@@ -527,10 +583,19 @@ protected:
 
 	protected:
 		virtual void onAudioPesPacket(int64_t clock, const std::vector<AudioFrameData>& frames, PESPacket packet) {
+			if (this_.pipeline != nullptr) {
+				this_.pipelineAudioPesPacket(audioIdx, clock, frames, packet);
+				return;
+			}
 			this_.onAudioPesPacket(audioIdx, clock, frames, packet);
 		}
 
 		virtual void onAudioFormatChanged(AudioFormat fmt) {
+			if (this_.pipeline != nullptr) {
+				PipelineEvent& ev = this_.pipelineNewAudioEvent(audioIdx, PipelineEvent::AUDIO_FORMAT);
+				ev.audioFormat = fmt;
+				return;
+			}
 			this_.onAudioFormatChanged(audioIdx, fmt);
 		}
 	};
@@ -550,6 +615,606 @@ protected:
 		}
 	};
 
+	// pCvC //
+	// TSǂݍ -> TSpPbǵEU蕪 -> f/t[ -> o
+	// ̊eXe[WʃXbhŏB
+	// eXe[W̏o͂͐U蕪ɕtԍɕגĂ牼z֐ĂԂ̂
+	// Ăяo̓VAƊSɓɂȂiStreamReformInfo͂̏ɈˑĂjB
+	// DLL̏ԂgetDRCSOutPath()o͑Ɉˑ̂ŏo̓Xbhŉ͂B
+	// ̓Xg[ƂɃfR[_̏Ԃ̂ŁAXg[PʂŃ[J[ɕĕɉ͂A
+	// Xg[Ƃ̃CxgԍɃ}[WĂo͂ɗB
+
+	enum PIPELINE_SOURCE {
+		PIPE_VIDEO,
+		PIPE_AUDIO,
+		PIPE_DEMUX,
+		PIPE_NUM_SOURCES
+	};
+
+	// U蕪 -> f/
+	struct PipelinePacket {
+		int64_t seq;
+		int64_t clock;
+		int param; // pPbg: audioIdx : fstype or 
+		bool control;
+		size_t offset;
+	};
+
+	struct PipelinePacketBatch {
+		std::vector<PipelinePacket> packets;
+		std::vector<uint8_t> data;
+	};
+
+	// eXe[W -> o
+	struct PipelineEvent {
+		enum TYPE {
+			VIDEO_FORMAT,
+			VIDEO_PES,
+			AUDIO_FORMAT,
+			AUDIO_PES,
+			CAPTION_PACKET,
+			PID_TABLE,
+			TIME,
+		};
+		TYPE type;
+		int64_t seq;
+		int64_t clock;
+		int audioIdx;
+		VideoFormat videoFormat;
+		AudioFormat audioFormat;
+		JSTTime time;
+		PMTESInfo video, caption;
+		std::vector<PMTESInfo> audio;
+		std::vector<VideoFrameInfo> videoFrames;
+		std::vector<AudioFrameData> audioFrames;
+		std::vector<uint8_t> data; // PESpPbg or TSpPbg
+		std::vector<uint8_t> frameData; // t[f[^
+	};
+
+	// ̓`N1̏óBo̓Xbh͑SXe[W瑵̂҂ĕג
+	struct PipelineEventBatch {
+		PIPELINE_SOURCE source;
+		size_t bytes;
+		std::vector<PipelineEvent> events;
+	};
+
+	// TsPacketSelector̃R[obNU蕪XbhŎ󂯂ĊeXe[Wɗ
+	class PipelineSelectorHandler : public TsPacketSelectorHandler {
+		TsSplitter& this_;
+	public:
+		PipelineSelectorHandler(TsSplitter& this_)
+			: this_(this_) { }
+
+		virtual int onPidSelect(int TSID, const std::vector<int>& pids) {
+			return this_.onPidSelect(TSID, pids);
+		}
+
+		virtual void onPmtUpdated(int PcrPid) {
+			this_.onPmtUpdated(PcrPid);
+		}
+
+		virtual void onPidTableChanged(const PMTESInfo video, const std::vector<PMTESInfo>& audio, const PMTESInfo caption) {
+			if (this_.enableVideo || this_.enableAudio) {
+				// p[T̐ݒ̓pPbgƓŊeXe[Wɑ
+				this_.pipelinePushControl(PIPE_VIDEO, video.stype);
+				this_.pipelinePushControl(PIPE_AUDIO, (int)audio.size());
+			}
+			PipelineEvent& ev = this_.pipelineNewEvent(PIPE_DEMUX, PipelineEvent::PID_TABLE);
+			ev.video = video;
+			ev.audio = audio;
+			ev.caption = caption;
+		}
+
+		virtual void onVideoPacket(int64_t clock, TsPacket packet) {
+			if (this_.enableVideo && this_.checkScramble(packet)) {
+				this_.pipelinePushPacket(PIPE_VIDEO, clock, packet, 0);
+			}
+		}
+
+		virtual void onAudioPacket(int64_t clock, TsPacket packet, int audioIdx) {
+			if (this_.enableAudio && this_.checkScramble(packet)) {
+				this_.pipelinePushPacket(PIPE_AUDIO, clock, packet, audioIdx);
+			}
+		}
+
+		virtual void onCaptionPacket(int64_t clock, TsPacket packet) {
+			if (this_.enableCaption && this_.checkScramble(packet)) {
+				PipelineEvent& ev = this_.pipelineNewEvent(PIPE_DEMUX, PipelineEvent::CAPTION_PACKET);
+				ev.clock = clock;
+				ev.data.assign(packet.data, packet.data + TS_PACKET_LENGTH);
+			}
+		}
+
+		virtual void onTime(int64_t clock, JSTTime time) {
+			PipelineEvent& ev = this_.pipelineNewEvent(PIPE_DEMUX, PipelineEvent::TIME);
+			ev.clock = clock;
+			ev.time = time;
+		}
+	};
+
+	// U蕪ƉfẺ̓Xe[W͓͂Xbh1Ȃ̂ŃOobt@g
+	// o̓Xe[W͕̃Xe[W͂̂dequê܂
+	class PipelineDemuxThread : public DataPumpThread<std::vector<uint8_t>, true> {
+	public:
+		PipelineDemuxThread(TsSplitter* this_)
+			: DataPumpThread(16 * 1024 * 1024, 1024)
+			, this_(this_)
+		{ }
+	protected:
+		virtual void OnDataReceived(std::vector<uint8_t>&& data) {
+			try {
+				this_->pipelineDemux(std::move(data));
+			}
+			catch (const Exception&) {
+				this_->pipeline->setError(std::current_exception());
+				throw;
+			}
+		}
+	private:
+		TsSplitter* this_;
+	};
+
+	class PipelineParserThread : public DataPumpThread<std::unique_ptr<PipelinePacketBatch>, true> {
+	public:
+		PipelineParserThread(TsSplitter* this_, PIPELINE_SOURCE source)
+			: DataPumpThread(32 * 1024 * 1024, 1024)
+			, this_(this_)
+			, source(source)
+		{ }
+	protected:
+		virtual void OnDataReceived(std::unique_ptr<PipelinePacketBatch>&& data) {
+			try {
+				this_->pipelineParse(source, *data);
+			}
+			catch (const Exception&) {
+				this_->pipeline->setError(std::current_exception());
+				throw;
+			}
+		}
+	private:
+		TsSplitter* this_;
+		PIPELINE_SOURCE source;
+	};
+
+	class PipelineOutputThread : public DataPumpThread<std::unique_ptr<PipelineEventBatch>, true> {
+	public:
+		PipelineOutputThread(TsSplitter* this_)
+			: DataPumpThread(64 * 1024 * 1024)
+			, this_(this_)
+		{ }
+	protected:
+		virtual void OnDataReceived(std::unique_ptr<PipelineEventBatch>&& data) {
+			try {
+				this_->pipelineOutput(std::move(data));
+			}
+			catch (const Exception&) {
+				this_->pipeline->setError(std::current_exception());
+				throw;
+			}
+		}
+	private:
+		TsSplitter* this_;
+	};
+
+	struct Pipeline {
+		enum { MAX_PENDING_BYTES = 64 * 1024 * 1024 };
+
+		PipelineSelectorHandler selectorHandler;
+		PipelineDemuxThread demuxThread;
+		PipelineParserThread videoThread;
+		PipelineParserThread audioThread;
+		PipelineOutputThread outputThread;
+
+		// U蕪Xbĥ݃ANZX
+		int64_t seq;
+		std::unique_ptr<PipelinePacketBatch> packets[PIPE_DEMUX];
+
+		// [PIPE_DEMUX]͐U蕪XbhAȊO͊e̓Xbĥ݃ANZX
+		int64_t parsingSeq[PIPE_DEMUX];
+		std::unique_ptr<PipelineEventBatch> events[PIPE_NUM_SOURCES];
+
+		// Xg[Ƃ̃CxgieXg[̃[J[̂݃ANZXj
+		std::vector<int64_t> audioSeq;
+		std::vector<std::unique_ptr<PipelineEventBatch>> audioEvents;
+		// fR[h[J[
+		// ʏ̉͂łPESpPbgƂɂ̏ŃfR[hĉfƂ̏ۂĂ̂
+		// Xg[Ԃ̕fR[h̓pPbg܂Ƃ߂ĈpCvC͂ł̂ݍs
+		ParallelTaskPool audioDecodePool;
+
+		// o̓Xbĥ݃ANZX
+		std::deque<std::unique_ptr<PipelineEventBatch>> pending[PIPE_NUM_SOURCES];
+
+		// o̓XbhɓnĂpendingo܂ł̗ʁiXe[WƁj
+		// xXe[W҂Ԃɑ̃Xe[W̏o͂܂葱Ȃ悤ɂ
+		std::mutex pendingLock;
+		std::condition_variable pendingCond;
+		size_t pendingBytes[PIPE_NUM_SOURCES];
+
+		std::mutex errorLock;
+		std::exception_ptr error;
+
+		Pipeline(TsSplitter* this_)
+			: selectorHandler(*this_)
+			, demuxThread(this_)
+			, videoThread(this_, PIPE_VIDEO)
+			, audioThread(this_, PIPE_AUDIO)
+			, outputThread(this_)
+			, seq(0)
+			, parsingSeq()
+			, audioDecodePool(std::max(1, std::min(4, GetProcessorCount())))
+			, pendingBytes()
+		{
+			for (int i = 0; i < PIPE_DEMUX; ++i) {
+				packets[i] = std::unique_ptr<PipelinePacketBatch>(new PipelinePacketBatch());
+			}
+			for (int i = 0; i < PIPE_NUM_SOURCES; ++i) {
+				events[i] = newEventBatch((PIPELINE_SOURCE)i);
+			}
+		}
+
+		~Pipeline() {
+			join();
+		}
+
+		static std::unique_ptr<PipelineEventBatch> newEventBatch(PIPELINE_SOURCE source) {
+			auto batch = std::unique_ptr<PipelineEventBatch>(new PipelineEventBatch());
+			batch->source = source;
+			batch->bytes = 0;
+			return batch;
+		}
+
+		PipelineParserThread& parserThread(int source) {
+			return (source == PIPE_VIDEO) ? videoThread : audioThread;
+		}
+
+		void start() {
+			outputThread.start();
+			videoThread.start();
+			audioThread.start();
+			demuxThread.start();
+		}
+
+		// 㗬珇Ɏ~߂
+		void join() {
+			if (demuxThread.isRunning()) demuxThread.join();
+			if (videoThread.isRunning()) videoThread.join();
+			if (audioThread.isRunning()) audioThread.join();
+			if (outputThread.isRunning()) outputThread.join();
+		}
+
+		static size_t pendingAmount(const PipelineEventBatch& batch) {
+			return batch.bytes + sizeof(PipelineEventBatch);
+		}
+
+		// o̓Xbhɓn
+		// ̃Xe[W̏o͂܂Ăo̓Xbh܂ő҂
+		// o͂܂ĂȂXe[W͑҂Ȃ̂ŁAxXe[W~܂邱Ƃ͂Ȃ
+		void putOutput(std::unique_ptr<PipelineEventBatch>&& batch) {
+			int source = batch->source;
+			size_t amount = pendingAmount(*batch);
+			{
+				std::unique_lock<std::mutex> lock(pendingLock);
+				while (pendingBytes[source] >= MAX_PENDING_BYTES && !hasError()) {
+					pendingCond.wait(lock);
+				}
+				pendingBytes[source] += amount;
+			}
+			outputThread.put(std::move(batch), amount);
+		}
+
+		// o̓Xbhpendingo
+		void releaseOutput(const PipelineEventBatch& batch) {
+			std::lock_guard<std::mutex> lock(pendingLock);
+			pendingBytes[batch.source] -= pendingAmount(batch);
+			pendingCond.notify_all();
+		}
+
+		// ŏ̃G[c
+		void setError(std::exception_ptr e) {
+			{
+				std::lock_guard<std::mutex> lock(errorLock);
+				if (!error) {
+					error = e;
+				}
+			}
+			// o̓Xbh~܂pendingȂ̂ő҂ĂXe[WN
+			std::lock_guard<std::mutex> lock(pendingLock);
+			pendingCond.notify_all();
+		}
+
+		bool hasError() {
+			std::lock_guard<std::mutex> lock(errorLock);
+			return error != nullptr;
+		}
+
+		void checkError() {
+			std::exception_ptr e;
+			{
+				std::lock_guard<std::mutex> lock(errorLock);
+				e = error;
+			}
+			if (e) {
+				std::rethrow_exception(e);
+			}
+		}
+	};
+
+	// U蕪Xbh
+	void pipelineDemux(std::vector<uint8_t>&& data) {
+		inputTsDataDirect(MemoryChunk(data.data(), data.size()));
+
+		// ̃`N̕eXe[WɗiCxgȂĂj
+		Pipeline& p = *pipeline;
+		for (int i = 0; i < PIPE_DEMUX; ++i) {
+			auto& batch = p.packets[i];
+			size_t amount = batch->data.size() + batch->packets.size() * sizeof(PipelinePacket);
+			p.parserThread(i).put(std::move(batch), amount);
+			batch = std::unique_ptr<PipelinePacketBatch>(new PipelinePacketBatch());
+		}
+		auto& events = p.events[PIPE_DEMUX];
+		p.putOutput(std::move(events));
+		events = Pipeline::newEventBatch(PIPE_DEMUX);
+	}
+
+	void pipelinePushPacket(int source, int64_t clock, TsPacket packet, int param) {
+		PipelinePacketBatch& batch = *pipeline->packets[source];
+		PipelinePacket pkt = { pipeline->seq++, clock, param, false, batch.data.size() };
+		batch.packets.push_back(pkt);
+		batch.data.insert(batch.data.end(), packet.data, packet.data + TS_PACKET_LENGTH);
+	}
+
+	void pipelinePushControl(int source, int param) {
+		PipelinePacket pkt = { pipeline->seq++, -1, param, true, 0 };
+		pipeline->packets[source]->packets.push_back(pkt);
+	}
+
+	// f/̓Xbh
+	void pipelineParse(PIPELINE_SOURCE source, PipelinePacketBatch& batch) {
+		if (source == PIPE_AUDIO) {
+			pipelineParseAudio(batch);
+			return;
+		}
+		Pipeline& p = *pipeline;
+		for (const PipelinePacket& pkt : batch.packets) {
+			p.parsingSeq[source] = pkt.seq;
+			if (pkt.control) {
+				setVideoStreamType(pkt.param);
+			}
+			else {
+				TsPacket packet(batch.data.data() + pkt.offset);
+				packet.parse();
+				videoParser.onTsPacket(pkt.clock, packet);
+			}
+		}
+		auto& events = p.events[source];
+		p.putOutput(std::move(events));
+		events = Pipeline::newEventBatch(source);
+	}
+
+	// ̓Xbh
+	void pipelineParseAudio(PipelinePacketBatch& batch) {
+		Pipeline& p = *pipeline;
+		Stopwatch sw;
+		sw.start();
+		// pPbgŋ؂āÅԂXg[Ƃɕɏ
+		size_t begin = 0;
+		while (begin < batch.packets.size()) {
+			size_t end = begin;
+			while (end < batch.packets.size() && !batch.packets[end].control) {
+				++end;
+			}
+			if (end > begin) {
+				pipelineParseAudioPackets(batch, begin, end);
+			}
+			if (end < batch.packets.size()) {
+				prepareAudioParsers(batch.packets[end].param);
+				while (p.audioEvents.size() < audioParsers.size()) {
+					p.audioSeq.push_back(0);
+					p.audioEvents.push_back(Pipeline::newEventBatch(PIPE_AUDIO));
+				}
+				++end;
+			}
+			begin = end;
+		}
+		ctx.addPerfCounter(AMT_PERF_AUDIO_DECODE_WALL, (int64_t)(sw.current() * 1000000));
+
+		// Xg[Ƃ̃CxgԍɃ}[W
+		auto& events = p.events[PIPE_AUDIO];
+		std::vector<size_t> pos(p.audioEvents.size());
+		while (true) {
+			int next = -1;
+			for (int i = 0; i < (int)p.audioEvents.size(); ++i) {
+				const auto& streamEvents = p.audioEvents[i]->events;
+				if (pos[i] < streamEvents.size()) {
+					if (next == -1 || streamEvents[pos[i]].seq < p.audioEvents[next]->events[pos[next]].seq) {
+						next = i;
+					}
+				}
+			}
+			if (next == -1) break;
+			events->events.push_back(std::move(p.audioEvents[next]->events[pos[next]++]));
+		}
+		for (auto& streamEvents : p.audioEvents) {
+			events->bytes += streamEvents->bytes;
+			streamEvents->events.clear();
+			streamEvents->bytes = 0;
+		}
+
+		p.putOutput(std::move(events));
+		events = Pipeline::newEventBatch(PIPE_AUDIO);
+	}
+
+	void pipelineParseAudioStream(int audioIdx, const PipelinePacketBatch& batch, size_t begin, size_t end) {
+		Pipeline& p = *pipeline;
+		ASSERT(audioIdx < (int)audioParsers.size());
+		for (size_t i = begin; i < end; ++i) {
+			const PipelinePacket& pkt = batch.packets[i];
+			if (pkt.param == audioIdx) {
+				p.audioSeq[audioIdx] = pkt.seq;
+				TsPacket packet((uint8_t*)batch.data.data() + pkt.offset);
+				packet.parse();
+				audioParsers[audioIdx]->onTsPacket(pkt.clock, packet);
+			}
+		}
+	}
+
+	void pipelineParseAudioPackets(const PipelinePacketBatch& batch, size_t begin, size_t end) {
+		Pipeline& p = *pipeline;
+		std::vector<bool> hasPackets(audioParsers.size());
+		int numStreams = 0;
+		for (size_t i = begin; i < end; ++i) {
+			int audioIdx = batch.packets[i].param;
+			ASSERT(audioIdx < (int)audioParsers.size());
+			if (!hasPackets[audioIdx]) {
+				hasPackets[audioIdx] = true;
+				++numStreams;
+			}
+		}
+		if (numStreams <= 1 || p.audioDecodePool.getNumThreads() <= 1) {
+			// ɂӖȂ̂ł̃Xbhŏ
+			for (int i = 0; i < (int)hasPackets.size(); ++i) {
+				if (hasPackets[i]) {
+					pipelineParseAudioStream(i, batch, begin, end);
+				}
+			}
+			return;
+		}
+		std::vector<std::function<void()>> tasks;
+		for (int i = 0; i < (int)hasPackets.size(); ++i) {
+			if (hasPackets[i]) {
+				tasks.push_back([this, i, &batch, begin, end]() {
+					pipelineParseAudioStream(i, batch, begin, end);
+				});
+			}
+		}
+		p.audioDecodePool.runAll(tasks);
+	}
+
+	// U蕪Af̓XbhĂ΂
+	PipelineEvent& pipelineNewEvent(PIPELINE_SOURCE source, PipelineEvent::TYPE type) {
+		int64_t seq = (source == PIPE_DEMUX) ? pipeline->seq++ : pipeline->parsingSeq[source];
+		return pipelineNewEvent(*pipeline->events[source], seq, type);
+	}
+
+	// ͂̃[J[Ă΂
+	PipelineEvent& pipelineNewAudioEvent(int audioIdx, PipelineEvent::TYPE type) {
+		PipelineEvent& ev = pipelineNewEvent(*pipeline->audioEvents[audioIdx], pipeline->audioSeq[audioIdx], type);
+		ev.audioIdx = audioIdx;
+		return ev;
+	}
+
+	PipelineEvent& pipelineNewEvent(PipelineEventBatch& batch, int64_t seq, PipelineEvent::TYPE type) {
+		batch.events.emplace_back();
+		PipelineEvent& ev = batch.events.back();
+		ev.type = type;
+		ev.seq = seq;
+		batch.bytes += sizeof(PipelineEvent);
+		return ev;
+	}
+
+	void pipelineVideoPesPacket(int64_t clock, const std::vector<VideoFrameInfo>& frames, PESPacket packet) {
+		PipelineEvent& ev = pipelineNewEvent(PIPE_VIDEO, PipelineEvent::VIDEO_PES);
+		ev.clock = clock;
+		ev.videoFrames = frames;
+		ev.data.assign(packet.data, packet.data + packet.length);
+		pipeline->events[PIPE_VIDEO]->bytes += packet.length;
+	}
+
+	void pipelineAudioPesPacket(int audioIdx, int64_t clock, const std::vector<AudioFrameData>& frames, PESPacket packet) {
+		PipelineEvent& ev = pipelineNewAudioEvent(audioIdx, PipelineEvent::AUDIO_PES);
+		ev.clock = clock;
+		ev.audioFrames = frames;
+		ev.data.assign(packet.data, packet.data + packet.length);
+		// t[f[^̓p[T̃obt@wĂ̂ŃRs[
+		// i|C^͏o͎ɕtj
+		for (const AudioFrameData& frame : frames) {
+			ev.frameData.insert(ev.frameData.end(),
+				frame.codedData, frame.codedData + frame.codedDataSize);
+			if (frame.decodedDataSize > 0) {
+				const uint8_t* decoded = (const uint8_t*)frame.decodedData;
+				ev.frameData.insert(ev.frameData.end(), decoded, decoded + frame.decodedDataSize);
+			}
+		}
+		pipeline->audioEvents[audioIdx]->bytes += packet.length + ev.frameData.size();
+	}
+
+	// o̓Xbh
+	void pipelineOutput(std::unique_ptr<PipelineEventBatch>&& batch) {
+		Pipeline& p = *pipeline;
+		p.pending[batch->source].push_back(std::move(batch));
+		while (true) {
+			for (int i = 0; i < PIPE_NUM_SOURCES; ++i) {
+				if (p.pending[i].size() == 0) return;
+			}
+			// `ÑCxĝŔԍɃ}[Wďo
+			size_t pos[PIPE_NUM_SOURCES] = { 0 };
+			while (true) {
+				int next = -1;
+				for (int i = 0; i < PIPE_NUM_SOURCES; ++i) {
+					const auto& events = p.pending[i].front()->events;
+					if (pos[i] < events.size()) {
+						if (next == -1 || events[pos[i]].seq < p.pending[next].front()->events[pos[next]].seq) {
+							next = i;
+						}
+					}
+				}
+				if (next == -1) break;
+				pipelineApply(p.pending[next].front()->events[pos[next]++]);
+			}
+			for (int i = 0; i < PIPE_NUM_SOURCES; ++i) {
+				p.releaseOutput(*p.pending[i].front());
+				p.pending[i].pop_front();
+			}
+		}
+	}
+
+	void pipelineApply(PipelineEvent& ev) {
+		switch (ev.type) {
+		case PipelineEvent::VIDEO_FORMAT:
+			onVideoFormatChanged(ev.videoFormat);
+			break;
+		case PipelineEvent::VIDEO_PES: {
+			PESPacket packet(MemoryChunk(ev.data.data(), ev.data.size()));
+			packet.parse();
+			onVideoPesPacket(ev.clock, ev.videoFrames, packet);
+			break;
+		}
+		case PipelineEvent::AUDIO_FORMAT:
+			onAudioFormatChanged(ev.audioIdx, ev.audioFormat);
+			break;
+		case PipelineEvent::AUDIO_PES: {
+			uint8_t* ptr = ev.frameData.data();
+			for (AudioFrameData& frame : ev.audioFrames) {
+				frame.codedData = ptr;
+				ptr += frame.codedDataSize;
+				if (frame.decodedDataSize > 0) {
+					frame.decodedData = (uint16_t*)ptr;
+					ptr += frame.decodedDataSize;
+				}
+				else {
+					frame.decodedData = nullptr;
+				}
+			}
+			PESPacket packet(MemoryChunk(ev.data.data(), ev.data.size()));
+			packet.parse();
+			onAudioPesPacket(ev.audioIdx, ev.clock, ev.audioFrames, packet);
+			break;
+		}
+		case PipelineEvent::CAPTION_PACKET: {
+			TsPacket packet(ev.data.data());
+			packet.parse();
+			captionParser.onTsPacket(ev.clock, packet);
+			break;
+		}
+		case PipelineEvent::PID_TABLE:
+			onPidTableChanged(ev.video, ev.audio, ev.caption);
+			break;
+		case PipelineEvent::TIME:
+			onTime(ev.clock, ev.time);
+			break;
+		}
+	}
+
 	INITIALIZATION_PHASE initPhase;
 
 	TsPacketBuffer tsPacketParser;
@@ -571,6 +1236,9 @@ protected:
 	int64_t numTotalPackets;
 	int64_t numScramblePackets;
 
+	// 쒆̃Xbhp[TQƂ̂ōŌɐ錾iŏɔjj
+	std::unique_ptr<Pipeline> pipeline;
+
 	virtual void onVideoPesPacket(
 		int64_t clock,
 		const std::vector<VideoFrameInfo>& frames,
@@ -634,25 +1302,32 @@ protected:
 	}
 
 	// TsPacketSelectorPID TableύXꂽύX̏񂪑
+	// pCvC͂ł̓p[T̐ݒ͐U蕪ɍςł
 	virtual void onPidTableChanged(const PMTESInfo video, const std::vector<PMTESInfo>& audio, const PMTESInfo caption) {
-		if (enableVideo || enableAudio) {
-			// fXg[`Zbg
-			switch (video.stype) {
-			case 0x02: // MPEG2-VIDEO
-				videoParser.setStreamFormat(VS_MPEG2);
-				break;
-			case 0x1B: // H.264/AVC
-				videoParser.setStreamFormat(VS_H264);
-				break;
-			}
+		if (pipeline == nullptr && (enableVideo || enableAudio)) {
+			setVideoStreamType(video.stype);
+			prepareAudioParsers(audio.size());
+		}
+	}
 
-			// KvȐp[T
-			size_t numAudios = audio.size();
-			while (audioParsers.size() < numAudios) {
-				int audioIdx = int(audioParsers.size());
-				audioParsers.push_back(new SpAudioFrameParser(ctx, *this, audioIdx));
-				ctx.infoF("p[T %d ǉ", audioIdx);
-			}
+	// fXg[`Zbg
+	void setVideoStreamType(int stype) {
+		switch (stype) {
+		case 0x02: // MPEG2-VIDEO
+			videoParser.setStreamFormat(VS_MPEG2);
+			break;
+		case 0x1B: // H.264/AVC
+			videoParser.setStreamFormat(VS_H264);
+			break;
+		}
+	}
+
+	// KvȐp[T
+	void prepareAudioParsers(size_t numAudios) {
+		while (audioParsers.size() < numAudios) {
+			int audioIdx = int(audioParsers.size());
+			audioParsers.push_back(new SpAudioFrameParser(ctx, *this, audioIdx));
+			ctx.infoF("p[T %d ǉ", audioIdx);
 		}
 	}
 
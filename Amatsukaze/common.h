@@ -7,6 +7,8 @@
 */
 #pragma once
 
+// {̂WindowspBMSVCȊOłPOSIXSubProcessƂ̃eXggRpCł
+#ifdef _MSC_VER
 // ^[Qbg Windows Vista ɐݒ
 #define _WIN32_WINNT 0x0601 // _WIN32_WINNT_WIN7
 #include <SDKDDKVer.h>
@@ -15,6 +17,7 @@
 #define NOMINMAX
 // Windows wb_[ t@C:
 #include <windows.h>
+#endif
 
 #include <cstdint>
 #include <stdio.h>
@@ -23,7 +26,7 @@
 
 inline void assertion_failed(const char* line, const char* file, int lineNum) {
 	char buf[500];
-	sprintf_s(buf, "Assertion failed!! %s (%s:%d)", line, file, lineNum);
+	snprintf(buf, sizeof(buf), "Assertion failed!! %s (%s:%d)", line, file, lineNum);
 	PRINTF("%s\n", buf);
 	//MessageBox(NULL, "Error", "Amatsukaze", MB_OK);
 	throw buf;
@@ -35,6 +38,8 @@ inline void assertion_failed(const char* line, const char* file, int lineNum) {
 #define ASSERT(exp) do { if(!(exp)) assertion_failed(#exp, __FILE__, __LINE__); } while(0)
 #endif
 
+#ifdef _MSC_VER
+// GCC̑gݍ݂Ƃ͈Ⴂŏʃrbg̈ʒuԂiGCCł͒`łȂ̂MSVĈ݁j
 inline int __builtin_clzl(uint64_t mask) {
 	DWORD index;
 #ifdef _WIN64
@@ -52,3 +57,4 @@ inline int __builtin_clzl(uint64_t mask) {
 #endif
 	return index;
 }
+#endif
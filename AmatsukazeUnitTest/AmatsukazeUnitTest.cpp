@@ -8,6 +8,7 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include <string>
+#include <vector>
 #include <cmath>
 #include <memory>
 
@@ -124,6 +125,7 @@ protected:
 	std::wstring LargeTsFile;
 
 	void ParserTest(const std::wstring& filename, bool verify = true);
+	void PipelinedSplitTest(const std::wstring& filename);
 
 	void EncoderOptionTest(const wchar_t* option) {
 		printf("Option: %ls\n", option);
@@ -134,6 +136,18 @@ protected:
 		EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
 	}
 
+	// TS΂ŁAȂ΃eXgōf[^Ŏs
+	void OptionalInputTest(const wchar_t* mode, const std::wstring& filename) {
+		std::wstring srcfile = TestDataDir + L"\\" + filename + L".ts";
+		if (filename.size() == 0 || !fileExists(srcfile.c_str())) {
+			srcfile.clear();
+		}
+		const wchar_t* args[] = {
+			L"AmatsukazeTest.exe", L"--mode", mode, L"-i", srcfile.c_str()
+		};
+		EXPECT_EQ(AmatsukazeCLI(srcfile.size() ? LEN(args) : 3, args), 0);
+	}
+
 private:
 	void getParam(const std::wstring& inipath, const wchar_t* key, std::wstring& dst) {
 		wchar_t buf[200];
@@ -155,6 +169,12 @@ TEST(CRC, CheckCRC)
 	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
 }
 
+TEST(CRC, Performance)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_crc_perf" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
 TEST(Util, readOpt)
 {
 	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_read_bits" };
@@ -199,6 +219,25 @@ void TestBase::ParserTest(const std::wstring& filename, bool verify) {
 	//}
 }
 
+void TestBase::PipelinedSplitTest(const std::wstring& filename) {
+	std::wstring srcDir = TestDataDir + L"\\";
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	std::wstring srcfile = srcDir + filename + L".ts";
+
+	if (filename.size() == 0 || !fileExists(srcfile.c_str())) {
+		fprintf(stderr, "eXgt@CȂ̂ŃXLbv: %ls\n", srcfile.c_str());
+		return;
+	}
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_pipelined_split",
+		L"-i", srcfile.c_str(),
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
 TEST_F(TestBase, MPEG2Parser) {
 	ParserTest(MPEG2VideoTsFile);
 }
@@ -211,6 +250,21 @@ TEST_F(TestBase, H264Parser1Seg) {
 	ParserTest(OneSegVideoTsFile);
 }
 
+// NALjbg؂oȑOƓʂɂȂ邩
+TEST_F(TestBase, H264NalScanner) {
+	OptionalInputTest(L"test_h264_nal", H264VideoTsFile);
+}
+
+// BitReaderł̃XCXwb_͑x
+TEST_F(TestBase, BitReaderPerformance) {
+	OptionalInputTest(L"test_bitreader_perf", H264VideoTsFile);
+}
+
+// start codeTx
+TEST_F(TestBase, StartCodeSearchPerformance) {
+	OptionalInputTest(L"test_startcode_perf", MPEG2VideoTsFile);
+}
+
 TEST_F(TestBase, Pulldown) {
 	ParserTest(PullDownTsFile);
 }
@@ -280,6 +334,31 @@ TEST_F(TestBase, encodeMpeg2Test)
 	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
 }
 
+// ԕGR[h̘Aʂ̃t[ƃ^CX^v
+TEST_F(TestBase, SegmentedEncodeTest)
+{
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_segmented_encode",
+		L"-w", dstDir.c_str(),
+		L"-eo", L"--preset superfast --crf 23"
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+// 2pXpt[LbV̓ǂݏ
+TEST_F(TestBase, FrameCacheTest)
+{
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_frame_cache",
+		L"-w", dstDir.c_str()
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
 TEST_F(TestBase, fileStreamInfoTest)
 {
 	std::wstring srcDir = TestDataDir + L"\\";
@@ -346,6 +425,185 @@ TEST_F(TestBase, LogoFrameTest)
 	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
 }
 
+TEST(Logo, EvaluatePerformance)
+{
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_logo_eval",
+		L"--logo", L"logo\\SID410-1.lgd",
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(Logo, SlidingWindowFilter)
+{
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_sliding_window",
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(AMTSource, MergeFieldPerformance)
+{
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_mergefield_perf",
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(DataPumpThread, Performance)
+{
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_pump_perf",
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST_F(TestBase, ChapterExeInternal)
+{
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_chapter_exe",
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST_F(TestBase, FileCutterTs)
+{
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_filecutter",
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST_F(TestBase, AsyncFileWriter)
+{
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_async_writer",
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST_F(TestBase, TsPacketDirect)
+{
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_ts_direct",
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+// ʏƃpCvCTS͂œԃt@Cł邩
+TEST_F(TestBase, PipelinedSplit)
+{
+	PipelinedSplitTest(MPEG2VideoTsFile);
+	PipelinedSplitTest(H264VideoTsFile);
+	PipelinedSplitTest(PullDownTsFile);
+	PipelinedSplitTest(MultiAudioTsFile);
+}
+
+// BatchHashChecker.exeieXgƓfBNgɏo͂jsďIR[hԂ
+static int RunBatchHashChecker(const std::wstring& exepath, const std::wstring& args)
+{
+	// cmd.exeɓn̂őŜ""ň͂ށBDebugrh͍Ōɓ͑҂ɂȂ̂NULȂ
+	std::wstring cmd = L"\"\"" + exepath + L"\" " + args + L" < NUL\"";
+	return _wsystem(cmd.c_str());
+}
+
+static void WriteRandomFile(const std::wstring& path, size_t size, unsigned int seed)
+{
+	std::vector<char> data(size);
+	srand(seed);
+	for (size_t i = 0; i < size; ++i) {
+		data[i] = (char)rand();
+	}
+	FILE* fp = _wfopen(path.c_str(), L"wb");
+	ASSERT_TRUE(fp != nullptr);
+	fwrite(data.data(), 1, data.size(), fp);
+	fclose(fp);
+}
+
+// nbVXg̍s𐔂ic[nbV̍sƒʏ̍sAŌ̃Xĝ̃nbVs͏j
+static void CountHashEntries(const std::wstring& hashpath, int& numTree, int& numFlat)
+{
+	numTree = numFlat = 0;
+	FILE* fp = _wfopen(hashpath.c_str(), L"rb");
+	ASSERT_TRUE(fp != nullptr);
+	char line[2048];
+	while (fgets(line, sizeof(line), fp)) {
+		if (strstr(line, "  ") == nullptr) continue; // Xg̃nbV
+		if (line[0] == '@') ++numTree;
+		else ++numFlat;
+	}
+	fclose(fp);
+}
+
+TEST_F(TestBase, BatchHashCheckerTree)
+{
+	wchar_t buf[MAX_PATH];
+	GetModuleFileNameW(nullptr, buf, MAX_PATH);
+	std::wstring exepath = buf;
+	exepath = exepath.substr(0, exepath.rfind(L'\\')) + L"\\BatchHashChecker.exe";
+	if (!fileExists(exepath.c_str())) {
+		printf("BatchHashChecker.exeȂ̂ŃXLbv: %ls\n", exepath.c_str());
+		return;
+	}
+
+	std::wstring dir = TestWorkDir + L"\\hashtree";
+	std::wstring hashpath = dir + L".hash";
+	std::wstring quoted = L"\"" + dir + L"\"";
+	CreateDirectoryW(dir.c_str(), NULL);
+
+	// 1MB`NŕȂt@CA傤2`NA`N{[
+	const size_t sizes[] = { 1000, 2 * 1024 * 1024, 5 * 1024 * 1024 + 12345 };
+	std::wstring files[LEN(sizes)];
+	for (int i = 0; i < (int)LEN(sizes); ++i) {
+		files[i] = dir + L"\\file" + std::to_wstring(i) + L".bin";
+		WriteRandomFile(files[i], sizes[i], i);
+	}
+
+	int numTree, numFlat;
+
+	// c[ƒʏ̃GgXg
+	// c[̃Gg-jȂłŃ`FbN
+	ASSERT_EQ(RunBatchHashChecker(exepath, L"m -t 1M -j 4 " + quoted), 0);
+	CountHashEntries(hashpath, numTree, numFlat);
+	EXPECT_EQ(numTree, 2);
+	EXPECT_EQ(numFlat, 1);
+	EXPECT_EQ(RunBatchHashChecker(exepath, L"c -j 4 " + quoted), 0);
+	EXPECT_EQ(RunBatchHashChecker(exepath, L"c " + quoted), 0);
+	EXPECT_EQ(RunBatchHashChecker(exepath, L"hc " + quoted), 0);
+
+	// Ō̃`Ni[j猟o邱
+	WriteRandomFile(files[2], sizes[2], 100);
+	EXPECT_NE(RunBatchHashChecker(exepath, L"c -j 4 " + quoted), 0);
+	WriteRandomFile(files[2], sizes[2], 2);
+
+	// sȃIvV͐ɂȂ
+	EXPECT_NE(RunBatchHashChecker(exepath, L"m -t 3M " + quoted), 0);
+	EXPECT_NE(RunBatchHashChecker(exepath, L"m -j -1 " + quoted), 0);
+	EXPECT_NE(RunBatchHashChecker(exepath, L"m -x 1 " + quoted), 0);
+
+	// ʏ̃Xg-jȂŃ`FbN
+	ASSERT_EQ(RunBatchHashChecker(exepath, L"m " + quoted), 0);
+	CountHashEntries(hashpath, numTree, numFlat);
+	EXPECT_EQ(numTree, 0);
+	EXPECT_EQ(numFlat, 3);
+	EXPECT_EQ(RunBatchHashChecker(exepath, L"c -j 4 " + quoted), 0);
+	EXPECT_EQ(RunBatchHashChecker(exepath, L"c " + quoted), 0);
+	WriteRandomFile(files[1], sizes[1], 100);
+	EXPECT_NE(RunBatchHashChecker(exepath, L"c -j 4 " + quoted), 0);
+}
+
 TEST_F(TestBase, SplitDualMonoAAC)
 {
 	std::wstring srcDir = TestDataDir + L"\\";
@@ -360,6 +618,20 @@ TEST_F(TestBase, SplitDualMonoAAC)
 	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
 }
 
+TEST_F(TestBase, SplitDualMonoParseOnly)
+{
+	std::wstring srcDir = TestDataDir + L"\\";
+	std::wstring dstDir = TestWorkDir + L"\\";
+	std::wstring inaac = srcDir + L"dualmono.aac";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_dualmono_parse",
+		L"-i", inaac.c_str(),
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
 TEST_F(TestBase, AACDecodeTest)
 {
 	std::wstring srcDir = TestDataDir + L"\\";
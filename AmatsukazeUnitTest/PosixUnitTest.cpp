@@ -0,0 +1,462 @@
+/**
+* Amtasukaze Unit Test for POSIX
+* Copyright (c) 2017-2019 Nekopanda
+*
+* This software is released under the MIT License.
+* http://opensource.org/licenses/mit-license.php
+*/
+
+// POSIX̃eXgiCMakeLists.txtŃrhj
+// {̂̃eXgWindowspAmatsukazeUnitTest.cpp
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "gtest/gtest.h"
+
+#include "PosixSubProcess.hpp"
+#include "blockhash.hpp"
+#include "../FileCutter/FileCutter.hpp"
+
+// Process Test
+
+// stdoutʃXbhőSǂށiݑƓɓǂ܂ȂƃpCvl܂j
+class OutputReader
+{
+public:
+	OutputReader(SubProcess& process)
+		: thread_([this, &process]() {
+			std::vector<uint8_t> buffer(64 * 1024);
+			while (true) {
+				size_t bytesRead = process.readOut(MemoryChunk(buffer.data(), buffer.size()));
+				if (bytesRead == 0) break;
+				out_.insert(out_.end(), buffer.begin(), buffer.begin() + bytesRead);
+			}
+		})
+	{ }
+	const std::vector<uint8_t>& join() {
+		thread_.join();
+		return out_;
+	}
+private:
+	std::vector<uint8_t> out_;
+	std::thread thread_;
+};
+
+TEST(PosixSubProcess, WritevStridedFrames)
+{
+	// pfBÔ1080p̃t[sƂɓniY4MWriterƓnj
+	const int width = 1920, height = 1080, pitch = 2048;
+	std::vector<uint8_t> frame(pitch * height * 3 / 2);
+	for (size_t i = 0; i < frame.size(); ++i) {
+		frame[i] = (uint8_t)(i * 7 + (i >> 11));
+	}
+	const int numFrames = 20;
+
+	SubProcess process("cat");
+	OutputReader reader(process);
+	std::vector<uint8_t> expected;
+	std::vector<MemoryChunk> chunks;
+	for (int f = 0; f < numFrames; ++f) {
+		frame[f] = (uint8_t)f;
+		chunks.clear();
+		for (int y = 0; y < height * 3 / 2; ++y) {
+			uint8_t* row = frame.data() + y * pitch;
+			chunks.push_back(MemoryChunk(row, width));
+			expected.insert(expected.end(), row, row + width);
+		}
+		process.writev(chunks.data(), (int)chunks.size());
+	}
+	process.finishWrite();
+	const auto& out = reader.join();
+	EXPECT_EQ(process.join(), 0);
+	ASSERT_EQ(out.size(), expected.size());
+	EXPECT_TRUE(out == expected);
+}
+
+TEST(PosixSubProcess, QuotedArguments)
+{
+	SubProcess process("printf \"[%s]\" \"a b\" x\\\"y \"\"");
+	OutputReader reader(process);
+	process.finishWrite();
+	const auto& out = reader.join();
+	EXPECT_EQ(process.join(), 0);
+	EXPECT_EQ(std::string(out.begin(), out.end()), "[a b][x\"y][]");
+}
+
+TEST(PosixSubProcess, ExitCode)
+{
+	SubProcess process("sh -c \"exit 3\"");
+	process.finishWrite();
+	EXPECT_EQ(process.join(), 3);
+
+	// VOiŏIƂ128+VOiԍ
+	SubProcess killed("sh -c \"kill -9 $$\"");
+	killed.finishWrite();
+	EXPECT_EQ(killed.join(), 128 + 9);
+}
+
+TEST(PosixSubProcess, WriteAfterChildExit)
+{
+	// pCv̗eʂ葽̂ŁAqvZXǂ܂ɏIKG[ɂȂ
+	SubProcess process("true");
+	std::vector<uint8_t> data(4 * 1024 * 1024);
+	EXPECT_THROW(process.write(MemoryChunk(data.data(), data.size())), RuntimeException);
+}
+
+TEST(PosixSubProcess, MissingExecutable)
+{
+	EXPECT_THROW(SubProcess("amatsukaze-no-such-command"), RuntimeException);
+}
+
+// BatchHashChecker Test
+
+// BatchHashCheckerTreeƓt@CŁAvZiblockhash.hppjmF
+class BlockHashTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp() {
+		// tmpfsO_DIRECTgȂ̂ŃfBXNɍ
+		char tmpl[] = "/var/tmp/amt-hashtree-XXXXXX";
+		ASSERT_TRUE(mkdtemp(tmpl) != nullptr);
+		dir = tmpl;
+	}
+	virtual void TearDown() {
+		for (auto& path : created) {
+			remove(path.c_str());
+		}
+		rmdir(dir.c_str());
+	}
+
+	std::string WriteRandomFile(const std::string& name, size_t size, unsigned int seed) {
+		std::vector<char> data(size);
+		srand(seed);
+		for (size_t i = 0; i < size; ++i) {
+			data[i] = (char)rand();
+		}
+		std::string path = dir + "/" + name;
+		FILE* fp = fopen(path.c_str(), "wb");
+		EXPECT_TRUE(fp != nullptr);
+		if (fp != nullptr) {
+			fwrite(data.data(), 1, data.size(), fp);
+			fclose(fp);
+		}
+		created.push_back(path);
+		return path;
+	}
+
+	// nbVXg쐬iexpectedȂj`FbNiexpectedjƓĂѕŌvZ
+	std::vector<std::unique_ptr<hashchecker::HashJob>> HashFiles(
+		const std::vector<std::string>& files, const std::vector<size_t>& sizes,
+		int treeShift, int numThreads, size_t blocksize,
+		const std::vector<std::vector<uint8_t>>* expected = nullptr)
+	{
+		std::vector<std::unique_ptr<hashchecker::HashJob>> jobs;
+		for (int i = 0; i < (int)files.size(); ++i) {
+			std::wstring path(files[i].begin(), files[i].end());
+			int shift = hashchecker::TreeShiftForFile(sizes[i], treeShift);
+			jobs.emplace_back(new hashchecker::HashJob(path.c_str(), (int)dir.size() + 1, sizes[i], shift,
+				expected ? (*expected)[i].data() : nullptr));
+		}
+		size_t progress = 0;
+		int completed = 0;
+		hashchecker::HashParallel(jobs, numThreads, 4096, blocksize,
+			[&](size_t readByte) { progress += readByte; },
+			[&](hashchecker::HashJob&) { ++completed; });
+		EXPECT_EQ(completed, (int)jobs.size());
+		size_t total = 0;
+		for (auto& job : jobs) {
+			if (!job->error) total += job->filesize;
+		}
+		EXPECT_EQ(progress, total);
+		return jobs;
+	}
+
+	static std::vector<uint8_t> Sha512(const uint8_t* prefix, const std::vector<uint8_t>& data, size_t offset, size_t length) {
+		std::vector<uint8_t> hash(SHA512_DIGEST_LENGTH);
+		SHA512_CTX ctx;
+		SHA512_Init(&ctx);
+		if (prefix) SHA512_Update(&ctx, prefix, 1);
+		SHA512_Update(&ctx, data.data() + offset, length);
+		SHA512_Final(hash.data(), &ctx);
+		return hash;
+	}
+
+	static std::vector<uint8_t> ReadAll(const std::string& path) {
+		std::vector<uint8_t> data;
+		FILE* fp = fopen(path.c_str(), "rb");
+		if (fp == nullptr) return data;
+		uint8_t buf[64 * 1024];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+			data.insert(data.end(), buf, buf + n);
+		}
+		fclose(fp);
+		return data;
+	}
+
+	// t0x00A߂0x01tnbVi̂Ƃ͍Ō̂܂܏グj
+	static std::vector<uint8_t> ReferenceTree(const std::vector<uint8_t>& data, int shift) {
+		const uint8_t leafPrefix = 0x00, nodePrefix = 0x01;
+		size_t chunk = size_t(1) << shift;
+		std::vector<std::vector<uint8_t>> level;
+		for (size_t pos = 0; pos < data.size(); pos += chunk) {
+			level.push_back(Sha512(&leafPrefix, data, pos, std::min(chunk, data.size() - pos)));
+		}
+		while (level.size() > 1) {
+			std::vector<std::vector<uint8_t>> next;
+			for (size_t i = 0; i < level.size(); i += 2) {
+				if (i + 1 < level.size()) {
+					std::vector<uint8_t> pair = level[i];
+					pair.insert(pair.end(), level[i + 1].begin(), level[i + 1].end());
+					next.push_back(Sha512(&nodePrefix, pair, 0, pair.size()));
+				}
+				else {
+					next.push_back(level[i]);
+				}
+			}
+			level.swap(next);
+		}
+		return level[0];
+	}
+
+	static std::vector<uint8_t> HashOf(const hashchecker::HashJob& job) {
+		return std::vector<uint8_t>(job.hash, job.hash + HASH_LENGTH);
+	}
+
+	std::string dir;
+	std::vector<std::string> created;
+};
+
+TEST_F(BlockHashTest, TreeAndFlat)
+{
+	// 1MB`NŕȂt@CA傤2`NA`N{[
+	const std::vector<size_t> sizes = { 1000, 2 * 1024 * 1024, 5 * 1024 * 1024 + 12345 };
+	std::vector<std::string> files;
+	for (int i = 0; i < (int)sizes.size(); ++i) {
+		files.push_back(WriteRandomFile("file" + std::to_string(i) + ".bin", sizes[i], i));
+	}
+
+	// c[ƒʏ̃GgXg
+	auto made = HashFiles(files, sizes, 20, 4, 0);
+	std::vector<std::vector<uint8_t>> hashes;
+	for (int i = 0; i < (int)files.size(); ++i) {
+		ASSERT_FALSE(made[i]->error);
+		EXPECT_EQ(made[i]->treeShift, (i == 0) ? 0 : 20);
+		auto data = ReadAll(files[i]);
+		EXPECT_TRUE(HashOf(*made[i]) == (made[i]->treeShift
+			? ReferenceTree(data, 20) : Sha512(nullptr, data, 0, data.size())));
+		hashes.push_back(HashOf(*made[i]));
+	}
+
+	// Xbhobt@TCYςĂnbVɂȂ邱
+	for (int threads : { 1, 4, 0 }) {
+		auto checked = HashFiles(files, sizes, 20, threads, 64 * 1024, &hashes);
+		for (auto& job : checked) {
+			ASSERT_FALSE(job->error);
+			EXPECT_EQ(memcmp(job->expected, job->hash, HASH_LENGTH), 0);
+		}
+	}
+
+	// Ō̃`Ni[j猟o邱
+	{
+		auto data = ReadAll(files[2]);
+		data[data.size() - 1] ^= 0xFF;
+		FILE* fp = fopen(files[2].c_str(), "wb");
+		ASSERT_TRUE(fp != nullptr);
+		fwrite(data.data(), 1, data.size(), fp);
+		fclose(fp);
+		auto checked = HashFiles(files, sizes, 20, 4, 0, &hashes);
+		EXPECT_EQ(memcmp(checked[0]->expected, checked[0]->hash, HASH_LENGTH), 0);
+		EXPECT_EQ(memcmp(checked[1]->expected, checked[1]->hash, HASH_LENGTH), 0);
+		EXPECT_NE(memcmp(checked[2]->expected, checked[2]->hash, HASH_LENGTH), 0);
+		WriteRandomFile("file2.bin", sizes[2], 2);
+	}
+
+	// ʏ̃Xg񂠂ȂŌvZ
+	auto flat = HashFiles(files, sizes, 0, 4, 0);
+	auto serial = HashFiles(files, sizes, 0, 1, 0);
+	for (int i = 0; i < (int)files.size(); ++i) {
+		EXPECT_EQ(flat[i]->treeShift, 0);
+		auto data = ReadAll(files[i]);
+		EXPECT_TRUE(HashOf(*flat[i]) == Sha512(nullptr, data, 0, data.size()));
+		EXPECT_TRUE(HashOf(*serial[i]) == HashOf(*flat[i]));
+	}
+}
+
+TEST_F(BlockHashTest, MissingFile)
+{
+	// JȂt@C͂̃t@CG[ɂȂāA͌vZ邱
+	std::vector<std::string> files = { dir + "/nothing.bin", WriteRandomFile("file.bin", 3 * 1024 * 1024, 7) };
+	std::vector<size_t> sizes = { 3 * 1024 * 1024, 3 * 1024 * 1024 };
+	auto jobs = HashFiles(files, sizes, 20, 4, 0);
+	EXPECT_TRUE(jobs[0]->error);
+	EXPECT_FALSE(jobs[1]->error);
+	EXPECT_TRUE(HashOf(*jobs[1]) == ReferenceTree(ReadAll(files[1]), 20));
+}
+
+// FileCutter Test
+
+// test_filecutteriAmatsukazeTestImpl.hppFileCutterTsjƓTS
+// copy_file_range/reflinkgLinux̃Rs[oHmF
+class FileCutterTest : public ::testing::Test
+{
+protected:
+	virtual void TearDown() {
+		for (auto& path : created) {
+			remove(path.c_str());
+		}
+	}
+
+	std::string TempPath(const char* dir, const char* name) {
+		std::string path = std::string(dir) + "/amt-filecutter-" + std::to_string(getpid()) + "-" + name;
+		created.push_back(path);
+		return path;
+	}
+
+	// 擪ƓrɃS~ioCgȂjꂽTS
+	static std::vector<uint8_t> MakeTs(int packetSize, int numPackets, std::vector<int64_t>& packetPos) {
+		std::vector<uint8_t> ts;
+		auto addGarbage = [&](int n) {
+			for (int i = 0; i < n; ++i) {
+				uint8_t b = uint8_t(rand());
+				ts.push_back((b == 0x47) ? 0 : b);
+			}
+		};
+		addGarbage(100);
+		for (int i = 0; i < numPackets; ++i) {
+			if (i == numPackets / 2) addGarbage(50);
+			packetPos.push_back(ts.size());
+			if (packetSize == 192) {
+				for (int s = 24; s >= 0; s -= 8) ts.push_back(uint8_t(i >> s));
+			}
+			ts.push_back(0x47);
+			for (int k = 1; k < 188; ++k) {
+				uint8_t b = uint8_t(rand());
+				ts.push_back((b == 0x47) ? 0 : b);
+			}
+		}
+		return ts;
+	}
+
+	static void WriteAll(const std::string& path, const std::vector<uint8_t>& data) {
+		FILE* fp = fopen(path.c_str(), "wb");
+		ASSERT_TRUE(fp != nullptr);
+		fwrite(data.data(), 1, data.size(), fp);
+		fclose(fp);
+	}
+
+	static std::vector<uint8_t> ReadAll(const std::string& path) {
+		std::vector<uint8_t> data;
+		FILE* fp = fopen(path.c_str(), "rb");
+		if (fp == nullptr) return data;
+		uint8_t buf[64 * 1024];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+			data.insert(data.end(), buf, buf + n);
+		}
+		fclose(fp);
+		return data;
+	}
+
+	// ͈͂؂oҒlisnapȂstart܂ރpPbg̐擪Aend܂ރpPbg̏I[ɍLj
+	static std::vector<uint8_t> Expected(const std::vector<uint8_t>& ts, const std::vector<int64_t>& packetPos,
+		int packetSize, bool snap, const std::vector<filecutter::CutRange>& ranges)
+	{
+		const int64_t fileSize = ts.size();
+		std::vector<uint8_t> expected;
+		for (auto r : ranges) {
+			int64_t start = r.from;
+			int64_t end = (r.length < 0) ? fileSize : std::min(fileSize, r.from + r.length);
+			if (snap) {
+				auto it = std::upper_bound(packetPos.begin(), packetPos.end(), start);
+				start = (it == packetPos.begin()) ? packetPos.front() : *(it - 1);
+				int64_t snappedEnd = packetPos.back() + packetSize;
+				for (int64_t pos : packetPos) {
+					if (pos + packetSize >= end) {
+						snappedEnd = pos + packetSize;
+						break;
+					}
+				}
+				end = std::max(start, snappedEnd);
+			}
+			expected.insert(expected.end(), ts.begin() + start, ts.begin() + end);
+		}
+		return expected;
+	}
+
+	// _Ȕ͈͂Ő؂oĊҒlƔׂ Rs[@Ƃ̃oCg𑫂Ă
+	void CutRandomRanges(const std::string& srcpath, const std::string& dstpath, filecutter::CopyStats& total) {
+		const int numPackets = 30000; // 4MB̃Rs[obt@ׂ傫
+		srand(0);
+		for (int packetSize : { 188, 192 }) {
+			std::vector<int64_t> packetPos;
+			auto ts = MakeTs(packetSize, numPackets, packetPos);
+			WriteAll(srcpath, ts);
+			const int64_t fileSize = ts.size();
+
+			for (int snap = 0; snap < 2; ++snap) {
+				for (int trial = 0; trial < 20; ++trial) {
+					std::vector<filecutter::CutRange> ranges;
+					int numRanges = rand() % 3 + 1;
+					for (int i = 0; i < numRanges; ++i) {
+						int64_t from = (((int64_t)rand() << 15) ^ rand()) % fileSize;
+						int64_t length = (trial == 0) ? -1 : (((int64_t)rand() << 15) ^ rand()) % (fileSize / 2) + 1;
+						ranges.push_back(filecutter::CutRange{ from, length });
+					}
+					auto expected = Expected(ts, packetPos, packetSize, snap != 0, ranges);
+
+					filecutter::FileCutter cutter;
+					ASSERT_TRUE(cutter.open(srcpath.c_str(), dstpath.c_str()));
+					if (snap) {
+						ASSERT_TRUE(cutter.snapToTsPackets(ranges));
+						ASSERT_EQ(cutter.getTsFormat().packetSize, packetSize);
+					}
+					ASSERT_TRUE(cutter.cut(ranges));
+
+					const auto& stats = cutter.getStats();
+					EXPECT_EQ(stats.cloned + stats.kernel + stats.buffered, (int64_t)expected.size());
+					total.cloned += stats.cloned;
+					total.kernel += stats.kernel;
+					total.buffered += stats.buffered;
+
+					auto out = ReadAll(dstpath);
+					ASSERT_EQ(out.size(), expected.size()) << "packetSize=" << packetSize << ",snap=" << snap << ",trial=" << trial;
+					EXPECT_TRUE(out == expected) << "packetSize=" << packetSize << ",snap=" << snap << ",trial=" << trial;
+				}
+			}
+		}
+	}
+
+	std::vector<std::string> created;
+};
+
+TEST_F(FileCutterTest, RangesAndTsSnap)
+{
+	// t@CVXeȂcopy_file_rangeiΉĂreflinkjŃRs[
+	filecutter::CopyStats total = {};
+	CutRandomRanges(TempPath("/var/tmp", "src.ts"), TempPath("/var/tmp", "dst.ts"), total);
+	EXPECT_GT(total.cloned + total.kernel, 0);
+}
+
+TEST_F(FileCutterTest, CrossFilesystemFallback)
+{
+	// tmpfsfBXNւ̃Rs[copy_file_rangeEXDEVŎŝŃobt@oRɐ؂ւ
+	struct stat shm, disk;
+	if (stat("/dev/shm", &shm) != 0 || stat("/var/tmp", &disk) != 0 || shm.st_dev == disk.st_dev) {
+		GTEST_SKIP() << "/dev/shm and /var/tmp are not on different filesystems";
+	}
+	filecutter::CopyStats total = {};
+	CutRandomRanges(TempPath("/dev/shm", "src.ts"), TempPath("/var/tmp", "dst.ts"), total);
+	if (total.kernel > 0) {
+		// 5.35.18̃J[l̓t@CVXeׂłcopy_file_rangeł
+		GTEST_SKIP() << "this kernel copies across filesystems with copy_file_range";
+	}
+	EXPECT_EQ(total.cloned, 0);
+	EXPECT_GT(total.buffered, 0);
+}
@@ -187,7 +187,7 @@ using namespace hashchecker;
 
 void PrintHelp()
 {
-	wprintf(L"Batch Hash Checker version 1.2.0\n"
+	wprintf(L"Batch Hash Checker version 1.3.0\n"
 		L"R}h: BatchHashChecker.exe [m|c|hc|hu] [IvV] tH_ւ̃pX\n"
 		L"\n"
 		L"m : nbVXg쐬EXV܂\n"
@@ -199,6 +199,9 @@ void PrintHelp()
 		L"IvV\n"
 		L"-hl (filepath) : nbVXg̃t@CI\n"
 		L"-rb ubNTCY : PReadFileœǂݎf[^ʁiG,M,KTtBbNXΉj\n"
+		L"-j Xbh : t@CɃnbVvZi0CPUAftHg1j\n"
+		L"-t `NTCY : 傫t@C̓`NɕĕɌvZ\n"
+		L"                    c[nbVƂĕۑim̂݁A2̗ݏ1Mȏj\n"
 		L"\n"
 		L")\n"
 		L"BatchHashChecker.exe m D:\\MyFolder\n"
@@ -206,6 +209,8 @@ void PrintHelp()
 		L"\n"
 		L"BatchHashChecker.exe c D:\\MyFolder\n"
 		L" -> D:\\MyFolder.hash nbVǂݎ D:\\MyFolder ȉׂẴt@Cv邩`FbN\n"
+		L"\n"
+		L"m,c,hcŃG[ꍇƈsȏꍇ͏IR[h1Ԃ܂\n"
 		);
 }
 
@@ -213,6 +218,8 @@ typedef struct InputCommand
 {
 	enum { MAKE_HASH, CHECK_HASH, BENCHMARK, HASH_FILE_CHECK, HASH_FILE_UPDATE } mode;
 	DWORD blocksize;
+	int threads;
+	int treeShift;
 	wchar_t path[MAX_PATH];
 	wchar_t hashpath[MAX_PATH];
 } InputCommand;
@@ -238,9 +245,38 @@ wchar_t* ConverToAbsolutePath(wchar_t* path)
 	return file;
 }
 
+__int64 ParseSize(LPCWSTR str)
+{
+	__int64 unit = 1;
+	int len = (int)wcslen(str);
+	wchar_t suffix = str[len-1];
+	if(suffix >= '0' && suffix <= '9') {
+	}
+	else {
+		switch(suffix) {
+		case 'm':
+		case 'M':
+			unit = 1024*1024;
+			break;
+		case 'k':
+		case 'K':
+			unit = 1024;
+			break;
+		case 'g':
+		case 'G':
+			unit = 1024*1024*1024;
+			break;
+		default:
+			throw L"sȃTCYwł";
+		}
+	}
+	return _wtoi64(str) * unit;
+}
+
 void ParseCommand(int argc, _TCHAR* argv[], InputCommand* cmd)
 {
 	memset(cmd, 0x00, sizeof(InputCommand));
+	cmd->threads = 1;
 
 	if( argc < 3 ){
 		throw L"R}hȂ܂";
@@ -281,30 +317,23 @@ void ParseCommand(int argc, _TCHAR* argv[], InputCommand* cmd)
 			wcscpy_s(cmd->hashpath, optionStr2);
 		}
 		else if( wcscmp(optionStr1, L"-rb") == 0 ){
-			DWORD unit = 1;
-			int len = (int)wcslen(optionStr2);
-			wchar_t suffix = optionStr2[len-1];
-			if(suffix >= '0' && suffix <= '9') {
+			cmd->blocksize = (DWORD)ParseSize(optionStr2);
+		}
+		else if( wcscmp(optionStr1, L"-j") == 0 ){
+			cmd->threads = _wtoi(optionStr2);
+			if( cmd->threads < 0 ){
+				throw L"Xbhsł";
 			}
-			else {
-				switch(suffix) {
-				case 'm':
-				case 'M':
-					unit = 1024*1024;
-					break;
-				case 'k':
-				case 'K':
-					unit = 1024;
-					break;
-				case 'g':
-				case 'G':
-					unit = 1024*1024*1024;
-					break;
-				default:
-					throw L"sȃTCYwł";
-				}
+		}
+		else if( wcscmp(optionStr1, L"-t") == 0 ){
+			__int64 chunkSize = ParseSize(optionStr2);
+			int shift = 0;
+			while( (__int64(1) << shift) < chunkSize ) shift++;
+			if( (__int64(1) << shift) != chunkSize ||
+				shift < FileHashList::MinTreeShift || shift > FileHashList::MaxTreeShift ){
+				throw L"`NTCY1Mȏ2̗ݏł";
 			}
-			cmd->blocksize = _wtoi(optionStr2) * unit;
+			cmd->treeShift = shift;
 		}
 		else{
 			throw L"sȃIvVł";
@@ -353,7 +382,7 @@ int T01Main(int argc, _TCHAR* argv[])
 		wprintf(mes);
 		wprintf(L"\n");
 		PrintHelp();
-		return 0;
+		return 1;
 	}
 	
 	try {
@@ -371,6 +400,7 @@ int T01Main(int argc, _TCHAR* argv[])
 				throw;
 			}
 
+			fhl.SetHashMode(cmd.threads, cmd.treeShift);
 			fhl.MakeFromFiles(cmd.path, &handler, cmd.blocksize);
 			wprintf(FillSpaceString);
 			
@@ -389,6 +419,7 @@ int T01Main(int argc, _TCHAR* argv[])
 			if( handler.errorcnt != 0 ){
 				wprintf(L"G[Ă܂II\n %I64d̃t@CG[Œǉ܂ł\n",
 					(int64_t)handler.errorcnt);
+				ret = 1;
 			}
 
 			wprintf(L"o̓t@C:%s\n", cmd.hashpath);
@@ -407,6 +438,7 @@ int T01Main(int argc, _TCHAR* argv[])
 				throw;
 			}
 
+			fhl.SetHashMode(cmd.threads, 0);
 			fhl.CheckHash(cmd.path, &handler, cmd.blocksize, false);
 			wprintf(FillSpaceString);
 
@@ -419,6 +451,7 @@ int T01Main(int argc, _TCHAR* argv[])
 					(int64_t)handler.errorcnt);
 				wprintf(L":nbVG[:%I64d, t@CȂ:%I64d, ǂݎ莸s:%I64d, ̑:%I64d\n",
 					(int64_t)handler.hashError, (int64_t)handler.notFound, (int64_t)handler.ioError, (int64_t)handler.otherError);
+				ret = 1;
 			}
 		}
 		else if( cmd.mode == InputCommand::BENCHMARK ){
@@ -483,9 +516,11 @@ int T01Main(int argc, _TCHAR* argv[])
 						break;
 					case FileHashList::HF_NOT_MATCH:
 						printf("nbVt@C͉Ă܂\n");
+						ret = 1;
 						break;
 					case FileHashList::HF_NO_HASH:
 						printf("nbVf[^܂\n");
+						ret = 1;
 						break;
 					}
 				}
@@ -503,7 +538,7 @@ int T01Main(int argc, _TCHAR* argv[])
 		}
 	}
 	catch(...) {
-		//
+		ret = 1;
 	}
 
 	return ret;
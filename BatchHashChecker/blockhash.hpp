@@ -0,0 +1,329 @@
+#pragma once
+
+// Ec[nbV̌vZ
+// Windows.hɈˑȂ̂LinuxłrhăeXgł
+// it@C̗񋓂nbVXg̓ǂݏhash.hppWindowŝ݁j
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+#ifdef _MSC_VER
+#include "common.h"
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#endif
+
+#include "openssl/sha.h"
+
+#include "kexception.hpp"
+
+#define SHA_CTX SHA512_CTX
+#define SHA_Init SHA512_Init
+#define SHA_Update SHA512_Update
+#define SHA_Final SHA512_Final
+#define HASH_LENGTH SHA512_DIGEST_LENGTH
+
+namespace hashchecker {
+
+// ZN^EɃACobt@iFILE_FLAG_NO_BUFFERING/O_DIRECTpj
+class AlignedBuffer
+{
+public:
+	AlignedBuffer(size_t size, size_t align)
+	{
+#ifdef _MSC_VER
+		ptr = (uint8_t*)_aligned_malloc(size, align);
+#else
+		if (posix_memalign((void**)&ptr, align, size) != 0) {
+			ptr = NULL;
+		}
+#endif
+		if (ptr == NULL) {
+			throw utl::KException(MES("mۂł܂"));
+		}
+	}
+
+	~AlignedBuffer()
+	{
+#ifdef _MSC_VER
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+
+	uint8_t* get() { return ptr; }
+
+private:
+	uint8_t* ptr;
+};
+
+// ʒuw̓ǂݍ
+// nbVł̓XbhƂɊJĎg
+// WindowsFILE_FLAG_NO_BUFFERINGAPOSIXO_DIRECTigȂt@CVXeł͒ʏpreadj
+class BlockReader
+{
+public:
+	BlockReader(const wchar_t* filename)
+	{
+#ifdef _MSC_VER
+		handle = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (handle == INVALID_HANDLE_VALUE) {
+			throw utl::IOException(MES("t@CJ܂"));
+		}
+#else
+		std::string path(wcslen(filename) * MB_CUR_MAX + 1, '\0');
+		size_t len = wcstombs(&path[0], filename, path.size());
+		if (len == (size_t)-1) {
+			throw utl::IOException(MES("t@CJ܂"));
+		}
+		path.resize(len);
+		fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+		if (fd < 0 && errno == EINVAL) {
+			// O_DIRECTɑΉĂȂt@CVXeitmpfsȂǁj
+			fd = open(path.c_str(), O_RDONLY);
+		}
+		if (fd < 0) {
+			throw utl::IOException(MES("t@CJ܂"));
+		}
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	}
+
+	~BlockReader()
+	{
+#ifdef _MSC_VER
+		CloseHandle(handle);
+#else
+		close(fd);
+#endif
+	}
+
+	// offset,buf,len̓ZN^TCYŃACĂ邱
+	// ǂ߂oCgԂit@CI[łlen菬Ȃj
+	size_t Read(int64_t offset, uint8_t* buf, size_t len)
+	{
+#ifdef _MSC_VER
+		OVERLAPPED overlapped = { 0 };
+		overlapped.Offset = (DWORD)offset;
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+		DWORD dwActualReadByte = 0;
+		if (ReadFile(handle, buf, (DWORD)len, &dwActualReadByte, &overlapped) == FALSE) {
+			if (GetLastError() == ERROR_HANDLE_EOF) {
+				return 0;
+			}
+			throw utl::IOException(MES("t@CǂݎG["));
+		}
+		return dwActualReadByte;
+#else
+		size_t total = 0;
+		while (total < len) {
+			ssize_t r = pread(fd, buf + total, len - total, offset + total);
+			if (r < 0) {
+				if (errno == EINTR) continue;
+				throw utl::IOException(MES("t@CǂݎG["));
+			}
+			total += r;
+			// O_DIRECTł̓ZN^r瑱ēǂ߂Ȃ̂ŁA[ɏIt@CI[
+			if (r == 0 || (r & 511) != 0) break;
+		}
+		return total;
+#endif
+	}
+
+private:
+#ifdef _MSC_VER
+	HANDLE handle;
+#else
+	int fd;
+#endif
+};
+
+// nbV1t@C
+struct HashJob {
+	std::wstring filepath;
+	int nameOffset;      // filepath + nameOffset ΃pX
+	int64_t filesize;
+	int treeShift;
+	int numChunks;       // c[łȂƂ1
+	std::vector<uint8_t> leaves;
+	std::atomic<int> remain;
+	std::atomic<bool> error;
+	const uint8_t* expected; // `FbN̔rΏہi쐬NULLj
+	uint8_t hash[HASH_LENGTH];
+
+	HashJob(const wchar_t* filepath, int nameOffset, int64_t filesize, int treeShift, const uint8_t* expected)
+		: filepath(filepath)
+		, nameOffset(nameOffset)
+		, filesize(filesize)
+		, treeShift(treeShift)
+		, numChunks(1)
+		, error(false)
+		, expected(expected)
+	{
+		if (treeShift > 0) {
+			int64_t chunkSize = int64_t(1) << treeShift;
+			numChunks = std::max(1, (int)((filesize + chunkSize - 1) >> treeShift));
+			leaves.resize(numChunks * HASH_LENGTH);
+		}
+		remain = numChunks;
+	}
+};
+
+// 쐬Ƀt@Cc[ɂ邩i`N1Ɏ܂t@C͍܂ŒʂŜ̃nbVj
+static int TreeShiftForFile(int64_t filesize, int treeShift)
+{
+	return (treeShift > 0 && filesize > (int64_t(1) << treeShift)) ? treeShift : 0;
+}
+
+// [offset,offset+length)̃nbVvZ
+// c[̗t͐擪0x00tĂvZ
+static void HashRange(BlockReader& reader, int64_t offset, int64_t length, bool leaf,
+	uint8_t* buffer, size_t bufSize, size_t sectorSize, uint8_t* hash,
+	const std::function<void(size_t)>& onProgress, std::mutex& lock)
+{
+	SHA_CTX ctx;
+	SHA_Init(&ctx);
+	if (leaf) {
+		const uint8_t prefix = 0x00;
+		SHA_Update(&ctx, &prefix, 1);
+	}
+	for (int64_t pos = 0; pos < length; ) {
+		size_t want = (size_t)std::min<int64_t>(bufSize, length - pos);
+		size_t readLen = (want + sectorSize - 1) & ~(sectorSize - 1);
+		size_t actual = reader.Read(offset + pos, buffer, readLen);
+		if (actual < want) {
+			// rŃt@CZȂ
+			throw utl::IOException(MES("t@CǂݎG["));
+		}
+		SHA_Update(&ctx, buffer, want);
+		pos += want;
+
+		std::lock_guard<std::mutex> guard(lock);
+		onProgress(want);
+	}
+	SHA_Final(hash, &ctx);
+}
+
+// t̃nbV2Ai擪0x01jănbVƂ1ɂȂ܂ŌJԂ
+// ̂Ƃ͍Ō1̂܂܏ɏグ
+static void TreeRoot(std::vector<uint8_t>& nodes, int n, uint8_t* root)
+{
+	while (n > 1) {
+		int m = 0;
+		for (int i = 0; i < n; i += 2, ++m) {
+			uint8_t* dst = &nodes[m * HASH_LENGTH];
+			if (i + 1 < n) {
+				const uint8_t prefix = 0x01;
+				uint8_t tmp[HASH_LENGTH];
+				SHA_CTX ctx;
+				SHA_Init(&ctx);
+				SHA_Update(&ctx, &prefix, 1);
+				SHA_Update(&ctx, &nodes[i * HASH_LENGTH], HASH_LENGTH * 2);
+				SHA_Final(tmp, &ctx);
+				memcpy(dst, tmp, HASH_LENGTH);
+			}
+			else {
+				memmove(dst, &nodes[i * HASH_LENGTH], HASH_LENGTH);
+			}
+		}
+		n = m;
+	}
+	memcpy(root, nodes.data(), HASH_LENGTH);
+}
+
+// t@CPʁAc[̏ꍇ̓`NPʂŃXbhɊUănbVvZ
+// numThreads: 0CPU
+// onProgress͓ǂ񂾃oCgAonComplete̓t@CƂɌvZI_ŌĂ΂iǂbN̒j
+static void HashParallel(std::vector<std::unique_ptr<HashJob>>& jobs, int numThreads,
+	size_t sectorSize, size_t blocksize,
+	const std::function<void(size_t)>& onProgress,
+	const std::function<void(HashJob&)>& onComplete)
+{
+	struct Task {
+		HashJob* job;
+		int chunk;
+	};
+	std::vector<Task> tasks;
+	for (auto& job : jobs) {
+		for (int c = 0; c < job->numChunks; ++c) {
+			tasks.push_back(Task{ job.get(), c });
+		}
+	}
+
+	size_t align = std::max<size_t>(sectorSize, 4096);
+	size_t bufSize = (blocksize > 0) ? blocksize : 4 * 1024 * 1024;
+	bufSize = (bufSize + align - 1) & ~(align - 1);
+
+	int threads = (numThreads > 0) ? numThreads : (int)std::thread::hardware_concurrency();
+	threads = std::max(1, std::min(threads, (int)tasks.size()));
+
+	std::vector<std::unique_ptr<AlignedBuffer>> buffers;
+	for (int i = 0; i < threads; ++i) {
+		buffers.emplace_back(new AlignedBuffer(bufSize, align));
+	}
+
+	std::atomic<size_t> nextTask(0);
+	std::mutex lock;
+
+	auto worker = [&](uint8_t* buffer) {
+		for (size_t t; (t = nextTask++) < tasks.size(); ) {
+			HashJob& job = *tasks[t].job;
+			if (!job.error) {
+				try {
+					BlockReader reader(job.filepath.c_str());
+					if (job.treeShift > 0) {
+						int64_t offset = int64_t(tasks[t].chunk) << job.treeShift;
+						int64_t length = std::min(job.filesize - offset, int64_t(1) << job.treeShift);
+						HashRange(reader, offset, length, true, buffer, bufSize, sectorSize,
+							&job.leaves[tasks[t].chunk * HASH_LENGTH], onProgress, lock);
+					}
+					else {
+						HashRange(reader, 0, job.filesize, false, buffer, bufSize, sectorSize,
+							job.hash, onProgress, lock);
+					}
+				}
+				catch (...) {
+					// std::thread̊OɗOoterminatêŁAłĂG[ɂ
+					job.error = true;
+				}
+			}
+			if (--job.remain == 0) {
+				if (!job.error && job.treeShift > 0) {
+					TreeRoot(job.leaves, job.numChunks, job.hash);
+				}
+				std::lock_guard<std::mutex> guard(lock);
+				onComplete(job);
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	try {
+		for (int i = 1; i < threads; ++i) {
+			pool.emplace_back(worker, buffers[i]->get());
+		}
+	}
+	catch (...) {
+		// ^XN͎荇Ȃ̂ŁANłXbhő
+	}
+	worker(buffers[0]->get());
+	for (auto& th : pool) {
+		th.join();
+	}
+}
+
+}
@@ -8,18 +8,11 @@
 #include <set>
 #include <string>
 
-#include "openssl/sha.h"
-
+#include "blockhash.hpp"
 #include "kexception.hpp"
 #include "int64.hpp"
 #include "fileutils.hpp"
 
-#define SHA_CTX SHA512_CTX
-#define SHA_Init SHA512_Init
-#define SHA_Update SHA512_Update
-#define SHA_Final SHA512_Final
-#define HASH_LENGTH SHA512_DIGEST_LENGTH
-
 namespace hashchecker {
 
 using namespace utl;
@@ -138,6 +131,8 @@ public:
 
 	enum CHECK_RESULT { CHECK_OK, HASH_ERROR, FILE_NOT_FOUND, IO_ERROR, WARNING_INVALID_PATH };
 	enum HASH_FILE_ERROR { HF_NO_ERROR, HF_NOT_MATCH, HF_NO_HASH };
+	// c[nbṼ`NTCY1MB`1TB
+	enum { MinTreeShift = 20, MaxTreeShift = 40 };
 
 	class HashCheckHandler
 	{
@@ -153,7 +148,18 @@ public:
 	FileHashList()
 		: DefaultMemSize(32 * 1024 * 1024) // 32 MB
 		, PageSize(0)
+		, numThreads(1)
+		, treeShift(0)
+	{
+	}
+
+	// numThreads: ɃnbVvZXbhi0CPUj
+	// treeShift: 0ȊOȂ(1 << treeShift)oCg傫t@C̓`Nɕ
+	//            c[nbVɂi쐬̂݁B`FbN̓nbVXg̋L^ɏ]j
+	void SetHashMode(int numThreads, int treeShift)
 	{
+		this->numThreads = numThreads;
+		this->treeShift = treeShift;
 	}
 
 	void FileHashList::WriteToFile(LPCWSTR path)
@@ -174,7 +180,7 @@ public:
 
 			WriteHex(hashStr, filelist[i].hash, HASH_LENGTH);
 
-			if (bufPos + sizeof(hashStr) + 2 + filelist[i].flen * 4 + 2 >= bufSize) {
+			if (bufPos + 3 + sizeof(hashStr) + 2 + filelist[i].flen * 4 + 2 >= bufSize) {
 				DWORD actualWrite;
 				// compute hash
 				SHA_Update(&ctx, hashfile.get(), bufPos);
@@ -185,6 +191,13 @@ public:
 			}
 
 			// write to buffer
+			if (filelist[i].treeShift > 0) {
+				// c[nbV '@' + `NTCYlog2(16i2) Oɕt
+				BYTE shift = (BYTE)filelist[i].treeShift;
+				bufptr[bufPos++] = '@';
+				WriteHex(bufptr + bufPos, &shift, 1);
+				bufPos += 2;
+			}
 			memcpy(bufptr + bufPos, hashStr, sizeof(hashStr));
 			bufPos += sizeof(hashStr);
 			bufptr[bufPos++] = ' ';
@@ -273,6 +286,17 @@ public:
 				break;
 			}
 
+			tmpHD.treeShift = 0;
+			if (*hfptr == '@') {
+				BYTE shift;
+				if (hfptr + 3 + HASH_LENGTH * 2 + 2 >= hashfileEnd)
+					throw IOException(MES("nbVt@CĂ܂"));
+				hfptr = ReadHex(hfptr + 1, &shift, 1);
+				if (shift < MinTreeShift || shift > MaxTreeShift)
+					throw IOException(MES("nbVt@CĂ܂"));
+				tmpHD.treeShift = shift;
+			}
+
 			hfptr = ReadHex(hfptr, tmpHash, HASH_LENGTH);
 			tmpHD.hash = flistb.Add(tmpHash, HASH_LENGTH);
 
@@ -329,14 +353,6 @@ public:
 		}
 
 		prm.sectorSize = GetSectorSize(path);
-		prm.buflen = DefaultMemSize;
-		std::unique_ptr<VirtualAllocMemory> actbuf_ = AllocateBuffer(&prm.buffer, &prm.buflen, prm.sectorSize, blocksize);
-
-		handler->BufferAllocated(prm.buflen, prm.sectorSize);
-
-		Handle ev = CreateEvent(NULL, FALSE, FALSE, NULL);
-		if (ev.get() == NULL) throw KException(MES("\[XG["));
-		prm.ev = ev.get();
 
 		// calc total data size
 		std::vector<HashData*> validlist;
@@ -362,6 +378,42 @@ public:
 
 		handler->TotalFileSize(totalFileSize);
 
+		bool hasTree = std::any_of(validlist.begin(), validlist.end(),
+			[](const HashData* hd) { return hd->treeShift > 0; });
+		if (!isBenchmark && (numThreads != 1 || hasTree)) {
+			std::vector<std::unique_ptr<HashJob>> jobs;
+			for (HashData* hd : validlist) {
+				MakePath(filepath + pathLen, *hd);
+				jobs.emplace_back(new HashJob(filepath, pathLen, hd->filesize, hd->treeShift, hd->hash));
+			}
+			HashParallel(jobs, numThreads, prm.sectorSize, blocksize,
+				[handler](size_t readByte) { handler->ProgressUpdate(readByte); },
+				[handler](HashJob& job) {
+				LPCWSTR name = job.filepath.c_str() + job.nameOffset;
+				if (job.error) {
+					handler->OnResult(name, IO_ERROR);
+				}
+				else if (memcmp(job.expected, job.hash, HASH_LENGTH) == 0) {
+					handler->OnResult(name, CHECK_OK);
+				}
+				else {
+					handler->OnResult(name, HASH_ERROR);
+				}
+			});
+			delete[] filepath;
+			return;
+		}
+
+		// ̂Ƃ͊e[J[̃obt@̂ŁÂƂm
+		prm.buflen = DefaultMemSize;
+		std::unique_ptr<VirtualAllocMemory> actbuf_ = AllocateBuffer(&prm.buffer, &prm.buflen, prm.sectorSize, blocksize);
+
+		handler->BufferAllocated(prm.buflen, prm.sectorSize);
+
+		Handle ev = CreateEvent(NULL, FALSE, FALSE, NULL);
+		if (ev.get() == NULL) throw KException(MES("\[XG["));
+		prm.ev = ev.get();
+
 		for (int64 i = 0, end = filelist.size(), v = 0, vend = validlist.size(); i < end; i++) {
 			if (filelist[i].duplicate) continue;
 
@@ -425,18 +477,10 @@ public:
 		}
 
 		prm.sectorSize = GetSectorSize(path);
-		prm.buflen = DefaultMemSize;
-		std::unique_ptr<VirtualAllocMemory> actbuf_ = AllocateBuffer(&prm.buffer, &prm.buflen, prm.sectorSize, blocksize);
-
-		handler->BufferAllocated(prm.buflen, prm.sectorSize);
 
 		filelist.clear();
 		flistb.Clear();
 
-		Handle ev = CreateEvent(NULL, FALSE, FALSE, NULL);
-		if (ev.get() == NULL) throw KException(MES("\[XG["));
-		prm.ev = ev.get();
-
 		CalcFileSize calcFileSize;
 		calcFileSize.totalFileSize = 0;
 		calcFileSize.filepath = filepath;
@@ -447,6 +491,47 @@ public:
 
 		handler->TotalFileSize(calcFileSize.totalFileSize);
 
+		if (numThreads != 1 || treeShift > 0) {
+			// t@C񋓂Ă܂Ƃ߂ĕɌvZ
+			CollectFiles collect;
+			collect.filepath = filepath;
+			collect.filepathLen = pathLen;
+			collect.pathLen = pathLen;
+			collect.treeShift = treeShift;
+			EnumDirectoryFile(path, collect);
+
+			HashParallel(collect.jobs, numThreads, prm.sectorSize, blocksize,
+				[handler](size_t readByte) { handler->ProgressUpdate(readByte); },
+				[handler](HashJob& job) {
+				handler->OnResult(job.filepath.c_str() + job.nameOffset, job.error ? IO_ERROR : CHECK_OK);
+			});
+
+			// Xg͗񋓏ɂ
+			for (auto& job : collect.jobs) {
+				if (job->error) continue;
+				HashData hd = { 0 };
+				hd.filesize = job->filesize;
+				hd.treeShift = job->treeShift;
+				hd.hash = flistb.Add(job->hash, HASH_LENGTH);
+				hd.flen = (int)job->filepath.size() - job->nameOffset;
+				hd.filename = (LPCWSTR)flistb.Add(job->filepath.c_str() + job->nameOffset, hd.flen * sizeof(wchar_t));
+				filelist.push_back(hd);
+			}
+
+			delete[] filepath;
+			return;
+		}
+
+		// ̂Ƃ͊e[J[̃obt@̂ŁÂƂm
+		prm.buflen = DefaultMemSize;
+		std::unique_ptr<VirtualAllocMemory> actbuf_ = AllocateBuffer(&prm.buffer, &prm.buflen, prm.sectorSize, blocksize);
+
+		handler->BufferAllocated(prm.buflen, prm.sectorSize);
+
+		Handle ev = CreateEvent(NULL, FALSE, FALSE, NULL);
+		if (ev.get() == NULL) throw KException(MES("\[XG["));
+		prm.ev = ev.get();
+
 		EnumCallback enumCallback;
 		enumCallback.p = this;
 		enumCallback.prm = &prm;
@@ -485,6 +570,7 @@ protected:
 		LPCWSTR filename;
 		int flen;
 		bool duplicate;
+		int treeShift; // 0Ȃt@CŜ̃nbV
 	};
 
 	struct VirtualAllocMemory {
@@ -500,6 +586,9 @@ protected:
 	size_t DefaultMemSize;
 	DWORD PageSize;
 
+	int numThreads;
+	int treeShift;
+
 	std::unique_ptr<FileHashList::VirtualAllocMemory> AllocateBuffer(BYTE** ppBuffer, size_t* memSize, DWORD SectorSize, DWORD blocksize)
 	{
 		if (PageSize == 0) {
@@ -616,6 +705,35 @@ protected:
 		}
 	};
 
+	struct CollectFiles {
+		std::vector<std::unique_ptr<HashJob>> jobs;
+		wchar_t* filepath;
+		int filepathLen;
+		int pathLen;
+		int treeShift;
+
+		bool operator()(WIN32_FIND_DATA& FindData)
+		{
+			int prevfilepathlen = filepathLen;
+			int filenamelen = (int)wcslen(FindData.cFileName);
+			memcpy(filepath + filepathLen, FindData.cFileName, (filenamelen + 1) * sizeof(wchar_t));
+			filepathLen += filenamelen;
+
+			if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+				filepath[filepathLen++] = L'\\';
+				filepath[filepathLen] = 0x0000;
+
+				EnumDirectoryFile((const wchar_t*)filepath, *this);
+			}
+			else {
+				__int64 filesize = make64(FindData.nFileSizeHigh, FindData.nFileSizeLow);
+				jobs.emplace_back(new HashJob(filepath, pathLen, filesize, TreeShiftForFile(filesize, treeShift), NULL));
+			}
+
+			filepathLen = prevfilepathlen;
+			return true;
+		}
+	};
 
 	static BYTE* ReadHex(BYTE* str, BYTE* dst, int len)
 	{
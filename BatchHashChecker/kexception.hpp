@@ -1,6 +1,7 @@
 #pragma once
 
 #include <exception>
+#include <string>
 #include <stdio.h>
 
 /*
@@ -25,76 +26,83 @@ struct printError;
 // Root of All exceptions
 class KException : public std::exception
 {
-	friend printError;
+	friend struct printError;
 public:
-	explicit KException::KException(const char* _Message, const char* _FileName, int _Line) :
-		std::exception(_Message),
+	explicit KException(const char* _Message, const char* _FileName, int _Line) :
+		Message(_Message),
 		File(_FileName),
 		Line(_Line)
 	{
 	}
 
-	explicit KException::KException(const char* _FileName, int _Line) :
-		std::exception(DefExceptMes::MesK),
+	explicit KException(const char* _FileName, int _Line) :
+		Message(DefExceptMes::MesK),
 		File(_FileName),
 		Line(_Line)
 	{
 	}
 
-	explicit KException::KException(const char* _Message) :
-		std::exception(_Message),
+	explicit KException(const char* _Message) :
+		Message(_Message),
 		File("Unknown"),
 		Line(0)
 	{
 	}
 
-	explicit KException::KException() :
-		std::exception(DefExceptMes::MesK),
+	explicit KException() :
+		Message(DefExceptMes::MesK),
 		File("Unknown"),
 		Line(0)
 	{
 	}
 
-	explicit KException::KException(const std::exception& stdexcept) :
-		std::exception(stdexcept.what()),
+	explicit KException(const std::exception& stdexcept) :
+		Message(stdexcept.what()),
 		File("Unknown"),
 		Line(0)
 	{
 	}
 
-	explicit KException::KException(const std::exception& stdexcept, const char* _FileName, int _Line) :
-		std::exception(stdexcept.what()),
+	explicit KException(const std::exception& stdexcept, const char* _FileName, int _Line) :
+		Message(stdexcept.what()),
 		File(_FileName),
 		Line(_Line)
 	{
 	}
 
-	virtual KException::~KException()
+	virtual ~KException()
 	{
 	}
 
-	const char* KException::getMessage() const
+	virtual const char* what() const throw()
 	{
-		return std::exception::what();
+		return Message.c_str();
 	}
 
-	const char* KException::getFileName() const
+	const char* getMessage() const
+	{
+		return Message.c_str();
+	}
+
+	const char* getFileName() const
 	{
 		return File;
 	}
 
-	int KException::getLine() const
+	int getLine() const
 	{
 		return Line;
 	}
 
-	static void KException::setPrintHandler(void(*_printHandler)(const KException&))
+	static void setPrintHandler(void(*_printHandler)(const KException&))
 	{
 		printHandler = _printHandler;
 	}
 
 
 protected:
+	// std::exception(const char*)MSVC̊gȂ̂ŎŎ
+	std::string Message;
 	const char* File;
 	int Line;
 
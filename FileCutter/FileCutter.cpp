@@ -6,31 +6,60 @@
 * http://opensource.org/licenses/mit-license.php
 */
 #define _CRT_SECURE_NO_WARNINGS
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // copy_file_range
+#endif
 
-#include <stdio.h>
-#include <stdlib.h>
-
-#include <cstdint>
-#include <string>
-#include <memory>
-#include <algorithm>
+#include "FileCutter.hpp"
 
 void printHelp() {
-	printf("FileCutter.exe -from <from_bytes> -length <length_bytes> <srcfile> <dstfile>\n");
+	printf(
+		"FileCutter.exe [-ts] -from <from_bytes> -length <length_bytes> [-from ... -length ...] <srcfile> <dstfile>\n"
+		"  -from <bytes>    ؂oJnʒu\n"
+		"  -length <bytes>  ؂oiȗ̓t@CI[܂Łj\n"
+		"  -ts              ͈͂TSpPbg(188/192oCg)Eɍ킹\n"
+		"-from/-length𕡐w肷Ǝw菇ɘAďo͂܂\n"
+		"-length͒O-from̒ɂȂ܂i-fromOɂꍇ͎-from̒j\n");
 }
 
 int main(int argc, char* argv[]) {
 
 	const char *srcpath = NULL, *dstpath = NULL;
-	size_t fromBytes = 0, lengthBytes = 0;
+	std::vector<filecutter::CutRange> ranges;
+	bool snapTs = false;
+	// -fromOɎw肳ꂽ-lengthi-fromƑgɂj
+	int64_t pendingLength = -1;
 
 	for (int i = 1; i < argc; ++i) {
 		std::string inarg(argv[i]);
-		if (inarg == "-from") {
-			fromBytes = _atoi64(argv[++i]);
+		if ((inarg == "-from" || inarg == "-length") && i + 1 >= argc) {
+			printHelp();
+			return 1;
 		}
-		else if (inarg == "-length") {
-			lengthBytes = _atoi64(argv[++i]);
+		if (inarg == "-from" || inarg == "-length") {
+			int64_t value = strtoll(argv[++i], NULL, 10);
+			if (value < 0) {
+				printf("%ssł: %s\n", inarg.c_str(), argv[i]);
+				return 1;
+			}
+			if (inarg == "-from") {
+				filecutter::CutRange range = { value, pendingLength };
+				ranges.push_back(range);
+				pendingLength = -1;
+			}
+			else if (!ranges.empty() && ranges.back().length < 0 && pendingLength < 0) {
+				ranges.back().length = value;
+			}
+			else if (pendingLength < 0) {
+				pendingLength = value;
+			}
+			else {
+				printf("-lengthɑΉ-from܂\n");
+				return 1;
+			}
+		}
+		else if (inarg == "-ts") {
+			snapTs = true;
 		}
 		else {
 			if (srcpath == NULL) {
@@ -51,22 +80,46 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 
-	enum { BUFSIZE = 4 * 1024 * 1024 };
-	FILE* fpsrc = fopen(srcpath, "rb");
-	FILE* fpdst = fopen(dstpath, "wb");
-	auto buffer = std::unique_ptr<uint8_t>(new uint8_t[BUFSIZE]);
-	size_t copyBytes = 0;
-	_fseeki64(fpsrc, fromBytes, SEEK_SET);
+	if (pendingLength >= 0) {
+		if (!ranges.empty()) {
+			// -fromȂ-length͂ǂ͈̔͂̒Ȃ
+			printf("-lengthɑΉ-from܂\n");
+			return 1;
+		}
+		// -lengthȂ擪
+		filecutter::CutRange range = { 0, pendingLength };
+		ranges.push_back(range);
+	}
+	if (ranges.empty()) {
+		filecutter::CutRange range = { 0, -1 };
+		ranges.push_back(range);
+	}
+
+	filecutter::FileCutter cutter;
+	if (!cutter.open(srcpath, dstpath)) {
+		return 1;
+	}
+
+	if (snapTs) {
+		if (!cutter.snapToTsPackets(ranges)) {
+			return 1;
+		}
+		const filecutter::TsPacketFormat& fmt = cutter.getTsFormat();
+		printf("pPbgTCY: %d\n", fmt.packetSize);
+		for (const filecutter::CutRange& r : ranges) {
+			printf("͈: %lld - %lld\n", (long long)r.from, (long long)(r.from + r.length));
+		}
+	}
 
-	while (1) {
-		size_t readBytes = fread(buffer.get(), 1, std::min<size_t>(BUFSIZE, lengthBytes - copyBytes), fpsrc);
-		fwrite(buffer.get(), readBytes, 1, fpdst);
-		if (readBytes < BUFSIZE) { break; }
-		copyBytes += readBytes;
+	if (!cutter.cut(ranges)) {
+		return 1;
 	}
 
-	fclose(fpsrc);
-	fclose(fpdst);
+	const filecutter::CopyStats& stats = cutter.getStats();
+	if (stats.cloned > 0 || stats.kernel > 0) {
+		printf("reflink: %lld bytes, copy_file_range: %lld bytes, obt@oR: %lld bytes\n",
+			(long long)stats.cloned, (long long)stats.kernel, (long long)stats.buffered);
+	}
 
 	printf("\n");
 
@@ -0,0 +1,436 @@
+/**
+* Amtasukaze File Cutter
+* Copyright (c) 2017-2019 Nekopanda
+*
+* This software is released under the MIT License.
+* http://opensource.org/licenses/mit-license.php
+*/
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#ifndef _MSC_VER
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+namespace filecutter {
+
+// ؂o͈ lengthȂt@CI[܂
+struct CutRange {
+	int64_t from;
+	int64_t length;
+};
+
+struct TsPacketFormat {
+	int packetSize; // 188 or 192
+	int syncOffset; // pPbg擪瓯oCg܂Łi192oCgpPbg͐擪4oCg^CX^vj
+};
+
+// Rs[@Ƃ̃oCg
+struct CopyStats {
+	int64_t cloned;   // reflink(FICLONERANGE)
+	int64_t kernel;   // copy_file_range
+	int64_t buffered; // read/write
+};
+
+class InputFile {
+public:
+	InputFile()
+#ifdef _MSC_VER
+		: fp(NULL)
+#else
+		: fd(-1)
+#endif
+		, size_(0)
+	{ }
+
+	~InputFile() {
+#ifdef _MSC_VER
+		if (fp != NULL) fclose(fp);
+#else
+		if (fd != -1) close(fd);
+#endif
+	}
+
+	bool open(const char* path) {
+#ifdef _MSC_VER
+		fp = fopen(path, "rb");
+		if (fp == NULL) return false;
+		_fseeki64(fp, 0, SEEK_END);
+		size_ = _ftelli64(fp);
+#else
+		fd = ::open(path, O_RDONLY);
+		if (fd == -1) return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0) return false;
+		size_ = st.st_size;
+#endif
+		return true;
+	}
+
+	int64_t size() const { return size_; }
+
+	// offsetlenoCgǂ ǂ߂oCgԂ
+	size_t readAt(int64_t offset, uint8_t* buf, size_t len) {
+#ifdef _MSC_VER
+		if (_fseeki64(fp, offset, SEEK_SET) != 0) return 0;
+		return fread(buf, 1, len, fp);
+#else
+		size_t total = 0;
+		while (total < len) {
+			ssize_t r = pread(fd, buf + total, len - total, offset + total);
+			if (r < 0 && errno == EINTR) continue;
+			if (r <= 0) break;
+			total += r;
+		}
+		return total;
+#endif
+	}
+
+#ifdef _MSC_VER
+	FILE* fp;
+#else
+	int fd;
+#endif
+
+private:
+	int64_t size_;
+
+	InputFile(const InputFile&);
+	InputFile& operator=(const InputFile&);
+};
+
+class OutputFile {
+public:
+	OutputFile()
+#ifdef _MSC_VER
+		: fp(NULL)
+#else
+		: fd(-1)
+		, blockSize(4096)
+		, cloneable(true)
+		, kernelCopy(true)
+#endif
+		, pos(0)
+	{ }
+
+	~OutputFile() {
+		close();
+	}
+
+	bool open(const char* path) {
+#ifdef _MSC_VER
+		fp = fopen(path, "wb");
+		return fp != NULL;
+#else
+		fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd == -1) return false;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_blksize > 0) {
+			blockSize = st.st_blksize;
+		}
+		return true;
+#endif
+	}
+
+	bool close() {
+		bool ok = true;
+#ifdef _MSC_VER
+		if (fp != NULL) {
+			ok = (fclose(fp) == 0);
+			fp = NULL;
+		}
+#else
+		if (fd != -1) {
+			ok = (::close(fd) == 0);
+			fd = -1;
+		}
+#endif
+		return ok;
+	}
+
+	bool write(const uint8_t* buf, size_t len) {
+#ifdef _MSC_VER
+		if (fwrite(buf, 1, len, fp) != len) return false;
+		pos += len;
+#else
+		size_t total = 0;
+		while (total < len) {
+			ssize_t r = pwrite(fd, buf + total, len - total, pos);
+			if (r < 0 && errno == EINTR) continue;
+			if (r <= 0) return false;
+			total += r;
+			pos += r;
+		}
+#endif
+		return true;
+	}
+
+#ifdef _MSC_VER
+	FILE* fp;
+#else
+	int fd;
+	int64_t blockSize;
+	bool cloneable;  // FICLONERANGEl邩
+	bool kernelCopy; // copy_file_rangel邩
+#endif
+	int64_t pos; // ݍς݃oCg
+
+private:
+	OutputFile(const OutputFile&);
+	OutputFile& operator=(const OutputFile&);
+};
+
+// ÕpPbgƍ킹3AœoCgł΃pPbg擪Ƃ݂Ȃ
+// data̓t@Cbase̓e
+static bool IsTsPacketStart(const uint8_t* data, int64_t base, int64_t len,
+	const TsPacketFormat& fmt, int64_t pos)
+{
+	const int P = fmt.packetSize;
+	auto isSync = [&](int64_t p) {
+		int64_t off = p - base + fmt.syncOffset;
+		return p >= base && p - base + P <= len && data[off] == 0x47;
+	};
+	if (!isSync(pos)) return false;
+	bool prev = isSync(pos - P);
+	bool next = isSync(pos + P);
+	return (prev && next) || (prev && isSync(pos - 2 * P)) || (next && isSync(pos + 2 * P));
+}
+
+// 擪t߂̍ŏ̃pPbgpPbgTCYo
+static bool DetectTsPacketFormat(InputFile& src, TsPacketFormat& fmt)
+{
+	enum { SCAN_BYTES = 192 * 1024 };
+	const int sizes[] = { 188, 192 };
+	std::vector<uint8_t> buf((size_t)std::min<int64_t>(SCAN_BYTES, src.size()));
+	int64_t len = src.readAt(0, buf.data(), buf.size());
+	for (int64_t pos = 0; pos < len; ++pos) {
+		for (int P : sizes) {
+			fmt.packetSize = P;
+			fmt.syncOffset = P - 188;
+			if (IsTsPacketStart(buf.data(), 0, len, fmt, pos)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// pospPbgEɍ킹
+// isEnd=falseȂpPbg擪i؂̂ėDj isEnd=trueȂpPbgI[i؂グDj
+// ߂ɋEȂfalseԂpos͂̂܂
+static bool SnapToTsPacket(InputFile& src, const TsPacketFormat& fmt, bool isEnd, int64_t& pos)
+{
+	// hbvŃpPbgԂɃS~Ă悤ɑO㐔\pPbgT
+	enum { WINDOW_PACKETS = 64 };
+	const int P = fmt.packetSize;
+	const int64_t target = std::max<int64_t>(0, std::min(pos, src.size()));
+	const int64_t base = std::max<int64_t>(0, target - (WINDOW_PACKETS + 2) * P);
+	const int64_t last = std::min(src.size(), target + (WINDOW_PACKETS + 2) * P);
+	std::vector<uint8_t> buf((size_t)(last - base));
+	int64_t len = src.readAt(base, buf.data(), buf.size());
+
+	auto isBoundary = [&](int64_t b) {
+		return IsTsPacketStart(buf.data(), base, len, fmt, isEnd ? (b - P) : b);
+	};
+
+	const int64_t range = (int64_t)WINDOW_PACKETS * P;
+	for (int pass = 0; pass < 2; ++pass) {
+		bool up = (pass == 0) ? isEnd : !isEnd;
+		if (up) {
+			for (int64_t b = target; b <= target + range && b <= base + len; ++b) {
+				if (isBoundary(b)) { pos = b; return true; }
+			}
+		}
+		else {
+			for (int64_t b = target; b >= target - range && b >= base; --b) {
+				if (isBoundary(b)) { pos = b; return true; }
+			}
+		}
+	}
+	return false;
+}
+
+class FileCutter {
+public:
+	FileCutter()
+		: stats_()
+		, tsFormat_()
+	{ }
+
+	bool open(const char* srcpath, const char* dstpath) {
+		if (!src_.open(srcpath)) {
+			fprintf(stderr, "̓t@CJ܂: %s\n", srcpath);
+			return false;
+		}
+		if (!dst_.open(dstpath)) {
+			fprintf(stderr, "o̓t@CJ܂: %s\n", dstpath);
+			return false;
+		}
+		return true;
+	}
+
+	int64_t srcSize() const { return src_.size(); }
+
+	// ͈͂t@CɎ߂Ēm肳
+	void clampRanges(std::vector<CutRange>& ranges) const {
+		for (CutRange& r : ranges) {
+			r.from = std::max<int64_t>(0, std::min(r.from, src_.size()));
+			int64_t maxLength = src_.size() - r.from;
+			r.length = (r.length < 0) ? maxLength : std::min(r.length, maxLength);
+		}
+	}
+
+	// Jnʒu͂܂ރpPbg̐擪AIʒu͂܂ރpPbg̏I[ɍL
+	bool snapToTsPackets(std::vector<CutRange>& ranges) {
+		clampRanges(ranges);
+		if (!DetectTsPacketFormat(src_, tsFormat_)) {
+			fprintf(stderr, "TSpPbg܂\n");
+			return false;
+		}
+		for (CutRange& r : ranges) {
+			int64_t start = r.from;
+			int64_t end = r.from + r.length;
+			if (!SnapToTsPacket(src_, tsFormat_, false, start)) {
+				fprintf(stderr, "x: %lld t߂ɃpPbgE܂\n", (long long)start);
+			}
+			if (!SnapToTsPacket(src_, tsFormat_, true, end)) {
+				fprintf(stderr, "x: %lld t߂ɃpPbgE܂\n", (long long)end);
+			}
+			r.from = start;
+			r.length = std::max<int64_t>(0, end - start);
+		}
+		return true;
+	}
+
+	// w͈͂ɏo̓t@CɘA
+	bool cut(std::vector<CutRange> ranges) {
+		clampRanges(ranges);
+		for (const CutRange& r : ranges) {
+			if (!copyRange(r.from, r.length)) {
+				fprintf(stderr, "Rs[Ɏs܂\n");
+				return false;
+			}
+		}
+		if (!dst_.close()) {
+			fprintf(stderr, "o̓t@C݂̏Ɏs܂\n");
+			return false;
+		}
+		return true;
+	}
+
+	const CopyStats& getStats() const { return stats_; }
+	const TsPacketFormat& getTsFormat() const { return tsFormat_; }
+
+private:
+	enum { BUFSIZE = 4 * 1024 * 1024 };
+
+	InputFile src_;
+	OutputFile dst_;
+	std::unique_ptr<uint8_t[]> buffer_;
+	CopyStats stats_;
+	TsPacketFormat tsFormat_;
+
+	bool copyRange(int64_t from, int64_t length) {
+#ifndef _MSC_VER
+		if (tryClone(from, length)) {
+			return true;
+		}
+		if (dst_.kernelCopy) {
+			int64_t copied = copyKernel(from, length);
+			if (copied < 0) return false;
+			from += copied;
+			length -= copied;
+		}
+#endif
+		return copyBuffered(from, length);
+	}
+
+#ifndef _MSC_VER
+	// reflink 茳AAubNEɑĂꍇ̂ݎg
+	bool tryClone(int64_t from, int64_t length) {
+#ifdef FICLONERANGE
+		const int64_t blk = dst_.blockSize;
+		bool toEnd = (from + length == src_.size());
+		if (!dst_.cloneable || length == 0 ||
+			from % blk || dst_.pos % blk || (length % blk && !toEnd)) {
+			return false;
+		}
+		struct file_clone_range arg = {};
+		arg.src_fd = src_.fd;
+		arg.src_offset = from;
+		arg.src_length = length;
+		arg.dest_offset = dst_.pos;
+		if (ioctl(dst_.fd, FICLONERANGE, &arg) != 0) {
+			if (errno == EOPNOTSUPP || errno == ENOTTY || errno == EXDEV) {
+				// t@CVXeΉ
+				dst_.cloneable = false;
+			}
+			return false;
+		}
+		dst_.pos += length;
+		stats_.cloned += length;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// copy_file_rangeŃRs[oCgԂ
+	// ΉȂ炻ȍ~̓obt@oRɂ̂œr܂ł̃oCgԂ
+	int64_t copyKernel(int64_t from, int64_t length) {
+		int64_t copied = 0;
+		while (copied < length) {
+			loff_t inoff = from + copied;
+			loff_t outoff = dst_.pos;
+			size_t chunk = (size_t)std::min<int64_t>(length - copied, 1 << 30);
+			ssize_t r = copy_file_range(src_.fd, &inoff, dst_.fd, &outoff, chunk, 0);
+			if (r < 0) {
+				if (errno == EINTR) continue;
+				if (errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+					errno == EOPNOTSUPP || errno == EBADF) {
+					dst_.kernelCopy = false;
+					break;
+				}
+				return -1;
+			}
+			if (r == 0) break; // EOF
+			copied += r;
+			dst_.pos += r;
+			stats_.kernel += r;
+		}
+		return copied;
+	}
+#endif
+
+	bool copyBuffered(int64_t from, int64_t length) {
+		if (length == 0) return true;
+		if (buffer_ == nullptr) {
+			buffer_ = std::unique_ptr<uint8_t[]>(new uint8_t[BUFSIZE]);
+		}
+		int64_t copied = 0;
+		while (copied < length) {
+			size_t readBytes = src_.readAt(from + copied,
+				buffer_.get(), (size_t)std::min<int64_t>(BUFSIZE, length - copied));
+			if (readBytes == 0) break; // EOF
+			if (!dst_.write(buffer_.get(), readBytes)) return false;
+			copied += readBytes;
+			stats_.buffered += readBytes;
+		}
+		return true;
+	}
+};
+
+} // namespace filecutter
@@ -254,6 +254,13 @@ void* NEAACDECAPI NeAACDecDecode2(NeAACDecHandle hDecoder,
                                   void **sample_buffer,
                                   unsigned long sample_buffer_size);
 
+/* Parse the syntax elements of a frame without decoding it.
+   Only error, bytesconsumed, fr_ch_ele, element_id and element_start/end are set. */
+long NEAACDECAPI NeAACDecParseElements(NeAACDecHandle hDecoder,
+                                       NeAACDecFrameInfo *hInfo,
+                                       unsigned char *buffer,
+                                       unsigned long buffer_size);
+
 char NEAACDECAPI NeAACDecAudioSpecificConfig(unsigned char *pBuffer,
                                              unsigned long buffer_size,
                                              mp4AudioSpecificConfig *mp4ASC);
@@ -823,6 +823,59 @@ void* NEAACDECAPI NeAACDecDecode2(NeAACDecHandle hpDecoder,
         sample_buffer, sample_buffer_size);
 }
 
+/* Parse the bitstream syntax only (no dequantization, no filterbank).
+   Used to get the bit positions of the syntax elements in a frame. */
+long NEAACDECAPI NeAACDecParseElements(NeAACDecHandle hpDecoder,
+                                       NeAACDecFrameInfo *hInfo,
+                                       unsigned char *buffer,
+                                       unsigned long buffer_size)
+{
+    NeAACDecStruct* hDecoder = (NeAACDecStruct*)hpDecoder;
+    bitfile ld = {0};
+    int i;
+
+    /* safety checks */
+    if ((hDecoder == NULL) || (hInfo == NULL) || (buffer == NULL))
+    {
+        return -1;
+    }
+
+    memset(hInfo, 0, sizeof(NeAACDecFrameInfo));
+
+    faad_initbits(&ld, buffer, buffer_size);
+
+    if (hDecoder->adts_header_present)
+    {
+        adts_header adts;
+
+        adts.old_format = hDecoder->config.useOldADTSFormat;
+        if ((hInfo->error = adts_frame(&adts, &ld)) > 0)
+        {
+            faad_endbits(&ld);
+            return hInfo->error;
+        }
+    }
+
+    hDecoder->parse_only = 1;
+    raw_data_block(hDecoder, hInfo, &ld, &hDecoder->pce, hDecoder->drc);
+    hDecoder->parse_only = 0;
+
+    if (hInfo->error == 0 && ld.error)
+        hInfo->error = 14;
+
+    hInfo->bytesconsumed = bit2byte(faad_get_processed_bits(&ld));
+    faad_endbits(&ld);
+
+    hInfo->fr_ch_ele = hDecoder->fr_ch_ele;
+    for (i = 0; i < hDecoder->fr_ch_ele; ++i) {
+        hInfo->element_id[i] = hDecoder->element_id[i];
+        hInfo->element_start[i] = hDecoder->element_start[i];
+        hInfo->element_end[i] = hDecoder->element_end[i];
+    }
+
+    return hInfo->error;
+}
+
 #ifdef DRM
 
 #define ERROR_STATE_INIT 6
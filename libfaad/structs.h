@@ -426,6 +426,8 @@ typedef struct
 		// Nekopanda
 		int element_start[MAX_CHANNELS];
 		int element_end[MAX_CHANNELS];
+		/* only parse the syntax, skip spectral reconstruction */
+		uint8_t parse_only;
 
     /* Configuration data */
     NeAACDecConfiguration config;
@@ -631,6 +631,9 @@ static uint8_t single_lfe_channel_element(NeAACDecStruct *hDecoder, bitfile *ld,
     }
 #endif
 
+		if (hDecoder->parse_only)
+			return 0;
+
     /* noiseless coding is done, spectral reconstruction is done now */
     retval = reconstruct_single_channel(hDecoder, ics, &sce, spec_data);
     if (retval > 0)
@@ -759,6 +762,9 @@ static uint8_t channel_pair_element(NeAACDecStruct *hDecoder, bitfile *ld,
     }
 #endif
 
+		if (hDecoder->parse_only)
+			return 0;
+
     /* noiseless coding is done, spectral reconstruction is done now */
     if ((result = reconstruct_channel_pair(hDecoder, ics1, ics2, &cpe,
         spec_data1, spec_data2)) > 0)